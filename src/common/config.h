@@ -3,40 +3,152 @@
 // The maximum forward rules allowed.
 #define MAX_FWD_RULES 256
 
+// The maximum backends (destinations) of a single forward rule.
+#define MAX_BACKENDS 16
+
+// The size of each forward rule's Maglev lookup table used to pick backends for new connections.
+// This must be a prime number and should be much larger than MAX_BACKENDS (at least 100 times) so backend weights are honored and few connections move when backends change.
+#define MAGLEV_TABLE_SIZE 4093
+
+// The amount of following lookup table slots tried when a new connection's backend is marked down by the loader's health checks.
+#define MAGLEV_FAILOVER_SLOTS 8
+
+// If enabled, forward rules may cover a range of bind ports.
+// Port ranges are stored as prefixes in a LPM trie that is only looked up when no single-port rule matches.
+#define ENABLE_FWD_RULE_RANGES
+
+// If enabled, forward rules may bind a prefix of addresses (e.g. 10.0.0.0/24 or 0.0.0.0/0) instead of a single bind IP.
+// Bind prefixes are stored in a LPM trie that is only looked up when no single-address rule matches.
+// Keep in mind this adds a lookup to every packet without a single-address rule, including replies from destinations.
+#define ENABLE_FWD_RULE_PREFIXES
+
 // The maximum bind IPs used.
-// This is used to determine the size of the port map.
+// This is used to determine the size of the connections map.
 // If you plan on binding multiple IP addresses, set this accordingly.
 #define MAX_BIND_IPS 1
 
 // The port range to use when selecting an available source port.
 // MAX_PORT - (MIN_PORT - 1) = The maximum amount of concurrent connections.
+// Source ports are handed out from a free-port pool in constant time, so the full range (e.g. 1024 - 65535) may be used.
 #define MIN_PORT 52000
 #define MAX_PORT 52500
 
+// The amount of ports inspected when a port pool runs out of free ports and a port in use must be recycled.
+#define PORT_RECYCLE_CANDIDATES 8
+
+// If enabled, splits each port pool into PORT_POOL_SLICES slices of the port range.
+// Each CPU allocates from its own slice and only steals free ports from neighbouring slices once its slice is exhausted.
+// Setting PORT_POOL_SLICES to the amount of CPUs handling packets is recommended.
+//#define ENABLE_PORT_POOL_SLICES
+#define PORT_POOL_SLICES 8
+
+// The amount of neighbouring slices checked for free ports when a CPU's slice is exhausted.
+#define PORT_POOL_STEAL_ATTEMPTS 2
+
 // Enables forward rule logging.
 #define ENABLE_RULE_LOGGING
 
 // Counts packets sent back to the client towards "forwarded" stat counter. 
 #define STATS_COUNT_FWD_BACK
 
+// If enabled, forward rules may police the packets and bytes per second sent by clients through the rule and by each client with token buckets.
+// Each CPU borrows tokens from the policer's shared budget in chunks and packets over the limit are dropped before they're rewritten.
+#define ENABLE_POLICERS
+
+// The maximum clients tracked by the per-client policers (least recently used clients are evicted).
+#define MAX_POLICED_CLIENTS 65536
+
+// The burst size of policers in milliseconds of their rate.
+#define POLICER_BURST 100
+
+// The amount of tokens in microseconds of a policer's rate a CPU borrows from the policer's shared budget at once.
+// Larger values reduce contention on the shared budget, but let each CPU hold on to more unused tokens.
+#define POLICER_BORROW_TIME 1000
+
+// If enabled, forward rules may limit the new connections per second each client (source IP) creates through the rule.
+// Packets that would create a connection over the limit are dropped before a source port is allocated, which caps the cost of floods from few sources.
+#define ENABLE_CONN_RATE_LIMITS
+
+// The maximum clients tracked by the new connection rate limiters (least recently used clients are evicted).
+#define MAX_CONN_RATE_CLIENTS 65536
+
+// If enabled, TCP forward rules with syn_cookies set answer SYNs with a SYN cookie instead of allocating a source port.
+// The connection to the destination is only opened once the client's ACK carries a valid cookie and sequence numbers are translated afterwards.
+// This requires kernel 6.0 or above (bpf_tcp_raw_gen_syncookie_ipv4() and bpf_tcp_raw_check_syncookie_ipv4() support).
+//#define ENABLE_SYN_COOKIES
+
+// The MSS announced to clients and destinations of proxied connections (IPv6 connections use 20 bytes less).
+#define SYN_PROXY_MSS 1460
+
+// If enabled, forward rules with fast_reject set answer new connections that can't be given a backend or source port with a TCP RST (or an ICMP port unreachable with UDP) instead of dropping them.
+// Clients fail over right away instead of retransmitting.
+#define ENABLE_FAST_REJECT
+
+// If enabled, forward rules with dsr set send the client's packets to the backend unchanged inside of an IPIP, GUE, or GRE header (Direct Server Return).
+// Backends answer clients directly, so no connection is tracked and no source port is allocated. Backends need the decap program (xdp_decap.o) or a matching tunnel and the bind IP on their loopback.
+#define ENABLE_DSR
+
+// The UDP port GUE encapsulated packets are sent to.
+#define DSR_GUE_PORT 6080
+
+// The maximum proxy IPs the decap program accepts tunnel packets from (see map_decap_sources).
+#define MAX_DECAP_SOURCES 64
+
+// If enabled, GRE and IPIP packets from the tunnel endpoints in the config have their outer headers removed and the packet they carry is forwarded like any other.
+// Packets sent back to clients of connections opened through a tunnel are encapsulated towards the tunnel's remote endpoint again.
+#define ENABLE_TUNNELS
+
+// The maximum tunnels terminated by the program.
+#define MAX_TUNNELS 64
+
+// If enabled, keeps per-CPU packet, byte, new connection, and drop counters for each forward rule and direction.
+// The counters are shown with the config when running the loader with -l while the program is loaded with pinned maps.
+#define ENABLE_FWD_RULE_STATS
+
 // If enabled, performs a FIB lookup on the route table when forwarding packets.
 // Otherwise, the ethernet source and destination MAC addresses are swapped.
 #define ENABLE_FIB_LOOKUPS
 
+// If enabled along with ENABLE_FIB_LOOKUPS, FIB lookup results (egress interface and MAC addresses) are cached per destination IP for FIB_CACHE_TTL seconds.
+// The loader removes cached entries when it receives neighbor or route updates through netlink.
+#define ENABLE_FIB_CACHE
+#define FIB_CACHE_TTL 30
+
+// The maximum destinations whose FIB lookup results are cached.
+#define FIB_CACHE_MAX_ENTRIES 4096
+
+// If enabled along with ENABLE_FIB_LOOKUPS, packets are redirected through a device map to the interface chosen by the FIB lookup when it isn't the interface they arrived on.
+// This allows splitting client-facing and backend-facing interfaces. Every interface packets may leave through must be listed in the config's interfaces.
+#define ENABLE_FIB_REDIRECT
+
 // Maximum interfaces the firewall can attach to.
 #define MAX_INTERFACES 6
 
+// If enabled, a BPF timer periodically removes connections that have been idle longer than their timeout and returns their source ports to the port pool.
+// This requires kernel 5.15 or above (bpf_timer support).
+#define ENABLE_CONN_REAPER
+
+// How often the connection reaper runs in seconds.
+#define CONN_REAPER_INTERVAL 1
+
 // Whether to recycle connections by last seen time.
 // Otherwise, connections are recycled by least amount of packets per nanosecond.
 #define RECYCLE_LAST_SEEN
 
-// Adds packet and last seen counters to connections.
-// This isn't used anywhere in the program right now which is why it's disabled by default.
-//#define CONNECTION_COUNTERS
+// The minimum time in milliseconds between updates of a connection's last seen time.
+// Packets of the same connection are often handled by several CPUs, so writing the time on every packet bounces its cache line between them.
+#define LAST_SEEN_UPDATE_INTERVAL 100
+
+// If enabled, the LRU maps written when connections and clients are created (connection counters, per-client policers, and new connection rate limiters) keep a LRU list for each CPU (BPF_F_NO_COMMON_LRU).
+// Otherwise, all CPUs share a single LRU list whose global lock serializes inserts and evictions during connection storms on hosts with many cores.
+// Each CPU only evicts entries from its own list, so the loader resizes these maps to give each CPU's list PER_CPU_LRU_HEADROOM percent of an even share of the map's entries (RSS rarely spreads clients evenly).
+//#define ENABLE_PER_CPU_LRU
+#define PER_CPU_LRU_HEADROOM 200
 
-// If enabled, uses a newer bpf_loop() function when choosing a source port for a new connection.
-// This allows for a much higher source port range. However, it requires a more recent kernel.
-#define USE_NEW_LOOP
+// If enabled, keeps packet and byte counters of each connection in both directions.
+// The counters are stored in a per-CPU map beside the connections map so CPUs never write to the same cache line.
+// The busiest connections may be listed by running the loader with --flows <count>.
+#define CONNECTION_COUNTERS
 
 // Whether to enable chaining multiple XDP programs with this tool (1 = enable. 0 = disable).
 #define XDP_MULTIPROG_ENABLED 1
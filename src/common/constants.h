@@ -4,5 +4,28 @@
 #define MAX_CPUS 256
 #define NANO_TO_SEC 1000000000
 
-#define MAX_PROTOCOLS 3
-#define MAX_PORTS (MAX_PORT - (MIN_PORT - 1))
\ No newline at end of file
+// TCP, UDP, ICMP, and ICMPv6 each have their own source port pools and connections.
+#define MAX_PROTOCOLS 4
+
+// A port range is split into at most 30 prefixes.
+#define MAX_PORT_RANGE_PREFIXES 30
+#define MAX_FWD_RULE_RANGE_ENTRIES (MAX_FWD_RULES * MAX_PORT_RANGE_PREFIXES)
+
+// Protocol, IP, and port bits.
+#define FWD_RULE_RANGE_PREFIXLEN (8 + 128 + 16)
+
+// Protocol and port bits preceding the bind prefix.
+#define FWD_RULE_PREFIX_BASE_LEN (8 + 16)
+#define MAX_IP6_EXT_HDRS 6
+#define MAX_PORTS (MAX_PORT - (MIN_PORT - 1))
+
+// Each connection is stored under its client and reply key.
+#define MAX_CONNS (2 * (MAX_BIND_IPS * MAX_PROTOCOLS) * MAX_PORTS)
+
+#ifdef ENABLE_PORT_POOL_SLICES
+#define PORT_SLICES PORT_POOL_SLICES
+#else
+#define PORT_SLICES 1
+#endif
+
+#define PORT_SLICE_SIZE ((MAX_PORTS + (PORT_SLICES - 1)) / PORT_SLICES)
\ No newline at end of file
@@ -1,77 +1,296 @@
 #pragma once
 
 #include <common/int_types.h>
+#include <common/config.h>
+#include <common/constants.h>
+
+#include <linux/bpf.h>
 
 struct stats
 {
     u64 forwarded;
     u64 passed;
     u64 dropped;
+
+    // Connections (or their counters) removed to make room for new ones before they expired.
+    u64 evicted;
 } typedef stats_t;
 
+// Counters of a single forward rule (client to destination is "fwd", destination back to client is "reply").
+struct fwd_rule_stats
+{
+    u64 new_conns;
+
+    u64 fwd_packets;
+    u64 fwd_bytes;
+    u64 fwd_dropped;
+
+    u64 reply_packets;
+    u64 reply_bytes;
+    u64 reply_dropped;
+} typedef fwd_rule_stats_t;
+
+// IP addresses are stored as IPv6 addresses in network byte order.
+// IPv4 addresses are stored as IPv4-mapped IPv6 addresses (::ffff:a.b.c.d).
 struct fwd_rule_key
 {
-    u32 ip;
+    u128 ip;
     u16 port;
 
     u8 protocol;
 
 } typedef fwd_rule_key_t;
 
+// Rules covering a range of bind ports are stored as port prefixes in a LPM trie.
+struct fwd_rule_range_key
+{
+    u32 prefixlen;
+
+    u8 protocol;
+    u128 ip;
+    u16 port;
+} __attribute__((packed)) typedef fwd_rule_range_key_t;
+
+// Rules binding a prefix of addresses are stored in a LPM trie (the prefix length covers the protocol, port, and bind prefix).
+struct fwd_rule_prefix_key
+{
+    u32 prefixlen;
+
+    u8 protocol;
+    u16 port;
+    u128 ip;
+} __attribute__((packed)) typedef fwd_rule_prefix_key_t;
+
 struct fwd_rule_val
 {
+    // Identifies the rule's backends in the backends map and its Maglev lookup table.
+    u32 id;
+
     int log;
 
-    u32 dst_ip;
-    u16 dst_port;
+    u32 backends_cnt;
+
+    // The first bind port of the rule (port ranges). If port_offset is set, each bind port is forwarded to the backend port plus its offset in the range.
+    u16 bind_port;
+    u8 port_offset;
+
+    // The source IP used towards the destination (0 = bind IP). May be of another address family than the bind IP (NAT64/NAT46).
+    u128 snat_ip;
+
+    u32 timeout;
+    u32 close_timeout;
+    u32 time_wait_timeout;
+
+    // Policer rates of the whole rule and of each client (0 = unlimited).
+    u64 pps;
+    u64 bytes_ps;
+    u64 client_pps;
+    u64 client_bytes_ps;
+
+    // The new connections per second each client may create and how many may be created at once (0 = unlimited).
+    u32 conn_rate;
+    u32 conn_burst;
+
+    // If set, SYNs are answered with SYN cookies and the connection is only created once the client's ACK validates.
+    u8 syn_cookies;
+
+    // If set, new connections without a backend or source port are rejected (TCP RST or ICMP port unreachable) instead of dropped.
+    u8 fast_reject;
+
+    // If set, packets are encapsulated towards the backend with this tunnel type instead of translated (Direct Server Return).
+    u8 dsr;
 } typedef fwd_rule_val_t;
 
+enum TUNNEL_TYPE
+{
+    TUNNEL_NONE = 0,
+    TUNNEL_IPIP,
+    TUNNEL_GUE,
+    TUNNEL_GRE
+} typedef TUNNEL_TYPE_T;
+
+// Tunnels are looked up by their local (outer destination) and remote (outer source) endpoint.
+struct tunnel_key
+{
+    u128 local_ip;
+    u128 remote_ip;
+} typedef tunnel_key_t;
+
+struct tunnel
+{
+    u128 local_ip;
+    u128 remote_ip;
+
+    u8 type;
+} typedef tunnel_t;
+
+// A policer's shared budget. Each rate is tracked as the time its budget is used up until (GCRA), so CPUs borrow tokens with a single compare-and-swap.
+struct policer
+{
+    u64 pkt_tat;
+    u64 byte_tat;
+} typedef policer_t;
+
+// The tokens a CPU borrowed from a policer's shared budget.
+struct policer_tokens
+{
+    u64 pkts;
+    u64 bytes;
+} typedef policer_tokens_t;
+
+// The rate of new connections a client creates through a rule, tracked as the time its budget is used up until (GCRA).
+struct conn_limiter
+{
+    u64 tat;
+} typedef conn_limiter_t;
+
+struct client_policer_key
+{
+    u128 ip;
+    u32 rule_id;
+} typedef client_policer_key_t;
+
+struct backend
+{
+    u128 ip;
+    u16 port;
+
+    // Set by the loader's health checks when the backend doesn't respond.
+    u8 down;
+} typedef backend_t;
+
 struct port_key
 {
-    u32 bind_ip;
+    // The IP the source port belongs to (the rule's source NAT IP or bind IP).
+    u128 bind_ip;
     u8 protocol;
     
     u16 port;
 } typedef port_key_t;
 
-struct port_val
+struct port_pool_key
 {
-    u32 src_ip;
-    u16 src_port;
+    u128 bind_ip;
+    u8 protocol;
+    u8 slice;
+} typedef port_pool_key_t;
 
-    u16 bind_port;
+struct port_pool
+{
+    struct bpf_spin_lock lock;
 
-    u64 last_seen;
-    u64 first_seen;
-    u64 count;
-} typedef port_val_t;
+    u32 free_cnt;
+    u32 hand;
+
+    u16 free[PORT_SLICE_SIZE];
+} typedef port_pool_t;
+
+struct conn_reaper
+{
+    struct bpf_timer timer;
+    u32 started;
+} typedef conn_reaper_t;
+
+struct fib_entry
+{
+    u64 expires;
+
+    // The next hop (gateway or destination) address used to invalidate cached entries on neighbor updates.
+    u128 nh_ip;
+
+    u32 ifindex;
 
+    u8 smac[6];
+    u8 dmac[6];
+} typedef fib_entry_t;
+
+// Connections are stored under the client's key (client to bind address and port) and the destination's reply key (source IP and port unset, the source NAT IP and source port as bind address and port).
+// Both entries hold a copy of the connection, so each direction only needs a single lookup. ICMP echoes use their identifier as source port.
 struct conn_key
 {
-    u32 src_ip;
+    u128 src_ip;
     u16 src_port;
-    u32 bind_ip;
+    u128 bind_ip;
     u16 bind_port;
     u8 protocol;
 } typedef conn_key_t;
 
+enum CONN_TCP_STATE
+{
+    CONN_TCP_NONE = 0,
+    CONN_TCP_SYN_SENT,
+    CONN_TCP_ESTABLISHED,
+    CONN_TCP_FIN_WAIT,
+    CONN_TCP_TIME_WAIT,
+    CONN_TCP_CLOSED
+} typedef CONN_TCP_STATE_T;
+
+enum CONN_SYN_PROXY
+{
+    CONN_SYN_PROXY_NONE = 0,
+    CONN_SYN_PROXY_HANDSHAKE,
+    CONN_SYN_PROXY_ESTABLISHED
+} typedef CONN_SYN_PROXY_T;
+
+#define CONN_FIN_CLIENT (1 << 0)
+#define CONN_FIN_SERVER (1 << 1)
+
 struct conn_val
 {
-    u32 src_ip;
+    u128 src_ip;
     u16 src_port;
 
+    u128 bind_ip;
     u16 bind_port;
 
+    u128 snat_ip;
     u16 port;
 
-#ifdef CONNECTION_COUNTERS
-    u64 first_seen;
-    u64 last_seen;
+    // The backend chosen when the connection was created.
+    u128 dst_ip;
+    u16 dst_port;
+
+    // The ID of the rule that created the connection (replies are counted towards it).
+    u32 rule_id;
 
+    // The tunnel the client's packets arrive through (0 = none). Packets sent back to the client are encapsulated towards the tunnel's remote endpoint.
+    u16 tunnel_id;
+
+    // Each copy tracks when its own direction was last seen (the connection reaper uses the later of both).
+    u64 last_seen;
+    u64 first_seen;
     u64 count;
-#endif
+
+    u32 timeout;
+    u32 close_timeout;
+    u32 time_wait_timeout;
+
+    // Changes to the TCP and SYN proxy states below are written to both copies.
+    u8 tcp_state;
+    u8 fin_flags;
+
+    // Connections opened after a SYN cookie validated. The sequence delta holds the cookie until the destination's SYN-ACK arrives and the destination's initial sequence number minus the cookie afterwards.
+    u8 syn_proxy;
+    u32 seq_delta;
+
+    // Checksum deltas of the address and port rewrite in each direction, calculated once when the connection is created (unused with NAT64/NAT46).
+    // The IPv4 header checksum only covers the addresses while the TCP/UDP checksum covers the ports as well.
+    u32 fwd_l3_csum;
+    u32 fwd_l4_csum;
+    u32 reply_l3_csum;
+    u32 reply_l4_csum;
 } typedef conn_val_t;
 
+// Per-CPU counters of a single connection (client to destination is "fwd", destination back to client is "reply").
+struct conn_stats
+{
+    u64 fwd_packets;
+    u64 fwd_bytes;
+
+    u64 reply_packets;
+    u64 reply_bytes;
+} typedef conn_stats_t;
+
 struct fwd_rule_log_event
 {
     u64 ts;
@@ -80,13 +299,13 @@ struct fwd_rule_log_event
 
     u16 port;
 
-    u32 src_ip;
+    u128 src_ip;
     u16 src_port;
 
-    u32 bind_ip;
+    u128 bind_ip;
     u16 bind_port;
     u8 protocol;
 
-    u32 dst_ip;
+    u128 dst_ip;
     u16 dst_port;
 } typedef fwd_rule_log_event_t;
\ No newline at end of file
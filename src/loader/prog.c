@@ -16,6 +16,8 @@
 #include <loader/utils/xdp.h>
 #include <loader/utils/logging.h>
 #include <loader/utils/stats.h>
+#include <loader/utils/netlink.h>
+#include <loader/utils/health.h>
 #include <loader/utils/helpers.h>
 
 int cont = 1;
@@ -40,6 +42,86 @@ static void unpin_needed_maps(config__t* cfg, struct bpf_object* obj, int ignore
             log_msg(cfg, 1, 0, "[WARNING] Failed to un-pin BPF map 'map_block' from file system (%d).", ret);
         }
     }
+
+#ifdef ENABLE_FWD_RULE_RANGES
+    // Unpin forward rule ranges map.
+    if ((ret = unpin_map(obj, XDP_MAP_PIN_DIR, "map_fwd_rule_ranges")) != 0)
+    {
+        if (!ignore_errors)
+        {
+            log_msg(cfg, 1, 0, "[WARNING] Failed to un-pin BPF map 'map_fwd_rule_ranges' from file system (%d).", ret);
+        }
+    }
+#endif
+
+#ifdef ENABLE_FWD_RULE_PREFIXES
+    // Unpin forward rule prefixes map.
+    if ((ret = unpin_map(obj, XDP_MAP_PIN_DIR, "map_fwd_rule_prefixes")) != 0)
+    {
+        if (!ignore_errors)
+        {
+            log_msg(cfg, 1, 0, "[WARNING] Failed to un-pin BPF map 'map_fwd_rule_prefixes' from file system (%d).", ret);
+        }
+    }
+#endif
+
+    // Unpin backends map.
+    if ((ret = unpin_map(obj, XDP_MAP_PIN_DIR, "map_backends")) != 0)
+    {
+        if (!ignore_errors)
+        {
+            log_msg(cfg, 1, 0, "[WARNING] Failed to un-pin BPF map 'map_backends' from file system (%d).", ret);
+        }
+    }
+
+    // Unpin Maglev map.
+    if ((ret = unpin_map(obj, XDP_MAP_PIN_DIR, "map_maglev")) != 0)
+    {
+        if (!ignore_errors)
+        {
+            log_msg(cfg, 1, 0, "[WARNING] Failed to un-pin BPF map 'map_maglev' from file system (%d).", ret);
+        }
+    }
+
+    // Unpin port pools map.
+    if ((ret = unpin_map(obj, XDP_MAP_PIN_DIR, "map_port_pools")) != 0)
+    {
+        if (!ignore_errors)
+        {
+            log_msg(cfg, 1, 0, "[WARNING] Failed to un-pin BPF map 'map_port_pools' from file system (%d).", ret);
+        }
+    }
+
+    // Unpin connections map.
+    if ((ret = unpin_map(obj, XDP_MAP_PIN_DIR, "map_connections")) != 0)
+    {
+        if (!ignore_errors)
+        {
+            log_msg(cfg, 1, 0, "[WARNING] Failed to un-pin BPF map 'map_connections' from file system (%d).", ret);
+        }
+    }
+
+#ifdef CONNECTION_COUNTERS
+    // Unpin connection stats map.
+    if ((ret = unpin_map(obj, XDP_MAP_PIN_DIR, "map_conn_stats")) != 0)
+    {
+        if (!ignore_errors)
+        {
+            log_msg(cfg, 1, 0, "[WARNING] Failed to un-pin BPF map 'map_conn_stats' from file system (%d).", ret);
+        }
+    }
+#endif
+
+#ifdef ENABLE_FWD_RULE_STATS
+    // Unpin forward rule stats map.
+    if ((ret = unpin_map(obj, XDP_MAP_PIN_DIR, "map_fwd_rule_stats")) != 0)
+    {
+        if (!ignore_errors)
+        {
+            log_msg(cfg, 1, 0, "[WARNING] Failed to un-pin BPF map 'map_fwd_rule_stats' from file system (%d).", ret);
+        }
+    }
+#endif
 }
 
 int main(int argc, char *argv[])
@@ -95,7 +177,49 @@ int main(int argc, char *argv[])
     {
         print_config(&cfg);
 
+#ifdef ENABLE_FWD_RULE_STATS
+        // Rule counters are only available while the program is loaded with its maps pinned.
+        int map_fwd_rule_stats = get_map_pin_fd(XDP_MAP_PIN_DIR, "map_fwd_rule_stats");
+        int map_fwd_rules = get_map_pin_fd(XDP_MAP_PIN_DIR, "map_fwd_rules");
+
+        if (map_fwd_rule_stats >= 0 && map_fwd_rules >= 0)
+        {
+            printf("\n");
+
+            print_fwd_rule_stats(&cfg, map_fwd_rules, get_map_pin_fd(XDP_MAP_PIN_DIR, "map_fwd_rule_ranges"), get_map_pin_fd(XDP_MAP_PIN_DIR, "map_fwd_rule_prefixes"), map_fwd_rule_stats, get_nprocs_conf());
+        }
+#endif
+
+        return EXIT_SUCCESS;
+    }
+
+    // Check for flows option.
+    if (cli.flows > 0)
+    {
+#ifdef CONNECTION_COUNTERS
+        // Connection counters are only available while the program is loaded with its maps pinned.
+        int map_conn_stats = get_map_pin_fd(XDP_MAP_PIN_DIR, "map_conn_stats");
+
+        if (map_conn_stats < 0)
+        {
+            fprintf(stderr, "[ERROR] Failed to find 'map_conn_stats' map. Please make sure the program is running with pinned maps.\n");
+
+            return EXIT_FAILURE;
+        }
+
+        if ((ret = print_top_conns(map_conn_stats, get_map_pin_fd(XDP_MAP_PIN_DIR, "map_connections"), get_nprocs_conf(), cli.flows)) != 0)
+        {
+            fprintf(stderr, "[ERROR] Failed to read connection stats (%d).\n", ret);
+
+            return EXIT_FAILURE;
+        }
+
         return EXIT_SUCCESS;
+#else
+        fprintf(stderr, "[ERROR] Connection counters are disabled. Please enable CONNECTION_COUNTERS in config.h.\n");
+
+        return EXIT_FAILURE;
+#endif
     }
 
     // Print tool info.
@@ -146,6 +270,14 @@ int main(int argc, char *argv[])
         return EXIT_FAILURE;
     }
 
+#ifdef ENABLE_PER_CPU_LRU
+    // Size each CPU's LRU list before the maps are created.
+    if (set_per_cpu_lru_sizes(prog) != 0)
+    {
+        log_msg(&cfg, 1, 0, "[WARNING] Failed to resize per-CPU LRU maps.");
+    }
+#endif
+
     // Attach XDP program to interface(s).
     int if_idx[MAX_INTERFACES] = {0};
     int attach_success = 0;
@@ -229,6 +361,134 @@ int main(int argc, char *argv[])
 
     log_msg(&cfg, 3, 0, "map_fwd_rules FD => %d.", map_fwd_rules);
 
+    int map_fwd_rule_ranges = -1;
+
+#ifdef ENABLE_FWD_RULE_RANGES
+    map_fwd_rule_ranges = get_map_fd(prog, "map_fwd_rule_ranges");
+
+    if (map_fwd_rule_ranges < 0)
+    {
+        log_msg(&cfg, 0, 1, "[ERROR] Failed to find 'map_fwd_rule_ranges' BPF map.\n");
+
+        return EXIT_FAILURE;
+    }
+
+    log_msg(&cfg, 3, 0, "map_fwd_rule_ranges FD => %d.", map_fwd_rule_ranges);
+#endif
+
+    int map_fwd_rule_prefixes = -1;
+
+#ifdef ENABLE_FWD_RULE_PREFIXES
+    map_fwd_rule_prefixes = get_map_fd(prog, "map_fwd_rule_prefixes");
+
+    if (map_fwd_rule_prefixes < 0)
+    {
+        log_msg(&cfg, 0, 1, "[ERROR] Failed to find 'map_fwd_rule_prefixes' BPF map.\n");
+
+        return EXIT_FAILURE;
+    }
+
+    log_msg(&cfg, 3, 0, "map_fwd_rule_prefixes FD => %d.", map_fwd_rule_prefixes);
+#endif
+
+    int map_backends = get_map_fd(prog, "map_backends");
+
+    if (map_backends < 0)
+    {
+        log_msg(&cfg, 0, 1, "[ERROR] Failed to find 'map_backends' BPF map.\n");
+
+        return EXIT_FAILURE;
+    }
+
+    log_msg(&cfg, 3, 0, "map_backends FD => %d.", map_backends);
+
+    int map_maglev = get_map_fd(prog, "map_maglev");
+
+    if (map_maglev < 0)
+    {
+        log_msg(&cfg, 0, 1, "[ERROR] Failed to find 'map_maglev' BPF map.\n");
+
+        return EXIT_FAILURE;
+    }
+
+    log_msg(&cfg, 3, 0, "map_maglev FD => %d.", map_maglev);
+
+    int map_port_pools = get_map_fd(prog, "map_port_pools");
+
+    if (map_port_pools < 0)
+    {
+        log_msg(&cfg, 0, 1, "[ERROR] Failed to find 'map_port_pools' BPF map.\n");
+
+        return EXIT_FAILURE;
+    }
+
+    log_msg(&cfg, 3, 0, "map_port_pools FD => %d.", map_port_pools);
+
+    int map_tunnels = -1;
+    int map_tunnel_ids = -1;
+
+#ifdef ENABLE_TUNNELS
+    map_tunnels = get_map_fd(prog, "map_tunnels");
+    map_tunnel_ids = get_map_fd(prog, "map_tunnel_ids");
+
+    if (map_tunnels < 0 || map_tunnel_ids < 0)
+    {
+        log_msg(&cfg, 1, 0, "[WARNING] Failed to find 'map_tunnels' or 'map_tunnel_ids' BPF map. Tunnels won't be terminated...");
+    }
+    else
+    {
+        log_msg(&cfg, 3, 0, "map_tunnels FD => %d.", map_tunnels);
+        log_msg(&cfg, 3, 0, "map_tunnel_ids FD => %d.", map_tunnel_ids);
+    }
+#endif
+
+#if defined(ENABLE_FIB_LOOKUPS) && defined(ENABLE_FIB_REDIRECT)
+    int map_devices = get_map_fd(prog, "map_devices");
+
+    if (map_devices < 0)
+    {
+        log_msg(&cfg, 1, 0, "[WARNING] Failed to find 'map_devices' BPF map. Packets routed out of another interface will be dropped...");
+    }
+    else
+    {
+        log_msg(&cfg, 3, 0, "map_devices FD => %d.", map_devices);
+
+        // Packets may be redirected out of any interface we're attached to.
+        for (int i = 0; i < cfg.interfaces_cnt; i++)
+        {
+            if (if_idx[i] < 1)
+            {
+                continue;
+            }
+
+            if ((ret = update_device(map_devices, if_idx[i])) != 0)
+            {
+                log_msg(&cfg, 1, 0, "[WARNING] Failed to add interface '%s' to the devices map (%d)...", cfg.interfaces[i], ret);
+            }
+        }
+    }
+#endif
+
+#if defined(ENABLE_FIB_LOOKUPS) && defined(ENABLE_FIB_CACHE)
+    int map_fib_cache = get_map_fd(prog, "map_fib_cache");
+    int nl_sock = -1;
+
+    if (map_fib_cache < 0)
+    {
+        log_msg(&cfg, 1, 0, "[WARNING] Failed to find 'map_fib_cache' BPF map. Cached FIB results will only expire by their TTL...");
+    }
+    else
+    {
+        log_msg(&cfg, 3, 0, "map_fib_cache FD => %d.", map_fib_cache);
+
+        // Listen for neighbor and route updates so cached FIB results don't go stale.
+        if ((nl_sock = open_netlink_sock()) < 0)
+        {
+            log_msg(&cfg, 1, 0, "[WARNING] Failed to open netlink socket. Cached FIB results will only expire by their TTL...");
+        }
+    }
+#endif
+
 #ifdef ENABLE_RULE_LOGGING
     int map_fwd_rules_log = get_map_fd(prog, "map_fwd_rules_log");
 
@@ -266,12 +526,110 @@ int main(int argc, char *argv[])
         {
             log_msg(&cfg, 3, 0, "BPF map 'map_fwd_rules' pinned to '%s/map_fwd_rules'.", XDP_MAP_PIN_DIR);
         }
+
+#ifdef ENABLE_FWD_RULE_RANGES
+        if ((ret = pin_map(obj, XDP_MAP_PIN_DIR, "map_fwd_rule_ranges")) != 0)
+        {
+            log_msg(&cfg, 1, 0, "[WARNING] Failed to pin 'map_fwd_rule_ranges' to file system (%d)...", ret);
+        }
+        else
+        {
+            log_msg(&cfg, 3, 0, "BPF map 'map_fwd_rule_ranges' pinned to '%s/map_fwd_rule_ranges'.", XDP_MAP_PIN_DIR);
+        }
+#endif
+
+#ifdef ENABLE_FWD_RULE_PREFIXES
+        if ((ret = pin_map(obj, XDP_MAP_PIN_DIR, "map_fwd_rule_prefixes")) != 0)
+        {
+            log_msg(&cfg, 1, 0, "[WARNING] Failed to pin 'map_fwd_rule_prefixes' to file system (%d)...", ret);
+        }
+        else
+        {
+            log_msg(&cfg, 3, 0, "BPF map 'map_fwd_rule_prefixes' pinned to '%s/map_fwd_rule_prefixes'.", XDP_MAP_PIN_DIR);
+        }
+#endif
+
+        if ((ret = pin_map(obj, XDP_MAP_PIN_DIR, "map_backends")) != 0)
+        {
+            log_msg(&cfg, 1, 0, "[WARNING] Failed to pin 'map_backends' to file system (%d)...", ret);
+        }
+        else
+        {
+            log_msg(&cfg, 3, 0, "BPF map 'map_backends' pinned to '%s/map_backends'.", XDP_MAP_PIN_DIR);
+        }
+
+        if ((ret = pin_map(obj, XDP_MAP_PIN_DIR, "map_maglev")) != 0)
+        {
+            log_msg(&cfg, 1, 0, "[WARNING] Failed to pin 'map_maglev' to file system (%d)...", ret);
+        }
+        else
+        {
+            log_msg(&cfg, 3, 0, "BPF map 'map_maglev' pinned to '%s/map_maglev'.", XDP_MAP_PIN_DIR);
+        }
+
+        if ((ret = pin_map(obj, XDP_MAP_PIN_DIR, "map_port_pools")) != 0)
+        {
+            log_msg(&cfg, 1, 0, "[WARNING] Failed to pin 'map_port_pools' to file system (%d)...", ret);
+        }
+        else
+        {
+            log_msg(&cfg, 3, 0, "BPF map 'map_port_pools' pinned to '%s/map_port_pools'.", XDP_MAP_PIN_DIR);
+        }
+
+        if ((ret = pin_map(obj, XDP_MAP_PIN_DIR, "map_connections")) != 0)
+        {
+            log_msg(&cfg, 1, 0, "[WARNING] Failed to pin 'map_connections' to file system (%d)...", ret);
+        }
+        else
+        {
+            log_msg(&cfg, 3, 0, "BPF map 'map_connections' pinned to '%s/map_connections'.", XDP_MAP_PIN_DIR);
+        }
+
+#ifdef CONNECTION_COUNTERS
+        if ((ret = pin_map(obj, XDP_MAP_PIN_DIR, "map_conn_stats")) != 0)
+        {
+            log_msg(&cfg, 1, 0, "[WARNING] Failed to pin 'map_conn_stats' to file system (%d)...", ret);
+        }
+        else
+        {
+            log_msg(&cfg, 3, 0, "BPF map 'map_conn_stats' pinned to '%s/map_conn_stats'.", XDP_MAP_PIN_DIR);
+        }
+#endif
+
+#ifdef ENABLE_FWD_RULE_STATS
+        if ((ret = pin_map(obj, XDP_MAP_PIN_DIR, "map_fwd_rule_stats")) != 0)
+        {
+            log_msg(&cfg, 1, 0, "[WARNING] Failed to pin 'map_fwd_rule_stats' to file system (%d)...", ret);
+        }
+        else
+        {
+            log_msg(&cfg, 3, 0, "BPF map 'map_fwd_rule_stats' pinned to '%s/map_fwd_rule_stats'.", XDP_MAP_PIN_DIR);
+        }
+#endif
     }
 
     log_msg(&cfg, 2, 0, "Updating rules...");
 
     // Update rules.
-    update_fwd_rules(map_fwd_rules, &cfg);
+    update_fwd_rules(map_fwd_rules, map_fwd_rule_ranges, map_fwd_rule_prefixes, map_backends, map_maglev, map_port_pools, &cfg);
+
+    // Update tunnels.
+    if (map_tunnels >= 0 && map_tunnel_ids >= 0)
+    {
+        update_tunnels(map_tunnels, map_tunnel_ids, &cfg);
+    }
+
+    // Backend health checks run asynchronously from the main loop.
+    health_checks_t* hc = calloc(1, sizeof(*hc));
+
+    if (!hc)
+    {
+        log_msg(&cfg, 1, 0, "[WARNING] Failed to allocate backend health checks. Backends won't be health checked...");
+    }
+    else
+    {
+        update_health_checks(hc, map_fwd_rules, map_fwd_rule_ranges, map_fwd_rule_prefixes, map_backends, &cfg);
+    }
 
     // Signal.
     signal(SIGINT, signal_hndl);
@@ -336,7 +694,18 @@ int main(int argc, char *argv[])
                     }
 
                     // Update forward rules.
-                    update_fwd_rules(map_fwd_rules, &cfg);
+                    update_fwd_rules(map_fwd_rules, map_fwd_rule_ranges, map_fwd_rule_prefixes, map_backends, map_maglev, map_port_pools, &cfg);
+
+                    // Update tunnels.
+                    if (map_tunnels >= 0 && map_tunnel_ids >= 0)
+                    {
+                        update_tunnels(map_tunnels, map_tunnel_ids, &cfg);
+                    }
+
+                    if (hc)
+                    {
+                        update_health_checks(hc, map_fwd_rules, map_fwd_rule_ranges, map_fwd_rule_prefixes, map_backends, &cfg);
+                    }
                 }
 
                 // Update last check timer
@@ -366,6 +735,18 @@ int main(int argc, char *argv[])
         poll_fwd_rules_rb(rb);
 #endif
 
+        if (hc)
+        {
+            poll_health_checks(hc, map_backends, &cfg);
+        }
+
+#if defined(ENABLE_FIB_LOOKUPS) && defined(ENABLE_FIB_CACHE)
+        if (nl_sock >= 0)
+        {
+            poll_netlink_sock(nl_sock, map_fib_cache);
+        }
+#endif
+
         usleep(sleep_time);
     }
 
@@ -380,6 +761,19 @@ int main(int argc, char *argv[])
     }
 #endif
 
+#if defined(ENABLE_FIB_LOOKUPS) && defined(ENABLE_FIB_CACHE)
+    if (nl_sock >= 0)
+    {
+        close(nl_sock);
+    }
+#endif
+
+    if (hc)
+    {
+        close_health_checks(hc);
+        free(hc);
+    }
+
     // Detach XDP program from interfaces.
     for (int i = 0; i < MAX_INTERFACES; i++)
     {
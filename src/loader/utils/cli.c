@@ -7,6 +7,7 @@ const struct option opts[] =
     { "skb", no_argument, NULL, 's' },
     { "time", required_argument, NULL, 't' },
     { "list", no_argument, NULL, 'l' },
+    { "flows", required_argument, NULL, 'f' },
     { "help", no_argument, NULL, 'h' },
 
     { "verbose", required_argument, NULL, 'v' },
@@ -32,7 +33,7 @@ void parse_cli(cli_t *cli, int argc, char *argv[])
 {
     int c;
 
-    while ((c = getopt_long(argc, argv, "c:ost:lhv:i:p:u:n:", opts, NULL)) != -1)
+    while ((c = getopt_long(argc, argv, "c:ost:lf:hv:i:p:u:n:", opts, NULL)) != -1)
     {
         switch (c)
         {
@@ -61,6 +62,11 @@ void parse_cli(cli_t *cli, int argc, char *argv[])
 
                 break;
 
+            case 'f':
+                cli->flows = atoi(optarg);
+
+                break;
+
             case 'h':
                 cli->help = 1;
 
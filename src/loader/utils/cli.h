@@ -11,6 +11,7 @@ struct cli
     unsigned int skb : 1;
     unsigned int time;
     unsigned int list : 1;
+    int flows;
     unsigned int help : 1;
 
     int verbose;
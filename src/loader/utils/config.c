@@ -358,6 +358,140 @@ int parse_cfg(config__t *cfg, const char* data, config_overrides_t* overrides)
         }
     }
 
+    // Get connection timeouts.
+    int tcp_est_timeout;
+
+    if (config_lookup_int(&conf, "tcp_est_timeout", &tcp_est_timeout) == CONFIG_TRUE)
+    {
+        cfg->tcp_est_timeout = tcp_est_timeout;
+    }
+
+    int tcp_close_timeout;
+
+    if (config_lookup_int(&conf, "tcp_close_timeout", &tcp_close_timeout) == CONFIG_TRUE)
+    {
+        cfg->tcp_close_timeout = tcp_close_timeout;
+    }
+
+    int tcp_time_wait_timeout;
+
+    if (config_lookup_int(&conf, "tcp_time_wait_timeout", &tcp_time_wait_timeout) == CONFIG_TRUE)
+    {
+        cfg->tcp_time_wait_timeout = tcp_time_wait_timeout;
+    }
+
+    int udp_timeout;
+
+    if (config_lookup_int(&conf, "udp_timeout", &udp_timeout) == CONFIG_TRUE)
+    {
+        cfg->udp_timeout = udp_timeout;
+    }
+
+    int icmp_timeout;
+
+    if (config_lookup_int(&conf, "icmp_timeout", &icmp_timeout) == CONFIG_TRUE)
+    {
+        cfg->icmp_timeout = icmp_timeout;
+    }
+
+    // Backend health checks.
+    int health_check_interval;
+
+    if (config_lookup_int(&conf, "health_check_interval", &health_check_interval) == CONFIG_TRUE)
+    {
+        cfg->health_check_interval = health_check_interval;
+    }
+
+    int health_check_timeout;
+
+    if (config_lookup_int(&conf, "health_check_timeout", &health_check_timeout) == CONFIG_TRUE)
+    {
+        cfg->health_check_timeout = health_check_timeout;
+    }
+
+    int health_check_rise;
+
+    if (config_lookup_int(&conf, "health_check_rise", &health_check_rise) == CONFIG_TRUE)
+    {
+        cfg->health_check_rise = health_check_rise;
+    }
+
+    int health_check_fall;
+
+    if (config_lookup_int(&conf, "health_check_fall", &health_check_fall) == CONFIG_TRUE)
+    {
+        cfg->health_check_fall = health_check_fall;
+    }
+
+    // Read tunnels.
+    setting = config_lookup(&conf, "tunnels");
+
+    if (setting && config_setting_is_list(setting))
+    {
+        cfg->tunnels_cnt = 0;
+
+        for (int i = 0; i < config_setting_length(setting); i++)
+        {
+            if (i >= MAX_TUNNELS)
+            {
+                log_msg(cfg, 0, 1, "[WARNING] More than %d tunnels are configured. Ignoring the rest...", MAX_TUNNELS);
+
+                break;
+            }
+
+            tunnel_cfg_t* tunnel = &cfg->tunnels[i];
+
+            config_setting_t* tunnel_cfg = config_setting_get_elem(setting, i);
+
+            // Type.
+            const char* type;
+
+            if (config_setting_lookup_string(tunnel_cfg, "type", &type) == CONFIG_TRUE)
+            {
+                if (tunnel->type)
+                {
+                    free((void*)tunnel->type);
+
+                    tunnel->type = NULL;
+                }
+
+                tunnel->type = strdup(type);
+            }
+
+            // Local IP.
+            const char* local_ip;
+
+            if (config_setting_lookup_string(tunnel_cfg, "local_ip", &local_ip) == CONFIG_TRUE)
+            {
+                if (tunnel->local_ip)
+                {
+                    free((void*)tunnel->local_ip);
+
+                    tunnel->local_ip = NULL;
+                }
+
+                tunnel->local_ip = strdup(local_ip);
+            }
+
+            // Remote IP.
+            const char* remote_ip;
+
+            if (config_setting_lookup_string(tunnel_cfg, "remote_ip", &remote_ip) == CONFIG_TRUE)
+            {
+                if (tunnel->remote_ip)
+                {
+                    free((void*)tunnel->remote_ip);
+
+                    tunnel->remote_ip = NULL;
+                }
+
+                tunnel->remote_ip = strdup(remote_ip);
+            }
+
+            cfg->tunnels_cnt++;
+        }
+    }
+
     // Read forward rules.
     setting = config_lookup(&conf, "rules");
 
@@ -433,6 +567,22 @@ int parse_cfg(config__t *cfg, const char* data, config_overrides_t* overrides)
                 rule->bind_port = bind_port;
             }
 
+            // Bind port range end.
+            int bind_port_end;
+
+            if (config_setting_lookup_int(rule_cfg, "bind_port_end", &bind_port_end) == CONFIG_TRUE)
+            {
+                rule->bind_port_end = bind_port_end;
+            }
+
+            // Port offset.
+            int port_offset;
+
+            if (config_setting_lookup_bool(rule_cfg, "port_offset", &port_offset) == CONFIG_TRUE)
+            {
+                rule->port_offset = port_offset;
+            }
+
             // Destination IP.
             const char* dst_ip;
 
@@ -455,6 +605,195 @@ int parse_cfg(config__t *cfg, const char* data, config_overrides_t* overrides)
             {
                 rule->dst_port = dst_port;
             }
+
+            // Backends.
+            config_setting_t* backends = config_setting_lookup(rule_cfg, "backends");
+
+            if (backends && config_setting_is_list(backends))
+            {
+                rule->backends_cnt = 0;
+
+                for (int j = 0; j < config_setting_length(backends); j++)
+                {
+                    if (j >= MAX_BACKENDS)
+                    {
+                        log_msg(cfg, 0, 1, "[WARNING] Forward rule at index #%d has more than %d backends. Ignoring the rest...", i + 1, MAX_BACKENDS);
+
+                        break;
+                    }
+
+                    fwd_backend_cfg_t* backend = &rule->backends[j];
+
+                    config_setting_t* backend_cfg = config_setting_get_elem(backends, j);
+
+                    // IP.
+                    const char* ip;
+
+                    if (config_setting_lookup_string(backend_cfg, "ip", &ip) == CONFIG_TRUE)
+                    {
+                        if (backend->ip)
+                        {
+                            free((void*)backend->ip);
+
+                            backend->ip = NULL;
+                        }
+
+                        backend->ip = strdup(ip);
+                    }
+
+                    // Port.
+                    int port;
+
+                    if (config_setting_lookup_int(backend_cfg, "port", &port) == CONFIG_TRUE)
+                    {
+                        backend->port = port;
+                    }
+
+                    // Weight.
+                    int weight;
+
+                    if (config_setting_lookup_int(backend_cfg, "weight", &weight) == CONFIG_TRUE)
+                    {
+                        backend->weight = weight;
+                    }
+
+                    rule->backends_cnt++;
+                }
+            }
+
+            // Source NAT IP.
+            const char* snat_ip;
+
+            if (config_setting_lookup_string(rule_cfg, "snat_ip", &snat_ip) == CONFIG_TRUE)
+            {
+                if (rule->snat_ip)
+                {
+                    free((void*)rule->snat_ip);
+
+                    rule->snat_ip = NULL;
+                }
+
+                rule->snat_ip = strdup(snat_ip);
+            }
+
+            // Health check.
+            int health_check;
+
+            if (config_setting_lookup_bool(rule_cfg, "health_check", &health_check) == CONFIG_TRUE)
+            {
+                rule->health_check = health_check;
+            }
+
+            // Policers.
+            long long policer_pps;
+
+            if (config_setting_lookup_int64(rule_cfg, "policer_pps", &policer_pps) == CONFIG_TRUE)
+            {
+                rule->policer_pps = (policer_pps > 0) ? policer_pps : 0;
+            }
+
+            long long policer_bps;
+
+            if (config_setting_lookup_int64(rule_cfg, "policer_bps", &policer_bps) == CONFIG_TRUE)
+            {
+                rule->policer_bps = (policer_bps > 0) ? policer_bps : 0;
+            }
+
+            long long policer_client_pps;
+
+            if (config_setting_lookup_int64(rule_cfg, "policer_client_pps", &policer_client_pps) == CONFIG_TRUE)
+            {
+                rule->policer_client_pps = (policer_client_pps > 0) ? policer_client_pps : 0;
+            }
+
+            long long policer_client_bps;
+
+            if (config_setting_lookup_int64(rule_cfg, "policer_client_bps", &policer_client_bps) == CONFIG_TRUE)
+            {
+                rule->policer_client_bps = (policer_client_bps > 0) ? policer_client_bps : 0;
+            }
+
+            // New connection rate limit.
+            int conn_rate_limit;
+
+            if (config_setting_lookup_int(rule_cfg, "conn_rate_limit", &conn_rate_limit) == CONFIG_TRUE)
+            {
+                rule->conn_rate_limit = (conn_rate_limit > 0) ? conn_rate_limit : 0;
+            }
+
+            int conn_rate_burst;
+
+            if (config_setting_lookup_int(rule_cfg, "conn_rate_burst", &conn_rate_burst) == CONFIG_TRUE)
+            {
+                rule->conn_rate_burst = (conn_rate_burst > 0) ? conn_rate_burst : 0;
+            }
+
+            // SYN cookies.
+            int syn_cookies;
+
+            if (config_setting_lookup_bool(rule_cfg, "syn_cookies", &syn_cookies) == CONFIG_TRUE)
+            {
+                rule->syn_cookies = syn_cookies;
+            }
+
+            // Fast reject.
+            int fast_reject;
+
+            if (config_setting_lookup_bool(rule_cfg, "fast_reject", &fast_reject) == CONFIG_TRUE)
+            {
+                rule->fast_reject = fast_reject;
+            }
+
+            // Direct Server Return.
+            const char* dsr;
+
+            if (config_setting_lookup_string(rule_cfg, "dsr", &dsr) == CONFIG_TRUE)
+            {
+                if (rule->dsr)
+                {
+                    free((void*)rule->dsr);
+
+                    rule->dsr = NULL;
+                }
+
+                rule->dsr = strdup(dsr);
+            }
+
+            // Connection timeouts.
+            int tcp_est_timeout;
+
+            if (config_setting_lookup_int(rule_cfg, "tcp_est_timeout", &tcp_est_timeout) == CONFIG_TRUE)
+            {
+                rule->tcp_est_timeout = tcp_est_timeout;
+            }
+
+            int tcp_close_timeout;
+
+            if (config_setting_lookup_int(rule_cfg, "tcp_close_timeout", &tcp_close_timeout) == CONFIG_TRUE)
+            {
+                rule->tcp_close_timeout = tcp_close_timeout;
+            }
+
+            int tcp_time_wait_timeout;
+
+            if (config_setting_lookup_int(rule_cfg, "tcp_time_wait_timeout", &tcp_time_wait_timeout) == CONFIG_TRUE)
+            {
+                rule->tcp_time_wait_timeout = tcp_time_wait_timeout;
+            }
+
+            int udp_timeout;
+
+            if (config_setting_lookup_int(rule_cfg, "udp_timeout", &udp_timeout) == CONFIG_TRUE)
+            {
+                rule->udp_timeout = udp_timeout;
+            }
+
+            int icmp_timeout;
+
+            if (config_setting_lookup_int(rule_cfg, "icmp_timeout", &icmp_timeout) == CONFIG_TRUE)
+            {
+                rule->icmp_timeout = icmp_timeout;
+            }
         }
     }
 
@@ -544,6 +883,71 @@ int save_cfg(config__t* cfg, const char* file_path)
     setting = config_setting_add(root, "stdout_update_time", CONFIG_TYPE_INT);
     config_setting_set_int(setting, cfg->stdout_update_time);
 
+    // Add connection timeouts.
+    setting = config_setting_add(root, "tcp_est_timeout", CONFIG_TYPE_INT);
+    config_setting_set_int(setting, cfg->tcp_est_timeout);
+
+    setting = config_setting_add(root, "tcp_close_timeout", CONFIG_TYPE_INT);
+    config_setting_set_int(setting, cfg->tcp_close_timeout);
+
+    setting = config_setting_add(root, "tcp_time_wait_timeout", CONFIG_TYPE_INT);
+    config_setting_set_int(setting, cfg->tcp_time_wait_timeout);
+
+    setting = config_setting_add(root, "udp_timeout", CONFIG_TYPE_INT);
+    config_setting_set_int(setting, cfg->udp_timeout);
+
+    setting = config_setting_add(root, "icmp_timeout", CONFIG_TYPE_INT);
+    config_setting_set_int(setting, cfg->icmp_timeout);
+
+    // Add backend health check settings.
+    setting = config_setting_add(root, "health_check_interval", CONFIG_TYPE_INT);
+    config_setting_set_int(setting, cfg->health_check_interval);
+
+    setting = config_setting_add(root, "health_check_timeout", CONFIG_TYPE_INT);
+    config_setting_set_int(setting, cfg->health_check_timeout);
+
+    setting = config_setting_add(root, "health_check_rise", CONFIG_TYPE_INT);
+    config_setting_set_int(setting, cfg->health_check_rise);
+
+    setting = config_setting_add(root, "health_check_fall", CONFIG_TYPE_INT);
+    config_setting_set_int(setting, cfg->health_check_fall);
+
+    // Add tunnels.
+    if (cfg->tunnels_cnt > 0)
+    {
+        setting = config_setting_add(root, "tunnels", CONFIG_TYPE_LIST);
+
+        for (int i = 0; i < cfg->tunnels_cnt && i < MAX_TUNNELS; i++)
+        {
+            tunnel_cfg_t* tunnel = &cfg->tunnels[i];
+
+            config_setting_t* tunnel_cfg = config_setting_add(setting, NULL, CONFIG_TYPE_GROUP);
+
+            if (!tunnel_cfg)
+            {
+                continue;
+            }
+
+            if (tunnel->type)
+            {
+                config_setting_t* type = config_setting_add(tunnel_cfg, "type", CONFIG_TYPE_STRING);
+                config_setting_set_string(type, tunnel->type);
+            }
+
+            if (tunnel->local_ip)
+            {
+                config_setting_t* local_ip = config_setting_add(tunnel_cfg, "local_ip", CONFIG_TYPE_STRING);
+                config_setting_set_string(local_ip, tunnel->local_ip);
+            }
+
+            if (tunnel->remote_ip)
+            {
+                config_setting_t* remote_ip = config_setting_add(tunnel_cfg, "remote_ip", CONFIG_TYPE_STRING);
+                config_setting_set_string(remote_ip, tunnel->remote_ip);
+            }
+        }
+    }
+
     // Add forward rules.
     config_setting_t* rules = config_setting_add(root, "rules", CONFIG_TYPE_LIST);
 
@@ -588,6 +992,16 @@ int save_cfg(config__t* cfg, const char* file_path)
                 config_setting_t* bind_port = config_setting_add(rule_cfg, "bind_port", CONFIG_TYPE_INT);
                 config_setting_set_int(bind_port, rule->bind_port);
 
+                // Add bind port range.
+                if (rule->bind_port_end > 0)
+                {
+                    config_setting_t* bind_port_end = config_setting_add(rule_cfg, "bind_port_end", CONFIG_TYPE_INT);
+                    config_setting_set_int(bind_port_end, rule->bind_port_end);
+
+                    config_setting_t* port_offset = config_setting_add(rule_cfg, "port_offset", CONFIG_TYPE_BOOL);
+                    config_setting_set_bool(port_offset, rule->port_offset);
+                }
+
                 // Add destination IP.
                 if (rule->dst_ip)
                 {
@@ -598,6 +1012,140 @@ int save_cfg(config__t* cfg, const char* file_path)
                 // Add destination port.
                 config_setting_t* dst_port = config_setting_add(rule_cfg, "dst_port", CONFIG_TYPE_INT);
                 config_setting_set_int(dst_port, rule->dst_port);
+
+                // Add backends.
+                if (rule->backends_cnt > 0)
+                {
+                    config_setting_t* backends = config_setting_add(rule_cfg, "backends", CONFIG_TYPE_LIST);
+
+                    for (int j = 0; j < rule->backends_cnt && j < MAX_BACKENDS; j++)
+                    {
+                        fwd_backend_cfg_t* backend = &rule->backends[j];
+
+                        config_setting_t* backend_cfg = config_setting_add(backends, NULL, CONFIG_TYPE_GROUP);
+
+                        if (!backend_cfg)
+                        {
+                            continue;
+                        }
+
+                        if (backend->ip)
+                        {
+                            config_setting_t* ip = config_setting_add(backend_cfg, "ip", CONFIG_TYPE_STRING);
+                            config_setting_set_string(ip, backend->ip);
+                        }
+
+                        config_setting_t* port = config_setting_add(backend_cfg, "port", CONFIG_TYPE_INT);
+                        config_setting_set_int(port, backend->port);
+
+                        config_setting_t* weight = config_setting_add(backend_cfg, "weight", CONFIG_TYPE_INT);
+                        config_setting_set_int(weight, backend->weight);
+                    }
+                }
+
+                // Add source NAT IP.
+                if (rule->snat_ip)
+                {
+                    config_setting_t* snat_ip = config_setting_add(rule_cfg, "snat_ip", CONFIG_TYPE_STRING);
+                    config_setting_set_string(snat_ip, rule->snat_ip);
+                }
+
+                // Add health check setting.
+                if (rule->health_check)
+                {
+                    config_setting_t* health_check = config_setting_add(rule_cfg, "health_check", CONFIG_TYPE_BOOL);
+                    config_setting_set_bool(health_check, rule->health_check);
+                }
+
+                // Add policers (0 is unlimited).
+                if (rule->policer_pps > 0)
+                {
+                    config_setting_t* policer_pps = config_setting_add(rule_cfg, "policer_pps", CONFIG_TYPE_INT64);
+                    config_setting_set_int64(policer_pps, rule->policer_pps);
+                }
+
+                if (rule->policer_bps > 0)
+                {
+                    config_setting_t* policer_bps = config_setting_add(rule_cfg, "policer_bps", CONFIG_TYPE_INT64);
+                    config_setting_set_int64(policer_bps, rule->policer_bps);
+                }
+
+                if (rule->policer_client_pps > 0)
+                {
+                    config_setting_t* policer_client_pps = config_setting_add(rule_cfg, "policer_client_pps", CONFIG_TYPE_INT64);
+                    config_setting_set_int64(policer_client_pps, rule->policer_client_pps);
+                }
+
+                if (rule->policer_client_bps > 0)
+                {
+                    config_setting_t* policer_client_bps = config_setting_add(rule_cfg, "policer_client_bps", CONFIG_TYPE_INT64);
+                    config_setting_set_int64(policer_client_bps, rule->policer_client_bps);
+                }
+
+                // Add new connection rate limit.
+                if (rule->conn_rate_limit > 0)
+                {
+                    config_setting_t* conn_rate_limit = config_setting_add(rule_cfg, "conn_rate_limit", CONFIG_TYPE_INT);
+                    config_setting_set_int(conn_rate_limit, rule->conn_rate_limit);
+                }
+
+                if (rule->conn_rate_burst > 0)
+                {
+                    config_setting_t* conn_rate_burst = config_setting_add(rule_cfg, "conn_rate_burst", CONFIG_TYPE_INT);
+                    config_setting_set_int(conn_rate_burst, rule->conn_rate_burst);
+                }
+
+                // Add SYN cookies setting.
+                if (rule->syn_cookies)
+                {
+                    config_setting_t* syn_cookies = config_setting_add(rule_cfg, "syn_cookies", CONFIG_TYPE_BOOL);
+                    config_setting_set_bool(syn_cookies, rule->syn_cookies);
+                }
+
+                // Add fast reject setting.
+                if (rule->fast_reject)
+                {
+                    config_setting_t* fast_reject = config_setting_add(rule_cfg, "fast_reject", CONFIG_TYPE_BOOL);
+                    config_setting_set_bool(fast_reject, rule->fast_reject);
+                }
+
+                // Add DSR setting.
+                if (rule->dsr)
+                {
+                    config_setting_t* dsr = config_setting_add(rule_cfg, "dsr", CONFIG_TYPE_STRING);
+                    config_setting_set_string(dsr, rule->dsr);
+                }
+
+                // Add connection timeouts (0 inherits the main setting).
+                if (rule->tcp_est_timeout > 0)
+                {
+                    config_setting_t* tcp_est_timeout = config_setting_add(rule_cfg, "tcp_est_timeout", CONFIG_TYPE_INT);
+                    config_setting_set_int(tcp_est_timeout, rule->tcp_est_timeout);
+                }
+
+                if (rule->tcp_close_timeout > 0)
+                {
+                    config_setting_t* tcp_close_timeout = config_setting_add(rule_cfg, "tcp_close_timeout", CONFIG_TYPE_INT);
+                    config_setting_set_int(tcp_close_timeout, rule->tcp_close_timeout);
+                }
+
+                if (rule->tcp_time_wait_timeout > 0)
+                {
+                    config_setting_t* tcp_time_wait_timeout = config_setting_add(rule_cfg, "tcp_time_wait_timeout", CONFIG_TYPE_INT);
+                    config_setting_set_int(tcp_time_wait_timeout, rule->tcp_time_wait_timeout);
+                }
+
+                if (rule->udp_timeout > 0)
+                {
+                    config_setting_t* udp_timeout = config_setting_add(rule_cfg, "udp_timeout", CONFIG_TYPE_INT);
+                    config_setting_set_int(udp_timeout, rule->udp_timeout);
+                }
+
+                if (rule->icmp_timeout > 0)
+                {
+                    config_setting_t* icmp_timeout = config_setting_add(rule_cfg, "icmp_timeout", CONFIG_TYPE_INT);
+                    config_setting_set_int(icmp_timeout, rule->icmp_timeout);
+                }
             }
         }
     }
@@ -642,6 +1190,8 @@ void set_fwd_rule_defaults(fwd_rule_cfg_t* rule)
     rule->bind_ip = NULL;
 
     rule->bind_port = 0;
+    rule->bind_port_end = 0;
+    rule->port_offset = 0;
 
     if (rule->protocol)
     {
@@ -658,6 +1208,55 @@ void set_fwd_rule_defaults(fwd_rule_cfg_t* rule)
     rule->dst_ip = NULL;
 
     rule->dst_port = 0;
+
+    rule->backends_cnt = 0;
+
+    for (int i = 0; i < MAX_BACKENDS; i++)
+    {
+        fwd_backend_cfg_t* backend = &rule->backends[i];
+
+        if (backend->ip)
+        {
+            free((void*)backend->ip);
+        }
+
+        backend->ip = NULL;
+        backend->port = 0;
+        backend->weight = 1;
+    }
+
+    if (rule->snat_ip)
+    {
+        free((void*)rule->snat_ip);
+    }
+
+    rule->snat_ip = NULL;
+
+    rule->health_check = 0;
+
+    rule->policer_pps = 0;
+    rule->policer_bps = 0;
+    rule->policer_client_pps = 0;
+    rule->policer_client_bps = 0;
+
+    rule->conn_rate_limit = 0;
+    rule->conn_rate_burst = 0;
+
+    rule->syn_cookies = 0;
+    rule->fast_reject = 0;
+
+    if (rule->dsr)
+    {
+        free((void*)rule->dsr);
+    }
+
+    rule->dsr = NULL;
+
+    rule->tcp_est_timeout = 0;
+    rule->tcp_close_timeout = 0;
+    rule->tcp_time_wait_timeout = 0;
+    rule->udp_timeout = 0;
+    rule->icmp_timeout = 0;
 }
 
 /**
@@ -677,6 +1276,17 @@ void set_cfg_defaults(config__t* cfg)
     cfg->stats_per_second = 0;
     cfg->stdout_update_time = 1000;
 
+    cfg->tcp_est_timeout = 7200;
+    cfg->tcp_close_timeout = 60;
+    cfg->tcp_time_wait_timeout = 5;
+    cfg->udp_timeout = 120;
+    cfg->icmp_timeout = 30;
+
+    cfg->health_check_interval = 5;
+    cfg->health_check_timeout = 2000;
+    cfg->health_check_rise = 2;
+    cfg->health_check_fall = 3;
+
     cfg->interfaces_cnt = 0;
 
     for (int i = 0; i < MAX_INTERFACES; i++)
@@ -692,6 +1302,32 @@ void set_cfg_defaults(config__t* cfg)
         cfg->interfaces[i] = NULL;
     }
 
+    cfg->tunnels_cnt = 0;
+
+    for (int i = 0; i < MAX_TUNNELS; i++)
+    {
+        tunnel_cfg_t* tunnel = &cfg->tunnels[i];
+
+        if (tunnel->type)
+        {
+            free((void*)tunnel->type);
+        }
+
+        if (tunnel->local_ip)
+        {
+            free((void*)tunnel->local_ip);
+        }
+
+        if (tunnel->remote_ip)
+        {
+            free((void*)tunnel->remote_ip);
+        }
+
+        tunnel->type = NULL;
+        tunnel->local_ip = NULL;
+        tunnel->remote_ip = NULL;
+    }
+
     cfg->rules_cnt = 0;
 
     for (int i = 0; i < MAX_FWD_RULES; i++)
@@ -718,10 +1354,49 @@ void print_fwd_rule(fwd_rule_cfg_t* rule, int idx)
 
     printf("\t\tBind IP => %s\n", rule->bind_ip);
     printf("\t\tBind Port => %d\n", rule->bind_port);
+    printf("\t\tBind Port End => %d\n", rule->bind_port_end);
+    printf("\t\tPort Offset => %d\n", rule->port_offset);
     printf("\t\tBind Protocol => %s\n\n", rule->protocol);
 
     printf("\t\tDestination IP => %s\n", rule->dst_ip);
-    printf("\t\tDestination Port => %d\n", rule->dst_port);
+    printf("\t\tDestination Port => %d\n\n", rule->dst_port);
+
+    if (rule->backends_cnt > 0)
+    {
+        printf("\t\tBackends\n");
+
+        for (int i = 0; i < rule->backends_cnt && i < MAX_BACKENDS; i++)
+        {
+            fwd_backend_cfg_t* backend = &rule->backends[i];
+
+            printf("\t\t\t#%d => %s:%d (weight %d)\n", i + 1, backend->ip, backend->port, backend->weight);
+        }
+
+        printf("\n");
+    }
+
+    printf("\t\tSource NAT IP => %s\n\n", (rule->snat_ip) ? rule->snat_ip : "N/A");
+
+    printf("\t\tHealth Check => %d\n\n", rule->health_check);
+
+    printf("\t\tPolicer PPS => %llu\n", rule->policer_pps);
+    printf("\t\tPolicer BPS => %llu\n", rule->policer_bps);
+    printf("\t\tPolicer Client PPS => %llu\n", rule->policer_client_pps);
+    printf("\t\tPolicer Client BPS => %llu\n\n", rule->policer_client_bps);
+
+    printf("\t\tConnection Rate Limit => %d\n", rule->conn_rate_limit);
+    printf("\t\tConnection Rate Burst => %d\n\n", rule->conn_rate_burst);
+
+    printf("\t\tSYN Cookies => %d\n", rule->syn_cookies);
+    printf("\t\tFast Reject => %d\n\n", rule->fast_reject);
+
+    printf("\t\tDSR => %s\n\n", (rule->dsr) ? rule->dsr : "N/A");
+
+    printf("\t\tTCP Established Timeout => %d\n", rule->tcp_est_timeout);
+    printf("\t\tTCP Closing Timeout => %d\n", rule->tcp_close_timeout);
+    printf("\t\tTCP Time Wait Timeout => %d\n", rule->tcp_time_wait_timeout);
+    printf("\t\tUDP Timeout => %d\n", rule->udp_timeout);
+    printf("\t\tICMP Timeout => %d\n", rule->icmp_timeout);
 }
 
 /**
@@ -751,6 +1426,21 @@ void print_config(config__t* cfg)
     printf("\tStats Per Second => %d\n", cfg->stats_per_second);
     printf("\tStdout Update Time => %d\n\n", cfg->stdout_update_time);
 
+    printf("Connection Timeouts\n");
+
+    printf("\tTCP Established => %d\n", cfg->tcp_est_timeout);
+    printf("\tTCP Closing => %d\n", cfg->tcp_close_timeout);
+    printf("\tTCP Time Wait => %d\n", cfg->tcp_time_wait_timeout);
+    printf("\tUDP => %d\n", cfg->udp_timeout);
+    printf("\tICMP => %d\n\n", cfg->icmp_timeout);
+
+    printf("Backend Health Checks\n");
+
+    printf("\tInterval => %d\n", cfg->health_check_interval);
+    printf("\tTimeout => %d\n", cfg->health_check_timeout);
+    printf("\tRise => %d\n", cfg->health_check_rise);
+    printf("\tFall => %d\n\n", cfg->health_check_fall);
+
     printf("Interfaces\n");
     
     if (cfg->interfaces_cnt > 0)
@@ -774,6 +1464,24 @@ void print_config(config__t* cfg)
         printf("\t- None\n\n");
     }
 
+    printf("Tunnels\n");
+
+    if (cfg->tunnels_cnt > 0)
+    {
+        for (int i = 0; i < cfg->tunnels_cnt && i < MAX_TUNNELS; i++)
+        {
+            tunnel_cfg_t* tunnel = &cfg->tunnels[i];
+
+            printf("\t#%d => %s (%s <=> %s)\n", i + 1, (tunnel->type) ? tunnel->type : "N/A", (tunnel->local_ip) ? tunnel->local_ip : "N/A", (tunnel->remote_ip) ? tunnel->remote_ip : "N/A");
+        }
+
+        printf("\n");
+    }
+    else
+    {
+        printf("\t- None\n\n");
+    }
+
     printf("Rules\n");
 
     if (cfg->rules_cnt > 0)
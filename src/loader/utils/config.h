@@ -13,6 +13,24 @@
 
 #define CONFIG_DEFAULT_PATH "/etc/xdpfwd/xdpfwd.conf"
 
+struct fwd_backend_cfg
+{
+    char* ip;
+    u16 port;
+
+    int weight;
+} typedef fwd_backend_cfg_t;
+
+// A GRE or IPIP tunnel whose packets are handled like the packet they carry.
+struct tunnel_cfg
+{
+    char* type;
+
+    // The local (our) and remote tunnel endpoints.
+    char* local_ip;
+    char* remote_ip;
+} typedef tunnel_cfg_t;
+
 struct fwd_rule_cfg
 {
     int set;
@@ -23,8 +41,47 @@ struct fwd_rule_cfg
     u16 bind_port;
     char* protocol;
 
+    // If above bind_port, the rule covers the bind ports bind_port - bind_port_end.
+    u16 bind_port_end;
+
+    // If set, each bind port of a range is forwarded to the destination port plus its offset in the range. Otherwise, all bind ports are forwarded to the destination port.
+    int port_offset;
+
     char* dst_ip;
     u16 dst_port;
+
+    // If set, connections are spread across the backends instead of forwarded to the destination IP and port.
+    int backends_cnt;
+    fwd_backend_cfg_t backends[MAX_BACKENDS];
+
+    char* snat_ip;
+
+    int health_check;
+
+    // Token bucket policers of the whole rule and of each client (0 = unlimited). Bandwidth is in bits per second.
+    u64 policer_pps;
+    u64 policer_bps;
+    u64 policer_client_pps;
+    u64 policer_client_bps;
+
+    // The new connections per second each client may create through the rule and how many it may create at once (0 = unlimited, burst 0 = one second worth).
+    int conn_rate_limit;
+    int conn_rate_burst;
+
+    // If set, TCP SYNs are answered with SYN cookies and the connection is only forwarded once the client's ACK validates.
+    int syn_cookies;
+
+    // If set, new connections that can't be given a backend or source port are answered with a TCP RST or ICMP port unreachable instead of dropped.
+    int fast_reject;
+
+    // If set (ipip, gue, or gre), packets are encapsulated towards the backends which answer clients directly (Direct Server Return).
+    char* dsr;
+
+    int tcp_est_timeout;
+    int tcp_close_timeout;
+    int tcp_time_wait_timeout;
+    int udp_timeout;
+    int icmp_timeout;
 } typedef fwd_rule_cfg_t;
 
 struct config
@@ -37,9 +94,23 @@ struct config
     unsigned int stats_per_second : 1;
     int stdout_update_time;
 
+    int tcp_est_timeout;
+    int tcp_close_timeout;
+    int tcp_time_wait_timeout;
+    int udp_timeout;
+    int icmp_timeout;
+
+    int health_check_interval;
+    int health_check_timeout;
+    int health_check_rise;
+    int health_check_fall;
+
     int interfaces_cnt;
     char* interfaces[MAX_INTERFACES];
 
+    int tunnels_cnt;
+    tunnel_cfg_t tunnels[MAX_TUNNELS];
+
     int rules_cnt;
     fwd_rule_cfg_t rules[MAX_FWD_RULES];
 } typedef config__t; // config_t is taken by libconfig -.-
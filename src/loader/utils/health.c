@@ -0,0 +1,362 @@
+#include <loader/utils/health.h>
+
+/**
+ * Retrieves the current monotonic time in milliseconds.
+ * 
+ * @return The current time in milliseconds.
+ */
+static u64 get_time_ms()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (u64)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * Pushes a backend's health state into the backends BPF map so the XDP program skips it when it's down.
+ * 
+ * @param check A pointer to the health check.
+ * @param map_backends The backends BPF map FD.
+ * 
+ * @return 0 on success or error value of bpf_map_lookup_elem()/bpf_map_update_elem().
+ */
+static int push_backend_health(health_check_t* check, int map_backends)
+{
+    int ret;
+
+    u32 key = (check->rule_id * MAX_BACKENDS) + check->backend_idx;
+
+    backend_t backend;
+
+    if ((ret = bpf_map_lookup_elem(map_backends, &key, &backend)) != 0)
+    {
+        return ret;
+    }
+
+    // Don't touch the entry if the rule's backends changed in the meantime.
+    if (backend.ip != check->backend.ip || backend.port != check->backend.port)
+    {
+        return 0;
+    }
+
+    backend.down = check->down;
+
+    return bpf_map_update_elem(map_backends, &key, &backend, BPF_ANY);
+}
+
+/**
+ * Records the result of a backend's probe and marks the backend up or down once enough probes in a row agree.
+ * 
+ * @param check A pointer to the health check.
+ * @param success Whether the probe succeeded.
+ * @param map_backends The backends BPF map FD.
+ * @param cfg A pointer to the config structure.
+ * 
+ * @return void
+ */
+static void finish_health_check(health_check_t* check, int success, int map_backends, config__t* cfg)
+{
+    if (check->sock >= 0)
+    {
+        close(check->sock);
+
+        check->sock = -1;
+    }
+
+    if (success)
+    {
+        check->successes++;
+        check->failures = 0;
+    }
+    else
+    {
+        check->failures++;
+        check->successes = 0;
+    }
+
+    int down = check->down;
+
+    if (check->down && check->successes >= cfg->health_check_rise)
+    {
+        down = 0;
+    }
+    else if (!check->down && check->failures >= cfg->health_check_fall)
+    {
+        down = 1;
+    }
+
+    if (down == check->down)
+    {
+        return;
+    }
+
+    check->down = down;
+
+    char ip_str[INET6_ADDRSTRLEN];
+    ip_addr_to_str(check->backend.ip, ip_str, sizeof(ip_str));
+
+    log_msg(cfg, 1, 0, "[HEALTH] Backend '%s:%d' (%s) of rule #%u is %s.", ip_str, ntohs(check->backend.port), get_protocol_str_by_id(check->protocol), check->rule_id, (down) ? "down" : "up");
+
+    int ret;
+
+    if ((ret = push_backend_health(check, map_backends)) != 0)
+    {
+        log_msg(cfg, 1, 0, "[WARNING] Failed to update health of backend '%s:%d' (%d)...", ip_str, ntohs(check->backend.port), ret);
+    }
+}
+
+/**
+ * Starts a backend's probe. TCP backends must accept a connection. UDP backends are sent an empty datagram and must not answer with an ICMP port unreachable message.
+ * 
+ * @param check A pointer to the health check.
+ * @param now The current time in milliseconds.
+ * @param map_backends The backends BPF map FD.
+ * @param cfg A pointer to the config structure.
+ * 
+ * @return void
+ */
+static void start_health_check(health_check_t* check, u64 now, int map_backends, config__t* cfg)
+{
+    int type = (check->protocol == IPPROTO_TCP) ? SOCK_STREAM : SOCK_DGRAM;
+
+    check->next_check = now + (u64)cfg->health_check_interval * 1000;
+
+    if ((check->sock = socket(check->addr.ss_family, type | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0)
+    {
+        return;
+    }
+
+    check->started = now;
+
+    if (connect(check->sock, (struct sockaddr*)&check->addr, check->addr_len) != 0 && errno != EINPROGRESS)
+    {
+        finish_health_check(check, 0, map_backends, cfg);
+
+        return;
+    }
+
+    if (type == SOCK_DGRAM && send(check->sock, NULL, 0, 0) < 0 && errno == ECONNREFUSED)
+    {
+        finish_health_check(check, 0, map_backends, cfg);
+    }
+}
+
+/**
+ * Rebuilds the health checks from the forward rules that enable them. Checks of unchanged backends keep their state.
+ * 
+ * @param hc A pointer to the health checks.
+ * @param map_fwd_rules The forward rules BPF map FD.
+ * @param map_fwd_rule_ranges The forward rule ranges BPF map FD (-1 if port ranges are disabled).
+ * @param map_fwd_rule_prefixes The forward rule prefixes BPF map FD (-1 if bind prefixes are disabled).
+ * @param map_backends The backends BPF map FD.
+ * @param cfg A pointer to the config structure.
+ * 
+ * @return void
+ */
+void update_health_checks(health_checks_t* hc, int map_fwd_rules, int map_fwd_rule_ranges, int map_fwd_rule_prefixes, int map_backends, config__t* cfg)
+{
+    // The previous checks are kept on the heap so their state can be carried over.
+    health_check_t* old = NULL;
+    int old_cnt = hc->cnt;
+
+    if (old_cnt > 0 && (old = malloc(sizeof(*old) * old_cnt)) != NULL)
+    {
+        memcpy(old, hc->checks, sizeof(*old) * old_cnt);
+    }
+
+    hc->cnt = 0;
+
+    for (int i = 0; i < cfg->rules_cnt && cfg->health_check_interval > 0; i++)
+    {
+        fwd_rule_cfg_t* rule = &cfg->rules[i];
+
+        if (!rule->set || !rule->enabled || !rule->health_check)
+        {
+            continue;
+        }
+
+        fwd_rule_key_t key;
+        fwd_rule_val_t val;
+        u8 bind_prefixlen;
+
+        if (get_fwd_rule_key(rule, &key, NULL, &bind_prefixlen) != 0 || get_fwd_rule_val(map_fwd_rules, map_fwd_rule_ranges, map_fwd_rule_prefixes, &key, bind_prefixlen, &val) != 0)
+        {
+            continue;
+        }
+
+        // Only TCP and UDP backends are probed (single backends as well so new connections to them are dropped or rejected while they're down).
+        if (key.protocol != IPPROTO_TCP && key.protocol != IPPROTO_UDP)
+        {
+            continue;
+        }
+
+        for (u32 j = 0; j < val.backends_cnt && j < MAX_BACKENDS; j++)
+        {
+            u32 backend_key = (val.id * MAX_BACKENDS) + j;
+
+            health_check_t* check = &hc->checks[hc->cnt];
+            memset(check, 0, sizeof(*check));
+
+            if (bpf_map_lookup_elem(map_backends, &backend_key, &check->backend) != 0)
+            {
+                continue;
+            }
+
+            check->rule_id = val.id;
+            check->backend_idx = j;
+            check->protocol = key.protocol;
+            check->sock = -1;
+
+            struct in6_addr ip6;
+            memcpy(&ip6, &check->backend.ip, sizeof(ip6));
+
+            if (IN6_IS_ADDR_V4MAPPED(&ip6))
+            {
+                struct sockaddr_in* addr = (struct sockaddr_in*)&check->addr;
+
+                addr->sin_family = AF_INET;
+                addr->sin_port = check->backend.port;
+                memcpy(&addr->sin_addr, &ip6.s6_addr[12], sizeof(addr->sin_addr));
+
+                check->addr_len = sizeof(*addr);
+            }
+            else
+            {
+                struct sockaddr_in6* addr = (struct sockaddr_in6*)&check->addr;
+
+                addr->sin6_family = AF_INET6;
+                addr->sin6_port = check->backend.port;
+                memcpy(&addr->sin6_addr, &ip6, sizeof(addr->sin6_addr));
+
+                check->addr_len = sizeof(*addr);
+            }
+
+            // Carry over the state of the same backend.
+            for (int k = 0; k < old_cnt && old; k++)
+            {
+                health_check_t* prev = &old[k];
+
+                if (prev->rule_id == check->rule_id && prev->protocol == check->protocol && prev->backend.ip == check->backend.ip && prev->backend.port == check->backend.port)
+                {
+                    check->down = prev->down;
+                    check->successes = prev->successes;
+                    check->failures = prev->failures;
+                    check->next_check = prev->next_check;
+
+                    // Keep the running probe.
+                    check->sock = prev->sock;
+                    check->started = prev->started;
+
+                    prev->sock = -1;
+
+                    break;
+                }
+            }
+
+            // The loader resets backends to up when updating rules.
+            if (check->down)
+            {
+                push_backend_health(check, map_backends);
+            }
+
+            hc->cnt++;
+        }
+    }
+
+    // Close the probes of removed backends.
+    for (int k = 0; k < old_cnt && old; k++)
+    {
+        if (old[k].sock >= 0)
+        {
+            close(old[k].sock);
+        }
+    }
+
+    free(old);
+}
+
+/**
+ * Starts due probes and collects the results of running ones. This doesn't block.
+ * 
+ * @param hc A pointer to the health checks.
+ * @param map_backends The backends BPF map FD.
+ * @param cfg A pointer to the config structure.
+ * 
+ * @return void
+ */
+void poll_health_checks(health_checks_t* hc, int map_backends, config__t* cfg)
+{
+    u64 now = get_time_ms();
+
+    for (int i = 0; i < hc->cnt; i++)
+    {
+        health_check_t* check = &hc->checks[i];
+
+        if (check->sock < 0)
+        {
+            if (now >= check->next_check)
+            {
+                start_health_check(check, now, map_backends, cfg);
+            }
+
+            continue;
+        }
+
+        struct pollfd pfd = {0};
+        pfd.fd = check->sock;
+        pfd.events = (check->protocol == IPPROTO_TCP) ? POLLOUT : POLLIN;
+
+        if (poll(&pfd, 1, 0) > 0)
+        {
+            int success = 0;
+
+            if (check->protocol == IPPROTO_TCP)
+            {
+                int err = 0;
+                socklen_t len = sizeof(err);
+
+                success = getsockopt(check->sock, SOL_SOCKET, SO_ERROR, &err, &len) == 0 && err == 0;
+            }
+            else
+            {
+                // Connected UDP sockets report ICMP port unreachable messages as ECONNREFUSED.
+                char buf[1];
+
+                success = recv(check->sock, buf, sizeof(buf), 0) >= 0 || errno != ECONNREFUSED;
+            }
+
+            finish_health_check(check, success, map_backends, cfg);
+        }
+        else if (now - check->started >= (u64)cfg->health_check_timeout)
+        {
+            // UDP backends that stay silent are considered up.
+            finish_health_check(check, check->protocol == IPPROTO_UDP, map_backends, cfg);
+        }
+    }
+}
+
+/**
+ * Closes the sockets of running probes.
+ * 
+ * @param hc A pointer to the health checks.
+ * 
+ * @return void
+ */
+void close_health_checks(health_checks_t* hc)
+{
+    for (int i = 0; i < hc->cnt; i++)
+    {
+        health_check_t* check = &hc->checks[i];
+
+        if (check->sock >= 0)
+        {
+            close(check->sock);
+
+            check->sock = -1;
+        }
+    }
+
+    hc->cnt = 0;
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <xdp/libxdp.h>
+
+#include <common/all.h>
+
+#include <loader/utils/config.h>
+#include <loader/utils/helpers.h>
+#include <loader/utils/logging.h>
+#include <loader/utils/xdp.h>
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+struct health_check
+{
+    u32 rule_id;
+    u32 backend_idx;
+
+    backend_t backend;
+    u8 protocol;
+
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+
+    // The probe's socket (-1 when no probe is running).
+    int sock;
+    u64 started;
+    u64 next_check;
+
+    int down;
+    int successes;
+    int failures;
+} typedef health_check_t;
+
+struct health_checks
+{
+    int cnt;
+    health_check_t checks[MAX_FWD_RULES * MAX_BACKENDS];
+} typedef health_checks_t;
+
+void update_health_checks(health_checks_t* hc, int map_fwd_rules, int map_fwd_rule_ranges, int map_fwd_rule_prefixes, int map_backends, config__t* cfg);
+void poll_health_checks(health_checks_t* hc, int map_backends, config__t* cfg);
+void close_health_checks(health_checks_t* hc);
\ No newline at end of file
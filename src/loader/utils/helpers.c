@@ -14,6 +14,7 @@ void print_help_menu()
     printf("  -s, --skb                     Force the XDP program to load with SKB mode instead of DRV.\n");
     printf("  -t, --time <seconds>          Duration to run the program (seconds). 0 or unset = infinite.\n");
     printf("  -l, --list                    Print config details including rules (exits after execution).\n");
+    printf("  -f, --flows <count>           Print the connections with the most bytes of the running program (exits after execution).\n");
     printf("  -h, --help                    Show this help message.\n\n");
     
     printf("  -v, --verbose <lvl>           Override config's verbose value.\n");
@@ -70,6 +71,136 @@ ip_range_t parse_ip_range(const char *ip)
     return ret;
 }
 
+/**
+ * Parses an IPv4 or IPv6 address string. IPv4 addresses are stored as IPv4-mapped IPv6 addresses (::ffff:a.b.c.d).
+ * 
+ * @param ip The IP string.
+ * @param addr Where to store the address in network byte order.
+ * 
+ * @return The address family (AF_INET or AF_INET6) or -1 if the string isn't a valid address.
+ */
+int parse_ip_addr(const char* ip, u128* addr)
+{
+    struct in6_addr ip6;
+    struct in_addr ip4;
+
+    if (inet_pton(AF_INET6, ip, &ip6) == 1)
+    {
+        memcpy(addr, &ip6, sizeof(*addr));
+
+        return IN6_IS_ADDR_V4MAPPED(&ip6) ? AF_INET : AF_INET6;
+    }
+
+    if (inet_pton(AF_INET, ip, &ip4) == 1)
+    {
+        memset(&ip6, 0, sizeof(ip6));
+
+        ip6.s6_addr[10] = 0xff;
+        ip6.s6_addr[11] = 0xff;
+
+        memcpy(&ip6.s6_addr[12], &ip4.s_addr, sizeof(ip4.s_addr));
+        memcpy(addr, &ip6, sizeof(*addr));
+
+        return AF_INET;
+    }
+
+    return -1;
+}
+
+/**
+ * Parses an IPv4 or IPv6 address string with an optional prefix length (e.g. 10.0.0.0/24 or 2001:db8::/32). IPv4 prefixes are stored as IPv4-mapped IPv6 prefixes.
+ * 
+ * @param ip The IP string.
+ * @param addr Where to store the address in network byte order (bits outside of the prefix are cleared).
+ * @param prefixlen Where to store the prefix length in IPv6 bits (128 if the string doesn't have a prefix length).
+ * 
+ * @return The address family (AF_INET or AF_INET6) or -1 if the string isn't a valid address or prefix.
+ */
+int parse_ip_prefix(const char* ip, u128* addr, u8* prefixlen)
+{
+    char buf[INET6_ADDRSTRLEN + 4];
+    strncpy(buf, ip, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+
+    char* slash = strchr(buf, '/');
+
+    if (slash)
+    {
+        *slash = '\0';
+    }
+
+    int family;
+
+    if ((family = parse_ip_addr(buf, addr)) < 0)
+    {
+        return -1;
+    }
+
+    int len = (family == AF_INET) ? 32 : 128;
+
+    if (slash)
+    {
+        char* end;
+        long cidr = strtol(slash + 1, &end, 10);
+
+        if (end == slash + 1 || *end != '\0' || cidr < 0 || cidr > len)
+        {
+            return -1;
+        }
+
+        len = cidr;
+    }
+
+    // IPv4 prefixes start after the IPv4-mapped prefix (::ffff:0:0/96).
+    *prefixlen = (family == AF_INET) ? 96 + len : len;
+
+    struct in6_addr ip6;
+    memcpy(&ip6, addr, sizeof(ip6));
+
+    for (int i = 0; i < 16; i++)
+    {
+        int bits = *prefixlen - (i * 8);
+
+        if (bits <= 0)
+        {
+            ip6.s6_addr[i] = 0;
+        }
+        else if (bits < 8)
+        {
+            ip6.s6_addr[i] &= (u8)(0xff << (8 - bits));
+        }
+    }
+
+    memcpy(addr, &ip6, sizeof(*addr));
+
+    return family;
+}
+
+/**
+ * Converts an address stored by parse_ip_addr() to a string.
+ * 
+ * @param addr The address in network byte order.
+ * @param str Where to store the string.
+ * @param len The size of the string buffer (INET6_ADDRSTRLEN recommended).
+ * 
+ * @return void
+ */
+void ip_addr_to_str(u128 addr, char* str, socklen_t len)
+{
+    struct in6_addr ip6;
+
+    memcpy(&ip6, &addr, sizeof(ip6));
+
+    if (IN6_IS_ADDR_V4MAPPED(&ip6))
+    {
+        inet_ntop(AF_INET, &ip6.s6_addr[12], str, len);
+    }
+    else
+    {
+        inet_ntop(AF_INET6, &ip6, str, len);
+    }
+}
+
 /**
  * Retrieves protocol name by ID.
  * 
@@ -89,6 +220,9 @@ const char* get_protocol_str_by_id(int id)
         
         case IPPROTO_ICMP:
             return "ICMP";
+
+        case IPPROTO_ICMPV6:
+            return "ICMPv6";
     }
 
     return "N/A";
@@ -121,6 +255,33 @@ int get_protocol_id_by_str(char* name)
     return -1;
 }
 
+/**
+ * Retrieves the tunnel type by name.
+ * 
+ * @param name The tunnel type name (ipip, gue, or gre).
+ * 
+ * @return The tunnel type (TUNNEL_*) or -1 on failure.
+ */
+int get_tunnel_type_by_str(char* name)
+{
+    lower_str(name);
+
+    if (strcmp(name, "ipip") == 0)
+    {
+        return TUNNEL_IPIP;
+    }
+    else if (strcmp(name, "gue") == 0)
+    {
+        return TUNNEL_GUE;
+    }
+    else if (strcmp(name, "gre") == 0)
+    {
+        return TUNNEL_GRE;
+    }
+
+    return -1;
+}
+
 /**
  * Prints tool name and author.
  * 
@@ -23,9 +23,13 @@ extern int cont;
 void print_help_menu();
 void signal_hndl(int code);
 ip_range_t parse_ip_range(const char* ip);
+int parse_ip_addr(const char* ip, u128* addr);
+int parse_ip_prefix(const char* ip, u128* addr, u8* prefixlen);
+void ip_addr_to_str(u128 addr, char* str, socklen_t len);
 
 const char* get_protocol_str_by_id(int id);
 int get_protocol_id_by_str(char* name);
+int get_tunnel_type_by_str(char* name);
 
 void print_tool_info();
 u64 get_boot_nano_time();
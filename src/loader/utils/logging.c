@@ -147,9 +147,9 @@ int handle_fwd_rules_rb_event(void* ctx, void* data, size_t sz)
     char dst_ip_str[INET6_ADDRSTRLEN];
     u16 dst_port = ntohs(e->dst_port);
 
-    inet_ntop(AF_INET, &e->src_ip, src_ip_str, sizeof(src_ip_str));
-    inet_ntop(AF_INET, &e->bind_ip, bind_ip_str, sizeof(bind_ip_str));
-    inet_ntop(AF_INET, &e->dst_ip, dst_ip_str, sizeof(dst_ip_str));
+    ip_addr_to_str(e->src_ip, src_ip_str, sizeof(src_ip_str));
+    ip_addr_to_str(e->bind_ip, bind_ip_str, sizeof(bind_ip_str));
+    ip_addr_to_str(e->dst_ip, dst_ip_str, sizeof(dst_ip_str));
 
     log_msg(cfg, 0, 0, "[FWD] Created %s connection '%s:%d' => '%s:%d' (to '%s:%d'). Using source port %d...", protocol_str, src_ip_str, src_port, bind_ip_str, bind_port, dst_ip_str, dst_port, port);
 
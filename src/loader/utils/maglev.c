@@ -0,0 +1,157 @@
+#include <loader/utils/maglev.h>
+
+/**
+ * Hashes a backend's address and port (FNV-1a).
+ * 
+ * @param backend A pointer to the backend.
+ * @param seed The seed to start with (different seeds give independent hashes).
+ * 
+ * @return The 32-bit hash.
+ */
+static u32 get_backend_hash(backend_t* backend, u32 seed)
+{
+    u8 data[sizeof(backend->ip) + sizeof(backend->port)];
+
+    memcpy(data, &backend->ip, sizeof(backend->ip));
+    memcpy(data + sizeof(backend->ip), &backend->port, sizeof(backend->port));
+
+    u32 hash = 2166136261u ^ seed;
+
+    for (size_t i = 0; i < sizeof(data); i++)
+    {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+/**
+ * Builds a Maglev lookup table. Each backend walks its own permutation of the table's slots and claims the next free slot on its turn.
+ * A backend receives as many turns per round as its weight. Since permutations only depend on the backend itself, most slots keep their backend when other backends are added or removed.
+ * 
+ * @param backends The backends.
+ * @param weights The backends' weights (a weight of 0 excludes the backend).
+ * @param backends_cnt The amount of backends (up to MAX_BACKENDS).
+ * @param table Where to store the table (MAGLEV_TABLE_SIZE backend indexes).
+ * 
+ * @return 0 on success or 1 if there are no backends with a weight.
+ */
+int build_maglev_table(backend_t* backends, int* weights, int backends_cnt, u32* table)
+{
+    u32 offset[MAX_BACKENDS];
+    u32 skip[MAX_BACKENDS];
+    u32 next[MAX_BACKENDS];
+
+    int weighted = 0;
+
+    if (backends_cnt > MAX_BACKENDS)
+    {
+        backends_cnt = MAX_BACKENDS;
+    }
+
+    for (int i = 0; i < backends_cnt; i++)
+    {
+        offset[i] = get_backend_hash(&backends[i], 0) % MAGLEV_TABLE_SIZE;
+        skip[i] = (get_backend_hash(&backends[i], 0x9e3779b9) % (MAGLEV_TABLE_SIZE - 1)) + 1;
+        next[i] = 0;
+
+        if (weights[i] > 0)
+        {
+            weighted = 1;
+        }
+    }
+
+    if (!weighted)
+    {
+        return 1;
+    }
+
+    for (u32 slot = 0; slot < MAGLEV_TABLE_SIZE; slot++)
+    {
+        table[slot] = MAGLEV_SLOT_EMPTY;
+    }
+
+    u32 filled = 0;
+
+    while (filled < MAGLEV_TABLE_SIZE)
+    {
+        for (int i = 0; i < backends_cnt && filled < MAGLEV_TABLE_SIZE; i++)
+        {
+            for (int turn = 0; turn < weights[i] && filled < MAGLEV_TABLE_SIZE; turn++)
+            {
+                u32 slot;
+
+                // The table size is prime so the permutation visits every slot.
+                do
+                {
+                    slot = (offset[i] + (u64)next[i] * skip[i]) % MAGLEV_TABLE_SIZE;
+                    next[i]++;
+                } while (table[slot] != MAGLEV_SLOT_EMPTY);
+
+                table[slot] = i;
+                filled++;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Builds a forward rule's Maglev lookup table and swaps it into the Maglev BPF map.
+ * 
+ * @param map_maglev The Maglev (outer) BPF map FD.
+ * @param id The forward rule's ID.
+ * @param backends The backends.
+ * @param weights The backends' weights.
+ * @param backends_cnt The amount of backends.
+ * 
+ * @return 0 on success, 1 if the table couldn't be built, or the error value of bpf_map_create() or bpf_map_update_elem().
+ */
+int update_maglev_table(int map_maglev, u32 id, backend_t* backends, int* weights, int backends_cnt)
+{
+    int ret;
+
+    // The table is too large for the stack with bigger table sizes.
+    u32* table = malloc(sizeof(*table) * MAGLEV_TABLE_SIZE);
+
+    if (!table)
+    {
+        return 1;
+    }
+
+    if ((ret = build_maglev_table(backends, weights, backends_cnt, table)) != 0)
+    {
+        free(table);
+
+        return ret;
+    }
+
+    // Fill a new table first so the XDP program never sees a partially built one.
+    int map_table = bpf_map_create(BPF_MAP_TYPE_ARRAY, "maglev_table", sizeof(u32), sizeof(u32), MAGLEV_TABLE_SIZE, NULL);
+
+    if (map_table < 0)
+    {
+        free(table);
+
+        return map_table;
+    }
+
+    for (u32 slot = 0; slot < MAGLEV_TABLE_SIZE; slot++)
+    {
+        if ((ret = bpf_map_update_elem(map_table, &slot, &table[slot], BPF_ANY)) != 0)
+        {
+            goto out;
+        }
+    }
+
+    // The previous table is released by the kernel once it is replaced.
+    ret = bpf_map_update_elem(map_maglev, &id, &map_table, BPF_ANY);
+
+    out:
+        close(map_table);
+        free(table);
+
+        return ret;
+}
\ No newline at end of file
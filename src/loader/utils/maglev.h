@@ -0,0 +1,14 @@
+#pragma once
+
+#include <xdp/libxdp.h>
+
+#include <common/all.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAGLEV_SLOT_EMPTY 0xffffffff
+
+int build_maglev_table(backend_t* backends, int* weights, int backends_cnt, u32* table);
+int update_maglev_table(int map_maglev, u32 id, backend_t* backends, int* weights, int backends_cnt);
\ No newline at end of file
@@ -0,0 +1,180 @@
+#include <loader/utils/netlink.h>
+
+/**
+ * Opens a netlink socket subscribed to neighbor and route updates.
+ * 
+ * @return The socket FD on success or -1 on failure.
+ */
+int open_netlink_sock()
+{
+    int sock = socket(AF_NETLINK, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_ROUTE);
+
+    if (sock < 0)
+    {
+        return -1;
+    }
+
+    struct sockaddr_nl addr = {0};
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = RTMGRP_NEIGH | RTMGRP_IPV4_ROUTE | RTMGRP_IPV6_ROUTE;
+
+    if (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0)
+    {
+        close(sock);
+
+        return -1;
+    }
+
+    return sock;
+}
+
+/**
+ * Removes FIB cache entries matching a next hop (or all entries).
+ * 
+ * @param map_fib_cache The FIB cache BPF map FD.
+ * @param nh_ip A pointer to the next hop address or NULL to remove all entries.
+ * 
+ * @return void
+ */
+static void delete_fib_cache_entries(int map_fib_cache, u128* nh_ip)
+{
+    u128 key;
+    u128 next_key;
+
+    fib_entry_t entry;
+
+    int ret = bpf_map_get_next_key(map_fib_cache, NULL, &key);
+
+    while (ret == 0)
+    {
+        // Retrieve the next key before the current one is deleted.
+        ret = bpf_map_get_next_key(map_fib_cache, &key, &next_key);
+
+        if (!nh_ip || (bpf_map_lookup_elem(map_fib_cache, &key, &entry) == 0 && entry.nh_ip == *nh_ip))
+        {
+            bpf_map_delete_elem(map_fib_cache, &key);
+        }
+
+        key = next_key;
+    }
+}
+
+/**
+ * Removes all entries from the FIB cache.
+ * 
+ * @param map_fib_cache The FIB cache BPF map FD.
+ * 
+ * @return void
+ */
+void flush_fib_cache(int map_fib_cache)
+{
+    delete_fib_cache_entries(map_fib_cache, NULL);
+}
+
+/**
+ * Removes FIB cache entries using a next hop.
+ * 
+ * @param map_fib_cache The FIB cache BPF map FD.
+ * @param nh_ip The next hop address (IPv4 addresses are IPv4-mapped).
+ * 
+ * @return void
+ */
+void invalidate_fib_cache(int map_fib_cache, u128 nh_ip)
+{
+    delete_fib_cache_entries(map_fib_cache, &nh_ip);
+}
+
+/**
+ * Retrieves the neighbor address from a neighbor netlink message.
+ * 
+ * @param nh A pointer to the netlink message.
+ * @param addr Where to store the address (IPv4 addresses are IPv4-mapped).
+ * 
+ * @return 0 on success or 1 if the message doesn't contain an IPv4 or IPv6 neighbor address.
+ */
+static int get_neigh_addr(struct nlmsghdr* nh, u128* addr)
+{
+    struct ndmsg* nd = NLMSG_DATA(nh);
+
+    int len = RTM_PAYLOAD(nh);
+
+    for (struct rtattr* attr = RTM_RTA(nd); RTA_OK(attr, len); attr = RTA_NEXT(attr, len))
+    {
+        if (attr->rta_type != NDA_DST)
+        {
+            continue;
+        }
+
+        if (nd->ndm_family == AF_INET && RTA_PAYLOAD(attr) == sizeof(u32))
+        {
+            struct in6_addr ip6 = {0};
+
+            ip6.s6_addr[10] = 0xff;
+            ip6.s6_addr[11] = 0xff;
+
+            memcpy(&ip6.s6_addr[12], RTA_DATA(attr), sizeof(u32));
+            memcpy(addr, &ip6, sizeof(*addr));
+
+            return 0;
+        }
+
+        if (nd->ndm_family == AF_INET6 && RTA_PAYLOAD(attr) == sizeof(u128))
+        {
+            memcpy(addr, RTA_DATA(attr), sizeof(*addr));
+
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/**
+ * Reads pending neighbor and route updates from the netlink socket and invalidates the FIB cache accordingly.
+ * 
+ * Neighbor updates remove the entries using the neighbor as their next hop while route updates flush the whole cache.
+ * 
+ * @param sock The netlink socket FD.
+ * @param map_fib_cache The FIB cache BPF map FD.
+ * 
+ * @return void
+ */
+void poll_netlink_sock(int sock, int map_fib_cache)
+{
+    char buf[8192];
+    int len;
+
+    while ((len = recv(sock, buf, sizeof(buf), 0)) > 0)
+    {
+        for (struct nlmsghdr* nh = (struct nlmsghdr*)buf; NLMSG_OK(nh, len); nh = NLMSG_NEXT(nh, len))
+        {
+            switch (nh->nlmsg_type)
+            {
+                case RTM_NEWROUTE:
+                case RTM_DELROUTE:
+                    flush_fib_cache(map_fib_cache);
+
+                    break;
+
+                case RTM_NEWNEIGH:
+                case RTM_DELNEIGH:
+                {
+                    u128 addr;
+
+                    if (get_neigh_addr(nh, &addr) == 0)
+                    {
+                        invalidate_fib_cache(map_fib_cache, addr);
+                    }
+
+                    break;
+                }
+            }
+        }
+    }
+
+    // Updates were lost since the socket buffer overflowed, so we can't tell which entries are stale.
+    if (len < 0 && errno == ENOBUFS)
+    {
+        flush_fib_cache(map_fib_cache);
+    }
+}
\ No newline at end of file
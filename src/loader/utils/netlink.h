@@ -0,0 +1,23 @@
+#pragma once
+
+#include <xdp/libxdp.h>
+
+#include <common/all.h>
+
+#include <loader/utils/config.h>
+#include <loader/utils/helpers.h>
+
+#include <errno.h>
+#include <unistd.h>
+
+#include <sys/socket.h>
+
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/neighbour.h>
+
+int open_netlink_sock();
+void poll_netlink_sock(int sock, int map_fib_cache);
+
+void flush_fib_cache(int map_fib_cache);
+void invalidate_fib_cache(int map_fib_cache, u128 nh_ip);
\ No newline at end of file
@@ -1,10 +1,20 @@
 #include <loader/utils/stats.h>
 
+// The amount of connections read from the connection stats map at once.
+#define CONN_STATS_BATCH_SIZE 256
+
+struct conn_stats_entry
+{
+    conn_key_t key;
+    conn_stats_t stats;
+} typedef conn_stats_entry_t;
+
 struct timespec last_update_time = {0};
 
 u64 last_forwarded = 0;
 u64 last_passed = 0;
 u64 last_dropped = 0;
+u64 last_evicted = 0;
 
 /**
  * Calculates and displays packet counters/stats.
@@ -25,6 +35,7 @@ int calc_stats(int map_stats, int cpus, int per_second)
     u64 forwarded = 0;
     u64 passed = 0;
     u64 dropped = 0;
+    u64 evicted = 0;
     
     if (bpf_map_lookup_elem(map_stats, &key, stats) != 0)
     {
@@ -41,11 +52,13 @@ int calc_stats(int map_stats, int cpus, int per_second)
         forwarded += stats[i].forwarded;
         passed += stats[i].passed;
         dropped += stats[i].dropped;
+        evicted += stats[i].evicted;
     }
 
     u64 forwarded_val = forwarded;
     u64 passed_val = passed;
     u64 dropped_val = dropped;
+    u64 evicted_val = evicted;
 
     if (per_second)
     {
@@ -60,11 +73,13 @@ int calc_stats(int map_stats, int cpus, int per_second)
             forwarded_val = (forwarded - last_forwarded) / elapsed_time;
             passed_val = (passed - last_passed) / elapsed_time;
             dropped_val = (dropped - last_dropped) / elapsed_time;
+            evicted_val = (evicted - last_evicted) / elapsed_time;
         }
 
         last_forwarded = forwarded;
         last_passed = passed;
         last_dropped = dropped;
+        last_evicted = evicted;
 
         last_update_time = now;
     }
@@ -72,25 +87,277 @@ int calc_stats(int map_stats, int cpus, int per_second)
     char forwarded_str[12];
     char passed_str[12];
     char dropped_str[12];
+    char evicted_str[12];
 
     if (per_second)
     {
         snprintf(forwarded_str, sizeof(forwarded_str), "%llu PPS", forwarded_val);
         snprintf(passed_str, sizeof(passed_str), "%llu PPS", passed_val);
         snprintf(dropped_str, sizeof(dropped_str), "%llu PPS", dropped_val);
+        snprintf(evicted_str, sizeof(evicted_str), "%llu/s", evicted_val);
     }
     else
     {
         snprintf(forwarded_str, sizeof(forwarded_str), "%llu", forwarded_val);
         snprintf(passed_str, sizeof(passed_str), "%llu", passed_val);
         snprintf(dropped_str, sizeof(dropped_str), "%llu", dropped_val);
+        snprintf(evicted_str, sizeof(evicted_str), "%llu", evicted_val);
     }
     
     printf("\r\033[1;32mForwarded:\033[0m %s  |  ", forwarded_str);
     printf("\033[1;34mPassed:\033[0m %s  |  ", passed_str);
-    printf("\033[1;31mDropped:\033[0m %s", dropped_str);
+    printf("\033[1;31mDropped:\033[0m %s  |  ", dropped_str);
+    printf("\033[1;33mEvicted:\033[0m %s", evicted_str);
 
     fflush(stdout);    
 
     return EXIT_SUCCESS;
+}
+
+/**
+ * Calculates the counters of a forward rule by adding up the counters of each CPU.
+ * 
+ * @param map_fwd_rule_stats The forward rule stats BPF map FD.
+ * @param id The rule's ID.
+ * @param cpus The amount of CPUs the host has.
+ * @param rule_stats Where to store the counters.
+ * 
+ * @return 0 on success or 1 on failure.
+ */
+int calc_fwd_rule_stats(int map_fwd_rule_stats, u32 id, int cpus, fwd_rule_stats_t* rule_stats)
+{
+    fwd_rule_stats_t stats[MAX_CPUS];
+    memset(stats, 0, sizeof(stats));
+
+    memset(rule_stats, 0, sizeof(*rule_stats));
+
+    if (bpf_map_lookup_elem(map_fwd_rule_stats, &id, stats) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    for (int i = 0; i < cpus && i < MAX_CPUS; i++)
+    {
+        rule_stats->new_conns += stats[i].new_conns;
+
+        rule_stats->fwd_packets += stats[i].fwd_packets;
+        rule_stats->fwd_bytes += stats[i].fwd_bytes;
+        rule_stats->fwd_dropped += stats[i].fwd_dropped;
+
+        rule_stats->reply_packets += stats[i].reply_packets;
+        rule_stats->reply_bytes += stats[i].reply_bytes;
+        rule_stats->reply_dropped += stats[i].reply_dropped;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Displays the counters of each loaded forward rule in the config.
+ * 
+ * @param cfg A pointer to the config structure.
+ * @param map_fwd_rules The forward rules BPF map FD.
+ * @param map_fwd_rule_ranges The forward rule ranges BPF map FD (-1 if port ranges are disabled).
+ * @param map_fwd_rule_prefixes The forward rule prefixes BPF map FD (-1 if bind prefixes are disabled).
+ * @param map_fwd_rule_stats The forward rule stats BPF map FD.
+ * @param cpus The amount of CPUs the host has.
+ * 
+ * @return void
+ */
+void print_fwd_rule_stats(config__t* cfg, int map_fwd_rules, int map_fwd_rule_ranges, int map_fwd_rule_prefixes, int map_fwd_rule_stats, int cpus)
+{
+    printf("Rule Stats\n");
+
+    int printed = 0;
+
+    for (int i = 0; i < cfg->rules_cnt; i++)
+    {
+        fwd_rule_cfg_t* rule = &cfg->rules[i];
+
+        if (!rule->set || !rule->enabled)
+        {
+            continue;
+        }
+
+        fwd_rule_key_t key;
+        fwd_rule_val_t val;
+        u8 bind_prefixlen;
+
+        // Rules that aren't loaded have no counters.
+        if (get_fwd_rule_key(rule, &key, NULL, &bind_prefixlen) != 0 || get_fwd_rule_val(map_fwd_rules, map_fwd_rule_ranges, map_fwd_rule_prefixes, &key, bind_prefixlen, &val) != 0)
+        {
+            continue;
+        }
+
+        fwd_rule_stats_t rule_stats;
+
+        if (calc_fwd_rule_stats(map_fwd_rule_stats, val.id, cpus, &rule_stats) != 0)
+        {
+            continue;
+        }
+
+        printf("\tRule #%d ('%s:%d' %s)\n", i + 1, rule->bind_ip, rule->bind_port, rule->protocol);
+        printf("\t\tNew Connections => %llu\n\n", rule_stats.new_conns);
+
+        printf("\t\tForwarded Packets => %llu\n", rule_stats.fwd_packets);
+        printf("\t\tForwarded Bytes => %llu\n", rule_stats.fwd_bytes);
+        printf("\t\tForwarded Dropped => %llu\n\n", rule_stats.fwd_dropped);
+
+        printf("\t\tReply Packets => %llu\n", rule_stats.reply_packets);
+        printf("\t\tReply Bytes => %llu\n", rule_stats.reply_bytes);
+        printf("\t\tReply Dropped => %llu\n\n", rule_stats.reply_dropped);
+
+        printed++;
+    }
+
+    if (!printed)
+    {
+        printf("\t- None\n");
+    }
+}
+
+/**
+ * Compares two connection stats entries by their total bytes (descending).
+ * 
+ * @param a A pointer to the first entry.
+ * @param b A pointer to the second entry.
+ * 
+ * @return The qsort() comparison result.
+ */
+static int cmp_conn_stats_entries(const void* a, const void* b)
+{
+    const conn_stats_entry_t* entry_a = a;
+    const conn_stats_entry_t* entry_b = b;
+
+    u64 bytes_a = entry_a->stats.fwd_bytes + entry_a->stats.reply_bytes;
+    u64 bytes_b = entry_b->stats.fwd_bytes + entry_b->stats.reply_bytes;
+
+    return (bytes_a < bytes_b) - (bytes_a > bytes_b);
+}
+
+/**
+ * Displays the connections with the most bytes. The connection stats map is read in batches and each connection's per-CPU counters are added up.
+ * 
+ * @param map_conn_stats The connection stats BPF map FD.
+ * @param map_connections The connections BPF map FD (used to display each connection's destination, may be -1).
+ * @param cpus The amount of CPUs the host has.
+ * @param top The amount of connections to display.
+ * 
+ * @return 0 on success or the error value of bpf_map_lookup_batch().
+ */
+int print_top_conns(int map_conn_stats, int map_connections, int cpus, int top)
+{
+    int ret = 0;
+
+    conn_key_t keys[CONN_STATS_BATCH_SIZE];
+    conn_stats_t* vals = malloc(sizeof(*vals) * CONN_STATS_BATCH_SIZE * cpus);
+
+    conn_stats_entry_t* entries = NULL;
+    int entries_cnt = 0;
+
+    if (!vals)
+    {
+        return -ENOMEM;
+    }
+
+    u32 in_batch;
+    u32 out_batch;
+    int first = 1;
+
+    while (1)
+    {
+        u32 cnt = CONN_STATS_BATCH_SIZE;
+
+        ret = bpf_map_lookup_batch(map_conn_stats, (first) ? NULL : &in_batch, &out_batch, keys, vals, &cnt, NULL);
+
+        // The last batch returns -ENOENT along with its entries.
+        if (ret != 0 && ret != -ENOENT)
+        {
+            break;
+        }
+
+        if (cnt > 0)
+        {
+            conn_stats_entry_t* new_entries = realloc(entries, sizeof(*entries) * (entries_cnt + cnt));
+
+            if (!new_entries)
+            {
+                ret = -ENOMEM;
+
+                break;
+            }
+
+            entries = new_entries;
+
+            for (u32 i = 0; i < cnt; i++)
+            {
+                conn_stats_entry_t* entry = &entries[entries_cnt++];
+
+                memset(entry, 0, sizeof(*entry));
+                entry->key = keys[i];
+
+                for (int j = 0; j < cpus; j++)
+                {
+                    conn_stats_t* cpu_stats = &vals[(i * cpus) + j];
+
+                    entry->stats.fwd_packets += cpu_stats->fwd_packets;
+                    entry->stats.fwd_bytes += cpu_stats->fwd_bytes;
+                    entry->stats.reply_packets += cpu_stats->reply_packets;
+                    entry->stats.reply_bytes += cpu_stats->reply_bytes;
+                }
+            }
+        }
+
+        if (ret == -ENOENT)
+        {
+            ret = 0;
+
+            break;
+        }
+
+        in_batch = out_batch;
+        first = 0;
+    }
+
+    free(vals);
+
+    if (ret != 0)
+    {
+        free(entries);
+
+        return ret;
+    }
+
+    qsort(entries, entries_cnt, sizeof(*entries), cmp_conn_stats_entries);
+
+    printf("Top Connections (%d of %d)\n", (entries_cnt < top) ? entries_cnt : top, entries_cnt);
+
+    for (int i = 0; i < entries_cnt && i < top; i++)
+    {
+        conn_stats_entry_t* entry = &entries[i];
+
+        char src_ip_str[INET6_ADDRSTRLEN];
+        char bind_ip_str[INET6_ADDRSTRLEN];
+        char dst_ip_str[INET6_ADDRSTRLEN] = "N/A";
+        u16 dst_port = 0;
+
+        ip_addr_to_str(entry->key.src_ip, src_ip_str, sizeof(src_ip_str));
+        ip_addr_to_str(entry->key.bind_ip, bind_ip_str, sizeof(bind_ip_str));
+
+        conn_val_t conn;
+
+        if (map_connections >= 0 && bpf_map_lookup_elem(map_connections, &entry->key, &conn) == 0)
+        {
+            ip_addr_to_str(conn.dst_ip, dst_ip_str, sizeof(dst_ip_str));
+            dst_port = ntohs(conn.dst_port);
+        }
+
+        printf("\t#%d %s '%s:%d' => '%s:%d' (to '%s:%d')\n", i + 1, get_protocol_str_by_id(entry->key.protocol), src_ip_str, ntohs(entry->key.src_port), bind_ip_str, ntohs(entry->key.bind_port), dst_ip_str, dst_port);
+        printf("\t\tForwarded => %llu packets, %llu bytes\n", entry->stats.fwd_packets, entry->stats.fwd_bytes);
+        printf("\t\tReply => %llu packets, %llu bytes\n", entry->stats.reply_packets, entry->stats.reply_bytes);
+    }
+
+    free(entries);
+
+    return 0;
 }
\ No newline at end of file
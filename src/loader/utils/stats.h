@@ -6,7 +6,11 @@
 
 #include <loader/utils/config.h>
 #include <loader/utils/helpers.h>
+#include <loader/utils/xdp.h>
 
 #include <time.h>
 
-int calc_stats(int map_stats, int cpus, int per_second);
\ No newline at end of file
+int calc_stats(int map_stats, int cpus, int per_second);
+int calc_fwd_rule_stats(int map_fwd_rule_stats, u32 id, int cpus, fwd_rule_stats_t* rule_stats);
+void print_fwd_rule_stats(config__t* cfg, int map_fwd_rules, int map_fwd_rule_ranges, int map_fwd_rule_prefixes, int map_fwd_rule_stats, int cpus);
+int print_top_conns(int map_conn_stats, int map_connections, int cpus, int top);
\ No newline at end of file
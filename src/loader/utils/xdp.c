@@ -97,6 +97,60 @@ struct bpf_object* get_bpf_obj(struct xdp_program* prog)
     return xdp_program__bpf_obj(prog);
 }
 
+/**
+ * Resizes the LRU maps with a LRU list for each CPU (BPF_F_NO_COMMON_LRU) so each CPU's list holds PER_CPU_LRU_HEADROOM percent of an even share of the map's entries.
+ * 
+ * The kernel splits a map's entries evenly between the lists of all possible CPUs, so this must be called before the program is loaded (attached).
+ * 
+ * @param prog A pointer to the XDP program.
+ * 
+ * @return 0 on success or 1 on failure.
+ */
+int set_per_cpu_lru_sizes(struct xdp_program* prog)
+{
+    const char* map_names[] = { "map_conn_stats", "map_client_policers", "map_client_policer_tokens", "map_conn_limiters" };
+
+    struct bpf_object* obj = xdp_program__bpf_obj(prog);
+
+    if (!obj)
+    {
+        return 1;
+    }
+
+    int cpus = libbpf_num_possible_cpus();
+
+    if (cpus < 1)
+    {
+        return 1;
+    }
+
+    for (int i = 0; i < sizeof(map_names) / sizeof(map_names[0]); i++)
+    {
+        struct bpf_map* map = bpf_object__find_map_by_name(obj, map_names[i]);
+
+        // The map is disabled in config.h.
+        if (!map)
+        {
+            continue;
+        }
+
+        u64 total = bpf_map__max_entries(map);
+        u64 share = ((total + cpus - 1) / cpus) * PER_CPU_LRU_HEADROOM / 100;
+
+        if (share < 1)
+        {
+            share = 1;
+        }
+
+        if (share * cpus > UINT32_MAX || bpf_map__set_max_entries(map, share * cpus) != 0)
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
 /**
  * Attempts to attach or detach (progfd = -1) a BPF/XDP program to an interface.
  * 
@@ -194,140 +248,807 @@ int attach_xdp(struct xdp_program *prog, char** mode, int ifidx, int detach, int
 }
 
 /**
- * Deletes a forward rule from the BPF map.
+ * Retrieves the protocol ID of a forward rule. ICMP rules with an IPv6 bind address match ICMPv6.
  * 
- * @param map_fwd_rules The forward rules BPF map FD.
- * @param rule The forward rule to delete.
+ * @param protocol_str The protocol name.
+ * @param family The bind address family.
  * 
- * @return 0 on success, 2 on if bind IP or protocol isn't specified, or the error value of bpf_map_delete_elem().
+ * @return The protocol ID or -1 on failure.
  */
-int delete_fwd_rule(int map_fwd_rules, fwd_rule_cfg_t* rule)
+static int get_fwd_rule_protocol(char* protocol_str, int family)
 {
-    int ret;
+    int protocol = get_protocol_id_by_str(protocol_str);
 
+    if (protocol == IPPROTO_ICMP && family == AF_INET6)
+    {
+        return IPPROTO_ICMPV6;
+    }
+
+    return protocol;
+}
+
+/**
+ * Constructs the BPF map key of a forward rule.
+ * 
+ * @param rule A pointer to the config rule.
+ * @param key Where to store the key.
+ * @param bind_family Where to store the bind IP's address family (may be NULL).
+ * @param bind_prefixlen Where to store the bind IP's prefix length in IPv6 bits (128 for single addresses, may be NULL).
+ * 
+ * @return 0 on success, 1 on invalid bind IP, or 2 if bind IP or protocol isn't specified.
+ */
+int get_fwd_rule_key(fwd_rule_cfg_t* rule, fwd_rule_key_t* key, int* bind_family, u8* bind_prefixlen)
+{
     if (!rule->bind_ip || !rule->protocol)
     {
         return 2;
     }
 
-    // Construct key.
-    struct in_addr bind_ip_addr;
+    u128 bind_ip;
+    u8 prefixlen;
+    int family;
 
-    if ((ret = inet_pton(AF_INET, rule->bind_ip, &bind_ip_addr)) != 1)
+    if ((family = parse_ip_prefix(rule->bind_ip, &bind_ip, &prefixlen)) < 0)
     {
-        return ret;
+        return 1;
     }
 
-    u16 bind_port = htons(rule->bind_port);
-
     char protocol_str[64];
     strncpy(protocol_str, rule->protocol, sizeof(protocol_str) - 1);
     protocol_str[sizeof(protocol_str) - 1] = '\0';
 
-    int protocol = get_protocol_id_by_str(protocol_str);
+    memset(key, 0, sizeof(*key));
+    key->ip = bind_ip;
+    key->port = htons(rule->bind_port);
+    key->protocol = get_fwd_rule_protocol(protocol_str, family);
 
-    if (bind_port < 0)
+    if (bind_family)
+    {
+        *bind_family = family;
+    }
+
+    if (bind_prefixlen)
+    {
+        *bind_prefixlen = prefixlen;
+    }
+
+    return 0;
+}
+
+/**
+ * Splits a bind port range into the port prefixes stored in the forward rule ranges LPM trie.
+ * 
+ * @param key A pointer to the forward rule's key (bind IP and protocol).
+ * @param port_start The first port of the range (host byte order).
+ * @param port_end The last port of the range (host byte order).
+ * @param range_keys Where to store the prefixes (up to MAX_PORT_RANGE_PREFIXES).
+ * 
+ * @return The amount of prefixes.
+ */
+static int get_fwd_rule_range_keys(fwd_rule_key_t* key, u16 port_start, u16 port_end, fwd_rule_range_key_t* range_keys)
+{
+    int cnt = 0;
+    u32 port = port_start;
+
+    while (port <= port_end && cnt < MAX_PORT_RANGE_PREFIXES)
+    {
+        // Use the largest aligned block that still fits inside the range.
+        int bits = 0;
+
+        while (bits < 16 && (port & ((1u << (bits + 1)) - 1)) == 0 && port + (1u << (bits + 1)) - 1 <= port_end)
+        {
+            bits++;
+        }
+
+        fwd_rule_range_key_t* range_key = &range_keys[cnt++];
+
+        memset(range_key, 0, sizeof(*range_key));
+        range_key->prefixlen = FWD_RULE_RANGE_PREFIXLEN - bits;
+        range_key->protocol = key->protocol;
+        range_key->ip = key->ip;
+        range_key->port = htons(port);
+
+        port += 1u << bits;
+    }
+
+    return cnt;
+}
+
+/**
+ * Constructs the forward rule prefixes LPM trie key of a rule binding a prefix.
+ * 
+ * @param key A pointer to the forward rule's key (bind prefix, port, and protocol).
+ * @param bind_prefixlen The bind prefix length in IPv6 bits.
+ * @param prefix_key Where to store the key.
+ * 
+ * @return void
+ */
+static void get_fwd_rule_prefix_key(fwd_rule_key_t* key, u8 bind_prefixlen, fwd_rule_prefix_key_t* prefix_key)
+{
+    memset(prefix_key, 0, sizeof(*prefix_key));
+    prefix_key->prefixlen = FWD_RULE_PREFIX_BASE_LEN + bind_prefixlen;
+    prefix_key->protocol = key->protocol;
+    prefix_key->port = key->port;
+    prefix_key->ip = key->ip;
+}
+
+/**
+ * Retrieves the value of a rule binding a prefix from the forward rule prefixes BPF map.
+ * 
+ * @param map_fwd_rule_prefixes The rule prefixes BPF map FD.
+ * @param prefix_key A pointer to the rule's prefix key.
+ * @param val Where to store the rule's value.
+ * 
+ * @return 0 if the rule exists or 1 otherwise.
+ */
+static int get_fwd_rule_prefix_val(int map_fwd_rule_prefixes, fwd_rule_prefix_key_t* prefix_key, fwd_rule_val_t* val)
+{
+    // Lookups return the longest matching prefix which may belong to a wider rule, so look for the exact key instead.
+    fwd_rule_prefix_key_t cur_key;
+    fwd_rule_prefix_key_t next_key;
+
+    int ret = bpf_map_get_next_key(map_fwd_rule_prefixes, NULL, &next_key);
+
+    while (ret == 0)
+    {
+        cur_key = next_key;
+
+        if (memcmp(&cur_key, prefix_key, sizeof(cur_key)) == 0)
+        {
+            return (bpf_map_lookup_elem(map_fwd_rule_prefixes, &cur_key, val) == 0) ? 0 : 1;
+        }
+
+        ret = bpf_map_get_next_key(map_fwd_rule_prefixes, &cur_key, &next_key);
+    }
+
+    return 1;
+}
+
+/**
+ * Retrieves a forward rule's value from the forward rules BPF map, the forward rule ranges BPF map (if the key's port is the first port of a range rule), or the forward rule prefixes BPF map (if the rule binds a prefix).
+ * 
+ * @param map_fwd_rules The rules BPF map FD.
+ * @param map_fwd_rule_ranges The rule ranges BPF map FD (-1 if port ranges are disabled).
+ * @param map_fwd_rule_prefixes The rule prefixes BPF map FD (-1 if bind prefixes are disabled).
+ * @param key A pointer to the rule's key.
+ * @param bind_prefixlen The rule's bind prefix length in IPv6 bits (128 for single addresses).
+ * @param val Where to store the rule's value.
+ * 
+ * @return 0 if the rule exists or 1 otherwise.
+ */
+int get_fwd_rule_val(int map_fwd_rules, int map_fwd_rule_ranges, int map_fwd_rule_prefixes, fwd_rule_key_t* key, u8 bind_prefixlen, fwd_rule_val_t* val)
+{
+    if (bind_prefixlen < 128)
+    {
+        if (map_fwd_rule_prefixes < 0)
+        {
+            return 1;
+        }
+
+        fwd_rule_prefix_key_t prefix_key;
+        get_fwd_rule_prefix_key(key, bind_prefixlen, &prefix_key);
+
+        return get_fwd_rule_prefix_val(map_fwd_rule_prefixes, &prefix_key, val);
+    }
+
+    if (bpf_map_lookup_elem(map_fwd_rules, key, val) == 0)
+    {
+        return 0;
+    }
+
+    if (map_fwd_rule_ranges < 0)
     {
         return 1;
     }
 
-    fwd_rule_key_t key = {0};
-    key.ip = bind_ip_addr.s_addr;
-    key.port = bind_port;
-    key.protocol = protocol;
+    fwd_rule_range_key_t range_key = {0};
+    range_key.prefixlen = FWD_RULE_RANGE_PREFIXLEN;
+    range_key.protocol = key->protocol;
+    range_key.ip = key->ip;
+    range_key.port = key->port;
+
+    if (bpf_map_lookup_elem(map_fwd_rule_ranges, &range_key, val) == 0 && val->bind_port == key->port)
+    {
+        return 0;
+    }
 
-    return bpf_map_delete_elem(map_fwd_rules, &key);
+    return 1;
 }
 
 /**
- * Deletes all forward rules from the BPF map.
+ * Marks the rule IDs used by the entries of a forward rules BPF map.
+ * 
+ * @param map The rules BPF map FD.
+ * @param used The used IDs (MAX_FWD_RULES entries).
+ * 
+ * @return void
+ */
+static void mark_used_fwd_rule_ids(int map, u8* used)
+{
+    // Large enough for all rule key types.
+    u8 cur_key[sizeof(fwd_rule_key_t) + sizeof(fwd_rule_range_key_t) + sizeof(fwd_rule_prefix_key_t)];
+    u8 next_key[sizeof(cur_key)];
+
+    fwd_rule_val_t val;
+
+    int ret = bpf_map_get_next_key(map, NULL, next_key);
+
+    while (ret == 0)
+    {
+        memcpy(cur_key, next_key, sizeof(cur_key));
+
+        if (bpf_map_lookup_elem(map, cur_key, &val) == 0 && val.id < MAX_FWD_RULES)
+        {
+            used[val.id] = 1;
+        }
+
+        ret = bpf_map_get_next_key(map, cur_key, next_key);
+    }
+}
+
+/**
+ * Retrieves the ID of a forward rule. Existing rules keep their ID and new rules receive the lowest unused ID.
  * 
  * @param map_fwd_rules The rules BPF map FD.
+ * @param map_fwd_rule_ranges The rule ranges BPF map FD (-1 if port ranges are disabled).
+ * @param map_fwd_rule_prefixes The rule prefixes BPF map FD (-1 if bind prefixes are disabled).
+ * @param key A pointer to the rule's key.
+ * @param bind_prefixlen The rule's bind prefix length in IPv6 bits.
+ * 
+ * @return The rule ID or -1 if all IDs are in use.
+ */
+static int get_fwd_rule_id(int map_fwd_rules, int map_fwd_rule_ranges, int map_fwd_rule_prefixes, fwd_rule_key_t* key, u8 bind_prefixlen)
+{
+    fwd_rule_val_t val;
+
+    if (get_fwd_rule_val(map_fwd_rules, map_fwd_rule_ranges, map_fwd_rule_prefixes, key, bind_prefixlen, &val) == 0)
+    {
+        return val.id;
+    }
+
+    u8 used[MAX_FWD_RULES] = {0};
+
+    mark_used_fwd_rule_ids(map_fwd_rules, used);
+
+    if (map_fwd_rule_ranges >= 0)
+    {
+        mark_used_fwd_rule_ids(map_fwd_rule_ranges, used);
+    }
+
+    if (map_fwd_rule_prefixes >= 0)
+    {
+        mark_used_fwd_rule_ids(map_fwd_rule_prefixes, used);
+    }
+
+    for (int i = 0; i < MAX_FWD_RULES; i++)
+    {
+        if (!used[i])
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * Deletes the port prefixes of a range rule from the forward rule ranges BPF map.
+ * 
+ * @param map_fwd_rule_ranges The rule ranges BPF map FD.
+ * @param id The rule's ID.
+ * @param keep The prefixes to keep (may be NULL).
+ * @param keep_cnt The amount of prefixes to keep.
+ * 
+ * @return void
+ */
+static void delete_fwd_rule_ranges(int map_fwd_rule_ranges, u32 id, fwd_rule_range_key_t* keep, int keep_cnt)
+{
+    fwd_rule_range_key_t stale[MAX_PORT_RANGE_PREFIXES * 2];
+    int stale_cnt = 0;
+
+    fwd_rule_range_key_t cur_key;
+    fwd_rule_range_key_t next_key;
+
+    fwd_rule_val_t val;
+
+    // Collect the prefixes first since deleting while iterating restarts the iteration.
+    int ret = bpf_map_get_next_key(map_fwd_rule_ranges, NULL, &next_key);
+
+    while (ret == 0 && stale_cnt < MAX_PORT_RANGE_PREFIXES * 2)
+    {
+        cur_key = next_key;
+
+        if (bpf_map_lookup_elem(map_fwd_rule_ranges, &cur_key, &val) == 0 && val.id == id)
+        {
+            int kept = 0;
+
+            for (int i = 0; i < keep_cnt; i++)
+            {
+                if (memcmp(&keep[i], &cur_key, sizeof(cur_key)) == 0)
+                {
+                    kept = 1;
+
+                    break;
+                }
+            }
+
+            if (!kept)
+            {
+                stale[stale_cnt++] = cur_key;
+            }
+        }
+
+        ret = bpf_map_get_next_key(map_fwd_rule_ranges, &cur_key, &next_key);
+    }
+
+    for (int i = 0; i < stale_cnt; i++)
+    {
+        bpf_map_delete_elem(map_fwd_rule_ranges, &stale[i]);
+    }
+}
+
+/**
+ * Deletes a forward rule from the BPF maps.
+ * 
+ * @param map_fwd_rules The forward rules BPF map FD.
+ * @param map_fwd_rule_ranges The forward rule ranges BPF map FD (-1 if port ranges are disabled).
+ * @param map_fwd_rule_prefixes The forward rule prefixes BPF map FD (-1 if bind prefixes are disabled).
+ * @param map_maglev The Maglev BPF map FD.
+ * @param rule The forward rule to delete.
+ * 
+ * @return 0 on success, 1 if the rule doesn't exist, 2 on if bind IP or protocol isn't specified, or the error value of bpf_map_delete_elem().
+ */
+int delete_fwd_rule(int map_fwd_rules, int map_fwd_rule_ranges, int map_fwd_rule_prefixes, int map_maglev, fwd_rule_cfg_t* rule)
+{
+    int ret;
+
+    fwd_rule_key_t key;
+    u8 bind_prefixlen;
+
+    if ((ret = get_fwd_rule_key(rule, &key, NULL, &bind_prefixlen)) != 0)
+    {
+        return ret;
+    }
+
+    fwd_rule_val_t val = {0};
+
+    if (get_fwd_rule_val(map_fwd_rules, map_fwd_rule_ranges, map_fwd_rule_prefixes, &key, bind_prefixlen, &val) != 0)
+    {
+        return 1;
+    }
+
+    if (bind_prefixlen < 128)
+    {
+        fwd_rule_prefix_key_t prefix_key;
+        get_fwd_rule_prefix_key(&key, bind_prefixlen, &prefix_key);
+
+        if ((ret = bpf_map_delete_elem(map_fwd_rule_prefixes, &prefix_key)) != 0)
+        {
+            return ret;
+        }
+    }
+    else if ((ret = bpf_map_delete_elem(map_fwd_rules, &key)) != 0 && ret != -ENOENT)
+    {
+        return ret;
+    }
+
+    if (map_fwd_rule_ranges >= 0)
+    {
+        delete_fwd_rule_ranges(map_fwd_rule_ranges, val.id, NULL, 0);
+    }
+
+    // Release the rule's Maglev lookup table (it may not exist).
+    bpf_map_delete_elem(map_maglev, &val.id);
+
+    return 0;
+}
+
+/**
+ * Deletes all forward rules from the BPF maps.
+ * 
+ * @param map_fwd_rules The rules BPF map FD.
+ * @param map_fwd_rule_ranges The rule ranges BPF map FD (-1 if port ranges are disabled).
+ * @param map_fwd_rule_prefixes The rule prefixes BPF map FD (-1 if bind prefixes are disabled).
+ * @param map_maglev The Maglev BPF map FD.
  * @param cfg A pointer to the config structure.
  * 
  * @return void
  */
-void delete_fwd_rules(int map_fwd_rules, config__t *cfg)
+void delete_fwd_rules(int map_fwd_rules, int map_fwd_rule_ranges, int map_fwd_rule_prefixes, int map_maglev, config__t *cfg)
 {
     for (int i = 0; i < MAX_FWD_RULES; i++)
     {
         fwd_rule_cfg_t* rule = &cfg->rules[i];
 
-        delete_fwd_rule(map_fwd_rules, rule);
+        delete_fwd_rule(map_fwd_rules, map_fwd_rule_ranges, map_fwd_rule_prefixes, map_maglev, rule);
+    }
+}
+
+/**
+ * Retrieves the idle timeouts of a forward rule's connections based off of its protocol.
+ * 
+ * @param rule A pointer to the config rule.
+ * @param cfg A pointer to the config structure (main timeouts are used when the rule doesn't set its own).
+ * @param protocol The rule's protocol ID.
+ * @param timeout Where to store the idle timeout in seconds.
+ * @param close_timeout Where to store the idle timeout of TCP connections that are opening or closing in seconds.
+ * @param time_wait_timeout Where to store the idle timeout of closed TCP connections in seconds.
+ * 
+ * @return void
+ */
+static void get_fwd_rule_timeouts(fwd_rule_cfg_t* rule, config__t* cfg, int protocol, u32* timeout, u32* close_timeout, u32* time_wait_timeout)
+{
+    int val = 0;
+    int close_val = 0;
+    int time_wait_val = 0;
+
+    switch (protocol)
+    {
+        case IPPROTO_TCP:
+            val = (rule->tcp_est_timeout > 0) ? rule->tcp_est_timeout : cfg->tcp_est_timeout;
+            close_val = (rule->tcp_close_timeout > 0) ? rule->tcp_close_timeout : cfg->tcp_close_timeout;
+            time_wait_val = (rule->tcp_time_wait_timeout > 0) ? rule->tcp_time_wait_timeout : cfg->tcp_time_wait_timeout;
+
+            break;
+
+        case IPPROTO_UDP:
+            val = close_val = time_wait_val = (rule->udp_timeout > 0) ? rule->udp_timeout : cfg->udp_timeout;
+
+            break;
+
+        case IPPROTO_ICMP:
+        case IPPROTO_ICMPV6:
+            val = close_val = time_wait_val = (rule->icmp_timeout > 0) ? rule->icmp_timeout : cfg->icmp_timeout;
+
+            break;
     }
+
+    *timeout = (val > 0) ? val : 0;
+    *close_timeout = (close_val > 0) ? close_val : 0;
+    *time_wait_timeout = (time_wait_val > 0) ? time_wait_val : 0;
 }
 
 /**
  * Updates a forward rule in the BPF map.
  * 
  * @param map_fwd_rules The rules BPF map FD.
+ * @param map_fwd_rule_ranges The rule ranges BPF map FD (-1 if port ranges are disabled).
+ * @param map_fwd_rule_prefixes The rule prefixes BPF map FD (-1 if bind prefixes are disabled).
+ * @param map_backends The backends BPF map FD.
+ * @param map_maglev The Maglev BPF map FD.
  * @param rule A pointer to the config rule.
+ * @param cfg A pointer to the config structure.
  * 
- * @return 0 on success, 2 on bind IP, protocol, or destination IP isn't specified, or error value of bpf_map_update_elem().
+ * @return 0 on success, 1 on invalid addresses, ports, or DSR tunnel types (including port ranges, bind prefixes, and DSR if they're disabled or combined), 2 on bind IP, protocol, or destination IP (or backends) isn't specified, 3 if the source IP (source NAT IP or bind IP) and a backend IP are of different address families, an ICMP rule uses address translation, or a rule binding a prefix has no source NAT IP (unless it uses DSR), 4 if there are no unused rule IDs left, or error value of bpf_map_update_elem().
  */
-int update_fwd_rule(int map_fwd_rules, fwd_rule_cfg_t* rule)
+int update_fwd_rule(int map_fwd_rules, int map_fwd_rule_ranges, int map_fwd_rule_prefixes, int map_backends, int map_maglev, fwd_rule_cfg_t* rule, config__t* cfg)
 {
     int ret;
 
-    if (!rule->bind_ip || !rule->protocol || !rule->dst_ip)
+    if (!rule->bind_ip || !rule->protocol || (!rule->dst_ip && rule->backends_cnt < 1))
     {
         return 2;
     }
 
     // Construct key.
-    struct in_addr bind_ip_addr;
+    fwd_rule_key_t key;
+    int bind_family;
+    u8 bind_prefixlen;
 
-    if ((ret = inet_pton(AF_INET, rule->bind_ip, &bind_ip_addr)) != 1)
+    if ((ret = get_fwd_rule_key(rule, &key, &bind_family, &bind_prefixlen)) != 0)
     {
         return ret;
     }
 
-    u16 bind_port = htons(rule->bind_port);
+    int protocol = key.protocol;
+
+    // The source NAT IP is used towards the destination. Otherwise, the bind IP is.
+    u128 snat_ip = 0;
+    int src_family = bind_family;
+
+    if (rule->snat_ip && (src_family = parse_ip_addr(rule->snat_ip, &snat_ip)) < 0)
+    {
+        return 1;
+    }
+
+    int is_icmp = (protocol == IPPROTO_ICMP || protocol == IPPROTO_ICMPV6);
+
+    // DSR rules encapsulate packets towards their backends instead of translating them.
+    int dsr = TUNNEL_NONE;
+
+    if (rule->dsr)
+    {
+#ifdef ENABLE_DSR
+        if ((dsr = get_tunnel_type_by_str(rule->dsr)) < 0)
+        {
+            return 1;
+        }
+#else
+        return 1;
+#endif
+    }
+
+    // Rules binding a prefix match any address inside of it. Source ports are only handed out for the source NAT IP since there are no port pools for each address.
+    int is_prefix = bind_prefixlen < 128;
+
+    if (is_prefix)
+    {
+        if (map_fwd_rule_prefixes < 0 || rule->bind_port_end > rule->bind_port)
+        {
+            return 1;
+        }
+
+        if (!rule->snat_ip && !dsr)
+        {
+            return 3;
+        }
+    }
+
+    // Rules without backends forward to their destination IP and port.
+    backend_t backends[MAX_BACKENDS] = {0};
+    int weights[MAX_BACKENDS] = {0};
+
+    int backends_cnt = (rule->backends_cnt > 0) ? rule->backends_cnt : 1;
+
+    if (backends_cnt > MAX_BACKENDS)
+    {
+        backends_cnt = MAX_BACKENDS;
+    }
+
+    for (int i = 0; i < backends_cnt; i++)
+    {
+        const char* ip = (rule->backends_cnt > 0) ? rule->backends[i].ip : rule->dst_ip;
+        u16 port = (rule->backends_cnt > 0) ? rule->backends[i].port : rule->dst_port;
+
+        if (!ip)
+        {
+            return 2;
+        }
+
+        int dst_family;
+
+        if ((dst_family = parse_ip_addr(ip, &backends[i].ip)) < 0)
+        {
+            return 1;
+        }
+
+        // The source IP must match the destination's address family. Translating ICMP isn't supported (encapsulated packets aren't translated).
+        if (src_family != dst_family || (is_icmp && !dsr && bind_family != dst_family))
+        {
+            return 3;
+        }
+
+        backends[i].port = htons(port);
+        weights[i] = (rule->backends_cnt > 0) ? rule->backends[i].weight : 1;
+    }
+
+    // Rules covering a range of bind ports are stored as port prefixes.
+    int is_range = !is_icmp && rule->bind_port_end > rule->bind_port;
+
+    fwd_rule_range_key_t range_keys[MAX_PORT_RANGE_PREFIXES];
+    int range_keys_cnt = 0;
+
+    if (rule->bind_port_end > 0 && rule->bind_port_end < rule->bind_port)
+    {
+        return 1;
+    }
+
+    if (is_range)
+    {
+        if (map_fwd_rule_ranges < 0)
+        {
+            return 1;
+        }
+
+        range_keys_cnt = get_fwd_rule_range_keys(&key, rule->bind_port, rule->bind_port_end, range_keys);
+    }
+
+    int id;
+
+    if ((id = get_fwd_rule_id(map_fwd_rules, map_fwd_rule_ranges, map_fwd_rule_prefixes, &key, bind_prefixlen)) < 0)
+    {
+        return 4;
+    }
+
+    // Store the backends and their lookup table before the rule goes live.
+    for (int i = 0; i < backends_cnt; i++)
+    {
+        u32 backend_key = (id * MAX_BACKENDS) + i;
+
+        if ((ret = bpf_map_update_elem(map_backends, &backend_key, &backends[i], BPF_ANY)) != 0)
+        {
+            return ret;
+        }
+    }
+
+    if (backends_cnt > 1 && (ret = update_maglev_table(map_maglev, id, backends, weights, backends_cnt)) != 0)
+    {
+        return ret;
+    }
+
+    fwd_rule_val_t val = {0};
+    val.id = id;
+    val.log = rule->log;
+
+    val.backends_cnt = backends_cnt;
+
+    val.bind_port = key.port;
+    val.port_offset = is_range && !dsr && rule->port_offset;
+
+    val.snat_ip = snat_ip;
+
+    get_fwd_rule_timeouts(rule, cfg, protocol, &val.timeout, &val.close_timeout, &val.time_wait_timeout);
+
+    // Policers count bytes.
+    val.pps = rule->policer_pps;
+    val.bytes_ps = (rule->policer_bps + 7) / 8;
+    val.client_pps = rule->policer_client_pps;
+    val.client_bytes_ps = (rule->policer_client_bps + 7) / 8;
+
+    // Clients may create a second worth of connections at once by default.
+    val.conn_rate = rule->conn_rate_limit;
+    val.conn_burst = (rule->conn_rate_burst > 0) ? rule->conn_rate_burst : rule->conn_rate_limit;
+
+    // SYN cookies only apply to TCP.
+    val.syn_cookies = protocol == IPPROTO_TCP && !dsr && rule->syn_cookies;
+
+    // ICMP echoes are dropped either way.
+    val.fast_reject = !is_icmp && rule->fast_reject;
+
+    // Ports aren't rewritten and connections aren't tracked with DSR (SYN cookies and port offsets don't apply).
+    val.dsr = dsr;
+
+    if (is_prefix)
+    {
+        fwd_rule_prefix_key_t prefix_key;
+        get_fwd_rule_prefix_key(&key, bind_prefixlen, &prefix_key);
+
+        return bpf_map_update_elem(map_fwd_rule_prefixes, &prefix_key, &val, BPF_ANY);
+    }
+
+    if (!is_range)
+    {
+        if ((ret = bpf_map_update_elem(map_fwd_rules, &key, &val, BPF_ANY)) != 0)
+        {
+            return ret;
+        }
+
+        // Remove the prefixes left over if the rule covered a port range before.
+        if (map_fwd_rule_ranges >= 0)
+        {
+            delete_fwd_rule_ranges(map_fwd_rule_ranges, id, NULL, 0);
+        }
+
+        return 0;
+    }
+
+    for (int i = 0; i < range_keys_cnt; i++)
+    {
+        if ((ret = bpf_map_update_elem(map_fwd_rule_ranges, &range_keys[i], &val, BPF_ANY)) != 0)
+        {
+            return ret;
+        }
+    }
+
+    // Remove the prefixes left over from the rule's previous port range and its single-port entry.
+    delete_fwd_rule_ranges(map_fwd_rule_ranges, id, range_keys, range_keys_cnt);
+    bpf_map_delete_elem(map_fwd_rules, &key);
+
+    return 0;
+}
+
+/**
+ * Creates the source port pool for a forward rule's source IP (source NAT IP or bind IP) and protocol if it doesn't exist yet.
+ * 
+ * @param map_port_pools The port pools BPF map FD.
+ * @param rule A pointer to the config rule.
+ * 
+ * @return 0 on success (or if the pool already exists), 2 if bind IP or protocol isn't specified or the rule uses DSR, or error value of bpf_map_update_elem().
+ */
+int update_port_pool(int map_port_pools, fwd_rule_cfg_t* rule)
+{
+    int ret;
+
+    if (!rule->bind_ip || !rule->protocol)
+    {
+        return 2;
+    }
+
+    // DSR rules don't translate packets, so they never allocate source ports (and may bind a prefix without a source NAT IP).
+    if (rule->dsr)
+    {
+        return 2;
+    }
 
     char protocol_str[64];
     strncpy(protocol_str, rule->protocol, sizeof(protocol_str) - 1);
     protocol_str[sizeof(protocol_str) - 1] = '\0';
 
-    int protocol = get_protocol_id_by_str(protocol_str);
+    // Connections are mapped to source ports of the source NAT IP if one is set.
+    u128 src_ip;
+    int family;
 
-    if (bind_port < 0)
+    if ((family = parse_ip_addr((rule->snat_ip) ? rule->snat_ip : rule->bind_ip, &src_ip)) < 0)
     {
         return 1;
     }
 
-    fwd_rule_key_t key = {0};
-    key.ip = bind_ip_addr.s_addr;
-    key.port = bind_port;
+    // ICMP echoes are handed out identifiers from the pool of their protocol (ICMP rules can't be translated, so the families match).
+    int protocol = get_fwd_rule_protocol(protocol_str, family);
+
+    if (protocol < 0)
+    {
+        return 0;
+    }
+
+    port_pool_key_t key = {0};
+    key.bind_ip = src_ip;
     key.protocol = protocol;
 
-    // Construct value.
-    struct in_addr dst_ip_addr;
+    // The pool is too large for the stack with bigger port ranges.
+    port_pool_t* pool = malloc(sizeof(*pool));
 
-    if ((ret = inet_pton(AF_INET, rule->dst_ip, &dst_ip_addr)) != 1)
+    if (!pool)
     {
-        return ret;
+        return 1;
     }
 
-    u32 dst_port = htons(rule->dst_port);
+    // Each slice receives its own part of the port range (the last slice may be shorter).
+    for (u32 slice = 0; slice < PORT_SLICES; slice++)
+    {
+        u32 base = slice * PORT_SLICE_SIZE;
+        u32 size = PORT_SLICE_SIZE;
 
-    fwd_rule_val_t val = {0};
-    val.log = rule->log;
+        if (base >= MAX_PORTS)
+        {
+            break;
+        }
+
+        if (base + size > MAX_PORTS)
+        {
+            size = MAX_PORTS - base;
+        }
 
-    val.dst_ip = dst_ip_addr.s_addr;
-    val.dst_port = dst_port;
+        memset(pool, 0, sizeof(*pool));
 
-    return bpf_map_update_elem(map_fwd_rules, &key, &val, BPF_ANY);
+        // Fill the free stack so the lowest ports are handed out first.
+        for (u32 i = 0; i < size; i++)
+        {
+            pool->free[i] = MIN_PORT + base + (size - 1 - i);
+        }
+
+        pool->free_cnt = size;
+
+        key.slice = slice;
+
+        // Don't reset pools that are already handing out ports.
+        if ((ret = bpf_map_update_elem(map_port_pools, &key, pool, BPF_NOEXIST)) != 0 && ret != -EEXIST)
+        {
+            free(pool);
+
+            return ret;
+        }
+    }
+
+    free(pool);
+
+    return 0;
 }
 
 /**
  * Updates the forward rules in the BPF map.
  * 
  * @param map_fwd_rules The forward rule's BPF map FD.
+ * @param map_fwd_rule_ranges The forward rule ranges BPF map FD (-1 if port ranges are disabled).
+ * @param map_fwd_rule_prefixes The forward rule prefixes BPF map FD (-1 if bind prefixes are disabled).
+ * @param map_backends The backends BPF map FD.
+ * @param map_maglev The Maglev BPF map FD.
+ * @param map_port_pools The port pools BPF map FD.
  * @param cfg A pointer to the config structure.
  * 
  * @return Void
  */
-void update_fwd_rules(int map_fwd_rules, config__t *cfg)
+void update_fwd_rules(int map_fwd_rules, int map_fwd_rule_ranges, int map_fwd_rule_prefixes, int map_backends, int map_maglev, int map_port_pools, config__t *cfg)
 {
     int ret;
 
@@ -342,16 +1063,30 @@ void update_fwd_rules(int map_fwd_rules, config__t *cfg)
             continue;
         }
 
+        // Make sure the rule has source ports to hand out before it goes live.
+        if ((ret = update_port_pool(map_port_pools, rule)) != 0 && ret != 2)
+        {
+            log_msg(cfg, 1, 0, "[WARNING] Failed to create source port pool for rule '%s:%d' (%s) (%d)...", rule->bind_ip, rule->bind_port, rule->protocol, ret);
+        }
+
         // Attempt to update rule.
-        if ((ret = update_fwd_rule(map_fwd_rules, rule)) != 0)
+        if ((ret = update_fwd_rule(map_fwd_rules, map_fwd_rule_ranges, map_fwd_rule_prefixes, map_backends, map_maglev, rule, cfg)) != 0)
         {
-            if (ret != 2)
+            if (ret == 3)
+            {
+                log_msg(cfg, 1, 0, "[WARNING] Failed to update rule '%s:%d' (%s). The source NAT IP (or bind IP if not set) and destination IPs must be of the same address family, ICMP rules can't be translated, and rules binding a prefix need a source NAT IP (unless they use DSR)...", rule->bind_ip, rule->bind_port, rule->protocol);
+            }
+            else if (ret == 4)
+            {
+                log_msg(cfg, 1, 0, "[WARNING] Failed to update rule '%s:%d' (%s). All rule IDs are in use...", rule->bind_ip, rule->bind_port, rule->protocol);
+            }
+            else if (ret != 2)
             {
                 log_msg(cfg, 1, 0, "[WARNING] Failed to update rule '%s:%d' (%s) due to BPF update error (%d)...", rule->bind_ip, rule->bind_port, rule->protocol, ret);
             }
             else
             {
-                log_msg(cfg, 1, 0, "[WARNING] Failed to update rule at index %d. Bind IP, protocol, or destination IP is not specified...", i + 1);
+                log_msg(cfg, 1, 0, "[WARNING] Failed to update rule at index %d. Bind IP, protocol, or destination IP (or backend IP) is not specified...", i + 1);
             }
 
             continue;
@@ -359,6 +1094,163 @@ void update_fwd_rules(int map_fwd_rules, config__t *cfg)
     }
 }
 
+/**
+ * Adds an interface to the devices BPF map so packets may be redirected out of it.
+ * 
+ * @param map_devices The devices BPF map FD.
+ * @param ifidx The interface index.
+ * 
+ * @return 0 on success or error value of bpf_map_update_elem().
+ */
+int update_device(int map_devices, int ifidx)
+{
+    u32 key = ifidx;
+    u32 val = ifidx;
+
+    return bpf_map_update_elem(map_devices, &key, &val, BPF_ANY);
+}
+
+/**
+ * Updates a tunnel in the BPF maps.
+ * 
+ * @param map_tunnels The tunnels BPF map FD.
+ * @param map_tunnel_ids The tunnel IDs BPF map FD.
+ * @param id The tunnel's ID.
+ * @param tunnel A pointer to the config tunnel.
+ * @param key Where to store the tunnel's key.
+ * 
+ * @return 0 on success, 1 on invalid addresses (or addresses of different address families), 2 if the type, local IP, or remote IP isn't specified, 3 if the type isn't gre or ipip, or error value of bpf_map_update_elem().
+ */
+int update_tunnel(int map_tunnels, int map_tunnel_ids, u32 id, tunnel_cfg_t* tunnel, tunnel_key_t* key)
+{
+    int ret;
+
+    if (!tunnel->type || !tunnel->local_ip || !tunnel->remote_ip)
+    {
+        return 2;
+    }
+
+    tunnel_t val = {0};
+
+    int type = get_tunnel_type_by_str(tunnel->type);
+
+    // GUE is only sent towards backends of DSR rules.
+    if (type != TUNNEL_GRE && type != TUNNEL_IPIP)
+    {
+        return 3;
+    }
+
+    int local_family;
+    int remote_family;
+
+    if ((local_family = parse_ip_addr(tunnel->local_ip, &val.local_ip)) < 0 || (remote_family = parse_ip_addr(tunnel->remote_ip, &val.remote_ip)) < 0 || local_family != remote_family)
+    {
+        return 1;
+    }
+
+    val.type = type;
+
+    // Store the tunnel before packets from its endpoints are matched.
+    if ((ret = bpf_map_update_elem(map_tunnels, &id, &val, BPF_ANY)) != 0)
+    {
+        return ret;
+    }
+
+    memset(key, 0, sizeof(*key));
+    key->local_ip = val.local_ip;
+    key->remote_ip = val.remote_ip;
+
+    return bpf_map_update_elem(map_tunnel_ids, key, &id, BPF_ANY);
+}
+
+/**
+ * Updates the tunnels in the BPF maps and removes tunnels no longer in the config.
+ * 
+ * @param map_tunnels The tunnels BPF map FD.
+ * @param map_tunnel_ids The tunnel IDs BPF map FD.
+ * @param cfg A pointer to the config structure.
+ * 
+ * @return void
+ */
+void update_tunnels(int map_tunnels, int map_tunnel_ids, config__t* cfg)
+{
+    int ret;
+
+    tunnel_key_t keys[MAX_TUNNELS];
+    int keys_cnt = 0;
+
+    // Unused IDs are cleared so connections opened through removed tunnels stop using them.
+    tunnel_t empty = {0};
+
+    // Tunnel IDs start at 1 (0 = no tunnel).
+    for (u32 id = 1; id <= MAX_TUNNELS; id++)
+    {
+        if ((int)id > cfg->tunnels_cnt)
+        {
+            bpf_map_update_elem(map_tunnels, &id, &empty, BPF_ANY);
+
+            continue;
+        }
+
+        if ((ret = update_tunnel(map_tunnels, map_tunnel_ids, id, &cfg->tunnels[id - 1], &keys[keys_cnt])) != 0)
+        {
+            if (ret == 1)
+            {
+                log_msg(cfg, 1, 0, "[WARNING] Failed to update tunnel #%d. The local and remote IPs must be valid and of the same address family...", id);
+            }
+            else if (ret == 2)
+            {
+                log_msg(cfg, 1, 0, "[WARNING] Failed to update tunnel #%d. Type, local IP, or remote IP is not specified...", id);
+            }
+            else if (ret == 3)
+            {
+                log_msg(cfg, 1, 0, "[WARNING] Failed to update tunnel #%d. The type must be 'gre' or 'ipip'...", id);
+            }
+            else
+            {
+                log_msg(cfg, 1, 0, "[WARNING] Failed to update tunnel #%d due to BPF update error (%d)...", id, ret);
+            }
+
+            bpf_map_update_elem(map_tunnels, &id, &empty, BPF_ANY);
+
+            continue;
+        }
+
+        keys_cnt++;
+    }
+
+    // Remove the endpoints of tunnels no longer in the config.
+    tunnel_key_t key;
+    tunnel_key_t next_key;
+
+    ret = bpf_map_get_next_key(map_tunnel_ids, NULL, &key);
+
+    while (ret == 0)
+    {
+        // Retrieve the next key before the current one is deleted.
+        ret = bpf_map_get_next_key(map_tunnel_ids, &key, &next_key);
+
+        int found = 0;
+
+        for (int i = 0; i < keys_cnt; i++)
+        {
+            if (keys[i].local_ip == key.local_ip && keys[i].remote_ip == key.remote_ip)
+            {
+                found = 1;
+
+                break;
+            }
+        }
+
+        if (!found)
+        {
+            bpf_map_delete_elem(map_tunnel_ids, &key);
+        }
+
+        key = next_key;
+    }
+}
+
 /**
  * Pins a BPF map to the file system.
  * 
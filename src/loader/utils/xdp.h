@@ -2,10 +2,14 @@
 
 #include <xdp/libxdp.h>
 
+#include <errno.h>
+#include <stdint.h>
+
 #include  <common/all.h>
 
 #include <loader/utils/config.h>
 #include <loader/utils/helpers.h>
+#include <loader/utils/maglev.h>
 
 #define XDP_OBJ_PATH "/etc/xdpfwd/xdp_prog.o"
 #define XDP_MAP_PIN_DIR "/sys/fs/bpf/xdpfwd"
@@ -16,13 +20,25 @@ void set_libbpf_log_mode(int silent);
 struct xdp_program *load_bpf_obj(const char *file_name);
 struct bpf_object* get_bpf_obj(struct xdp_program* prog);
 
+int set_per_cpu_lru_sizes(struct xdp_program* prog);
+
 int attach_xdp(struct xdp_program *prog, char** mode, int ifidx, int detach, int force_skb, int force_offload);
 
-int delete_fwd_rule(int map_fwd_rules, fwd_rule_cfg_t* rule);
-void delete_fwd_rules(int map_fwd_rules, config__t *cfg);
+int get_fwd_rule_key(fwd_rule_cfg_t* rule, fwd_rule_key_t* key, int* bind_family, u8* bind_prefixlen);
+int get_fwd_rule_val(int map_fwd_rules, int map_fwd_rule_ranges, int map_fwd_rule_prefixes, fwd_rule_key_t* key, u8 bind_prefixlen, fwd_rule_val_t* val);
+
+int delete_fwd_rule(int map_fwd_rules, int map_fwd_rule_ranges, int map_fwd_rule_prefixes, int map_maglev, fwd_rule_cfg_t* rule);
+void delete_fwd_rules(int map_fwd_rules, int map_fwd_rule_ranges, int map_fwd_rule_prefixes, int map_maglev, config__t *cfg);
+
+int update_fwd_rule(int map_fwd_rules, int map_fwd_rule_ranges, int map_fwd_rule_prefixes, int map_backends, int map_maglev, fwd_rule_cfg_t* rule_cfg, config__t* cfg);
+void update_fwd_rules(int map_fwd_rules, int map_fwd_rule_ranges, int map_fwd_rule_prefixes, int map_backends, int map_maglev, int map_port_pools, config__t *cfg);
+
+int update_port_pool(int map_port_pools, fwd_rule_cfg_t* rule);
+
+int update_device(int map_devices, int ifidx);
 
-int update_fwd_rule(int map_fwd_rules, fwd_rule_cfg_t* rule_cfg);
-void update_fwd_rules(int map_fwd_rules, config__t *cfg);
+int update_tunnel(int map_tunnels, int map_tunnel_ids, u32 id, tunnel_cfg_t* tunnel, tunnel_key_t* key);
+void update_tunnels(int map_tunnels, int map_tunnel_ids, config__t* cfg);
 
 int pin_map(struct bpf_object* obj, const char* pin_dir, const char* map_name);
 int unpin_map(struct bpf_object* obj, const char* pin_dir, const char* map_name);
@@ -38,11 +38,14 @@ int main(int argc, char *argv[])
         printf("  -h, --help                        Prints this help message.\n\n");
 
         printf("  -e, --enabled <1/0>               Enables to disables the forward rule.\n");
-        printf("  -b, --bind-ip <ip>                The bind IP address of the forward rule.\n");
+        printf("  -b, --bind-ip <ip>                The bind IP address or prefix (e.g. 10.0.0.0/24) of the forward rule.\n");
         printf("  -x, --bind-port <port>            The bind port of the forward rule.\n");
+        printf("  -z, --bind-port-end <port>        The last bind port of the forward rule (port ranges).\n");
+        printf("  -o, --port-offset <1/0>           Forwards each bind port of a range to the destination port plus its offset in the range.\n");
         printf("  -p, --protocol <tcp/udp/icmp>     The protocol of the forward rule.\n");
         printf("  -d, --dst-ip <ip>                 The destination IP of the forward rule.\n");
         printf("  -y, --dst-port <port>             The destination port of the forward rule.\n");
+        printf("  -n, --snat-ip <ip>                The source IP used towards the destination (required for IPv4 <=> IPv6 translation).\n");
 
         return EXIT_SUCCESS;
     }
@@ -76,7 +79,8 @@ int main(int argc, char *argv[])
         return EXIT_FAILURE;
     }
 
-    char bind_ip[INET_ADDRSTRLEN];
+    // Leave room for a prefix length.
+    char bind_ip[INET6_ADDRSTRLEN + 4];
     strncpy(bind_ip, cli.bind_ip, sizeof(bind_ip) - 1);
     bind_ip[sizeof(bind_ip) - 1] = '\0';
 
@@ -84,7 +88,7 @@ int main(int argc, char *argv[])
     strncpy(protocol, cli.protocol, sizeof(protocol) - 1);
     protocol[sizeof(protocol) - 1] = '\0';
 
-    char dst_ip[INET_ADDRSTRLEN];
+    char dst_ip[INET6_ADDRSTRLEN];
     strncpy(dst_ip, cli.dst_ip, sizeof(dst_ip) - 1);
     dst_ip[sizeof(dst_ip) - 1] = '\0';
 
@@ -97,6 +101,39 @@ int main(int argc, char *argv[])
         return EXIT_FAILURE;
     }
 
+    // This map doesn't exist if port ranges are disabled.
+    int map_fwd_rule_ranges = get_map_pin_fd(XDP_MAP_PIN_DIR, "map_fwd_rule_ranges");
+
+    // This map doesn't exist if bind prefixes are disabled.
+    int map_fwd_rule_prefixes = get_map_pin_fd(XDP_MAP_PIN_DIR, "map_fwd_rule_prefixes");
+
+    int map_backends = get_map_pin_fd(XDP_MAP_PIN_DIR, "map_backends");
+
+    if (map_backends < 0)
+    {
+        fprintf(stderr, "[ERROR] Failed to find 'map_backends' map.\n");
+
+        return EXIT_FAILURE;
+    }
+
+    int map_maglev = get_map_pin_fd(XDP_MAP_PIN_DIR, "map_maglev");
+
+    if (map_maglev < 0)
+    {
+        fprintf(stderr, "[ERROR] Failed to find 'map_maglev' map.\n");
+
+        return EXIT_FAILURE;
+    }
+
+    int map_port_pools = get_map_pin_fd(XDP_MAP_PIN_DIR, "map_port_pools");
+
+    if (map_port_pools < 0)
+    {
+        fprintf(stderr, "[ERROR] Failed to find 'map_port_pools' map.\n");
+
+        return EXIT_FAILURE;
+    }
+
     fwd_rule_cfg_t rule = {0};
     rule.set = 1;
 
@@ -105,33 +142,58 @@ int main(int argc, char *argv[])
 
     rule.bind_ip = strdup(bind_ip);
     rule.bind_port = cli.bind_port;
+    rule.bind_port_end = cli.bind_port_end;
+    rule.port_offset = cli.port_offset;
     rule.protocol = strdup(protocol);
 
     rule.dst_ip = strdup(dst_ip);
     rule.dst_port = cli.dst_port;
 
-    if ((ret = update_fwd_rule(map_fwd_rules, &rule)) != 0)
+    if (cli.snat_ip)
     {
-        fprintf(stderr, "[ERROR] Failed to add forward rule '%s:%d' => '%s:%d' (%s) (%d).\n", bind_ip, cli.bind_port, dst_ip, cli.dst_port, protocol, ret);
-
-        return EXIT_FAILURE;
+        rule.snat_ip = strdup(cli.snat_ip);
     }
 
-    printf("Added forward rule '%s:%d' => '%s:%d' (%s)!\n", bind_ip, cli.bind_port, dst_ip, cli.dst_port, protocol);
+    // Load the config for its main settings (e.g. connection timeouts) and for saving later on.
+    config__t cfg = {0};
 
-    if (cli.save)
+    set_cfg_defaults(&cfg);
+
+    if ((ret = load_config(&cfg, cli.cfg_file, NULL)) != 0)
     {
-        config__t cfg = {0};
-    
-        if ((ret = load_config(&cfg, cli.cfg_file, NULL)) != 0)
+        if (cli.save)
         {
             fprintf(stderr, "[ERROR] Failed to load config at '%s' (%d)\n", cli.cfg_file, ret);
 
             return EXIT_FAILURE;
         }
 
+        printf("[WARNING] Failed to load config at '%s' (%d). Using default settings...\n", cli.cfg_file, ret);
+    }
+    else
+    {
         printf("Loaded config...\n");
+    }
+
+    // Create the port pool first so the rule never goes live without source ports.
+    if ((ret = update_port_pool(map_port_pools, &rule)) != 0)
+    {
+        fprintf(stderr, "[ERROR] Failed to create source port pool for forward rule '%s:%d' (%s) (%d).\n", bind_ip, cli.bind_port, protocol, ret);
+
+        return EXIT_FAILURE;
+    }
+
+    if ((ret = update_fwd_rule(map_fwd_rules, map_fwd_rule_ranges, map_fwd_rule_prefixes, map_backends, map_maglev, &rule, &cfg)) != 0)
+    {
+        fprintf(stderr, "[ERROR] Failed to add forward rule '%s:%d' => '%s:%d' (%s) (%d).\n", bind_ip, cli.bind_port, dst_ip, cli.dst_port, protocol, ret);
 
+        return EXIT_FAILURE;
+    }
+
+    printf("Added forward rule '%s:%d' => '%s:%d' (%s)!\n", bind_ip, cli.bind_port, dst_ip, cli.dst_port, protocol);
+
+    if (cli.save)
+    {
         int idx = get_next_available_fwd_rule_index(&cfg);
 
         if (idx < 0)
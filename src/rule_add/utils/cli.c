@@ -11,11 +11,15 @@ const struct option opts[] =
 
     { "bind-ip", required_argument, NULL, 'b' },
     { "bind-port", required_argument, NULL, 'x' },
+    { "bind-port-end", required_argument, NULL, 'z' },
+    { "port-offset", required_argument, NULL, 'o' },
     { "protocol", required_argument, NULL, 'p' },
 
     { "dst-ip", required_argument, NULL, 'd' },
     { "dst-port", required_argument, NULL, 'y' },
 
+    { "snat-ip", required_argument, NULL, 'n' },
+
     { NULL, 0, NULL, 0 }
 };
 
@@ -23,7 +27,7 @@ void parse_cli (cli_t* cli, int argc, char* argv[])
 {
     int c;
 
-    while ((c = getopt_long(argc, argv, "c:hse:l:b:x:p:d:y:", opts, NULL)) != -1)
+    while ((c = getopt_long(argc, argv, "c:hse:l:b:x:z:o:p:d:y:n:", opts, NULL)) != -1)
     {
         switch (c)
         {
@@ -62,6 +66,16 @@ void parse_cli (cli_t* cli, int argc, char* argv[])
 
                 break;
 
+            case 'z':
+                cli->bind_port_end = atoi(optarg);
+
+                break;
+
+            case 'o':
+                cli->port_offset = atoi(optarg);
+
+                break;
+
             case 'p':
                 cli->protocol = optarg;
 
@@ -76,6 +90,11 @@ void parse_cli (cli_t* cli, int argc, char* argv[])
                 cli->dst_port = atoi(optarg);
 
                 break;
+
+            case 'n':
+                cli->snat_ip = optarg;
+
+                break;
             
             case '?':
                 fprintf(stderr, "Missing argument option...\n");
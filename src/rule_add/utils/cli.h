@@ -19,10 +19,14 @@ struct cli
 
     const char* bind_ip;
     int bind_port;
+    int bind_port_end;
+    int port_offset;
     const char* protocol;
 
     const char* dst_ip;
     int dst_port;
+
+    const char* snat_ip;
 } typedef cli_t;
 
 void parse_cli(cli_t* cmd, int argc, char* argv[]);
\ No newline at end of file
@@ -37,7 +37,7 @@ int main(int argc, char *argv[])
         printf("  -s, --save                        Saves the new config to file system.\n");
         printf("  -h, --help                        Prints this help message.\n\n");
 
-        printf("  -b, --bind-ip <ip>                The bind IP address of the forward rule to delete.\n");
+        printf("  -b, --bind-ip <ip>                The bind IP address or prefix of the forward rule to delete.\n");
         printf("  -x, --bind-port <port>            The bind port of the forward rule to delete.\n");
         printf("  -p, --protocol <tcp/udp/icmp>     The protocol of the forward rule to delete.\n");
 
@@ -66,7 +66,8 @@ int main(int argc, char *argv[])
         return EXIT_FAILURE;
     }
 
-    char bind_ip[INET_ADDRSTRLEN];
+    // Leave room for a prefix length.
+    char bind_ip[INET6_ADDRSTRLEN + 4];
     strncpy(bind_ip, cli.bind_ip, sizeof(bind_ip) - 1);
     bind_ip[sizeof(bind_ip) - 1] = '\0';
 
@@ -83,12 +84,27 @@ int main(int argc, char *argv[])
         return EXIT_FAILURE;
     }
 
+    // This map doesn't exist if port ranges are disabled.
+    int map_fwd_rule_ranges = get_map_pin_fd(XDP_MAP_PIN_DIR, "map_fwd_rule_ranges");
+
+    // This map doesn't exist if bind prefixes are disabled.
+    int map_fwd_rule_prefixes = get_map_pin_fd(XDP_MAP_PIN_DIR, "map_fwd_rule_prefixes");
+
+    int map_maglev = get_map_pin_fd(XDP_MAP_PIN_DIR, "map_maglev");
+
+    if (map_maglev < 0)
+    {
+        fprintf(stderr, "[ERROR] Failed to find 'map_maglev' map.\n");
+
+        return EXIT_FAILURE;
+    }
+
     fwd_rule_cfg_t rule = {0};
     rule.bind_ip = strdup(bind_ip);
     rule.bind_port = cli.bind_port;
     rule.protocol = strdup(protocol);
 
-    if ((ret = delete_fwd_rule(map_fwd_rules, &rule)) != 0)
+    if ((ret = delete_fwd_rule(map_fwd_rules, map_fwd_rule_ranges, map_fwd_rule_prefixes, map_maglev, &rule)) != 0)
     {
         fprintf(stderr, "[ERROR] Failed to delete forward rule '%s:%d' (%s) (%d).\n", bind_ip, cli.bind_port, protocol, ret);
 
@@ -6,12 +6,24 @@
 #include <linux/icmp.h>
 #include <linux/icmpv6.h>
 #include <linux/in.h>
+#include <linux/errno.h>
 #include <stdatomic.h>
 
 #include <common/all.h>
 
 #include <xdp/utils/forward.h>
+#include <xdp/utils/backend.h>
+#include <xdp/utils/rule.h>
+#include <xdp/utils/policer.h>
+#include <xdp/utils/synproxy.h>
+#include <xdp/utils/reject.h>
 #include <xdp/utils/port.h>
+#include <xdp/utils/conn.h>
+#include <xdp/utils/icmp.h>
+#include <xdp/utils/encap.h>
+#include <xdp/utils/tunnel.h>
+#include <xdp/utils/reaper.h>
+#include <xdp/utils/state.h>
 #include <xdp/utils/logging.h>
 #include <xdp/utils/stats.h>
 #include <xdp/utils/helpers.h>
@@ -31,6 +43,9 @@ int xdp_prog_main(struct xdp_md *ctx)
     void *data = (void *)(long)ctx->data;
     void *data_end = (void *)(long)ctx->data_end;
 
+    // The packet's length before it is rewritten (counted towards rule stats).
+    u64 pkt_len = data_end - data;
+
     // Lookup stats map.
     u32 stats_key = 0;
 
@@ -39,35 +54,45 @@ int xdp_prog_main(struct xdp_md *ctx)
     // Initialize Ethernet header.
     struct ethhdr *eth = data;
 
-    // Check Ethernet header.
-    if (unlikely(eth + 1 > (struct ethhdr *)data_end))
-    {
-        inc_pkt_stats(stats, STATS_TYPE_DROPPED);
+    // Initialize IP headers.
+    struct iphdr *iph = NULL;
+    struct ipv6hdr *iph6 = NULL;
 
-        return XDP_DROP;
-    }
+    u8 protocol = 0;
+    void *l4_hdr = NULL;
+
+    u128 src_ip = 0;
+    u128 dst_ip = 0;
 
-    // If not IPv4, pass down network stack. Will be adding IPv6 support later on.
-    if (unlikely(eth->h_proto != htons(ETH_P_IP)))
+    // Packets that aren't IPv4 or IPv6 are passed down the network stack.
+    int action;
+
+    if ((action = parse_ip_hdr(data, data_end, &iph, &iph6, &protocol, &l4_hdr, &src_ip, &dst_ip)) != 0)
     {
-        inc_pkt_stats(stats, STATS_TYPE_PASSED);
+        inc_pkt_stats(stats, (action == XDP_DROP) ? STATS_TYPE_DROPPED : STATS_TYPE_PASSED);
 
-        return XDP_PASS;
+        return action;
     }
 
-    // Initialize IP header.
-    struct iphdr *iph = data + sizeof(struct ethhdr);
+#ifdef ENABLE_TUNNELS
+    // The tunnel the packet arrived through (0 = none). Packets from configured tunnel endpoints are handled like the packet they carry.
+    u32 tunnel_id = 0;
 
-    // Check IP header.
-    if (unlikely(iph + 1 > (struct iphdr *)data_end))
+    if ((protocol == IPPROTO_GRE || protocol == IPPROTO_IPIP || protocol == IPPROTO_IPV6) && (tunnel_id = strip_tunnel(ctx, iph, iph6, protocol, src_ip, dst_ip, l4_hdr, &data, &data_end, &eth)) > 0)
     {
-        inc_pkt_stats(stats, STATS_TYPE_DROPPED);
+        pkt_len = data_end - data;
 
-        return XDP_DROP;
+        if ((action = parse_ip_hdr(data, data_end, &iph, &iph6, &protocol, &l4_hdr, &src_ip, &dst_ip)) != 0)
+        {
+            inc_pkt_stats(stats, (action == XDP_DROP) ? STATS_TYPE_DROPPED : STATS_TYPE_PASSED);
+
+            return action;
+        }
     }
+#endif
 
-    // We only support TCP, UDP, and ICMP for forwarding at this moment.
-    if (iph->protocol != IPPROTO_TCP && iph->protocol != IPPROTO_UDP && iph->protocol != IPPROTO_ICMP)
+    // We only support TCP, UDP, ICMP, and ICMPv6 for forwarding at this moment.
+    if (protocol != IPPROTO_TCP && protocol != IPPROTO_UDP && !(iph && protocol == IPPROTO_ICMP) && !(iph6 && protocol == IPPROTO_ICMPV6))
     {
         inc_pkt_stats(stats, STATS_TYPE_PASSED);
 
@@ -78,11 +103,12 @@ int xdp_prog_main(struct xdp_md *ctx)
     struct udphdr *udph = NULL;
     struct tcphdr *tcph = NULL;
     struct icmphdr *icmph = NULL;
+    struct icmp6hdr *icmp6h = NULL;
 
-    switch (iph->protocol)
+    switch (protocol)
     {
         case IPPROTO_TCP:
-            tcph = data + sizeof(struct ethhdr) + (iph->ihl * 4);
+            tcph = l4_hdr;
 
             if (tcph + 1 > (struct tcphdr *)data_end)
             {
@@ -94,7 +120,7 @@ int xdp_prog_main(struct xdp_md *ctx)
             break;
 
         case IPPROTO_UDP:
-            udph = data + sizeof(struct ethhdr) + (iph->ihl * 4);
+            udph = l4_hdr;
 
             if (udph + 1 > (struct udphdr *)data_end)
             {
@@ -106,7 +132,7 @@ int xdp_prog_main(struct xdp_md *ctx)
             break;
 
         case IPPROTO_ICMP:
-            icmph = data + sizeof(struct ethhdr) + (iph->ihl * 4);
+            icmph = l4_hdr;
 
             if (icmph + 1 > (struct icmphdr *)data_end)
             {
@@ -115,165 +141,429 @@ int xdp_prog_main(struct xdp_md *ctx)
                 return XDP_DROP;
             }
 
+            break;
+
+        case IPPROTO_ICMPV6:
+            icmp6h = l4_hdr;
+
+            if (icmp6h + 1 > (struct icmp6hdr *)data_end)
+            {
+                inc_pkt_stats(stats, STATS_TYPE_DROPPED);
+
+                return XDP_DROP;
+            }
+
             break;
     }
 
-    u16 src_port = (tcph) ? tcph->source : (udph) ? udph->source : 0;
+    // ICMP echo identifiers are mapped like source ports (requests carry the client's identifier and replies the one we handed out).
+    int echo_request = (icmph && icmph->type == ICMP_ECHO) || (icmp6h && icmp6h->icmp6_type == ICMPV6_ECHO_REQUEST);
+    int echo_reply = (icmph && icmph->type == ICMP_ECHOREPLY) || (icmp6h && icmp6h->icmp6_type == ICMPV6_ECHO_REPLY);
+
+    u16 echo_id = (icmph) ? icmph->un.echo.id : (icmp6h) ? icmp6h->icmp6_dataun.u_echo.identifier : 0;
+
+    u16 src_port = (tcph) ? tcph->source : (udph) ? udph->source : (echo_request) ? echo_id : 0;
     u16 dst_port = (tcph) ? tcph->dest : (udph) ? udph->dest : 0;
 
     // Construct forward key.
     fwd_rule_key_t rule_key = {0};
     
-    rule_key.ip = iph->daddr;
+    rule_key.ip = dst_ip;
     rule_key.port = dst_port;
-    rule_key.protocol = iph->protocol;
+    rule_key.protocol = protocol;
 
-    fwd_rule_val_t *rule = bpf_map_lookup_elem(&map_fwd_rules, &rule_key);
+    fwd_rule_val_t *rule = get_fwd_rule(&rule_key);
 
     if (rule)
     {
-        // Ensure we aren't actually receiving replies back from the destination address on the same bind and source port. Or ICMP replies.
-        if (iph->saddr == rule->dst_ip)
+        // Only echo requests are forwarded with ICMP since neighbor discovery (ICMPv6) and errors must still reach the network stack.
+        if ((icmph || icmp6h) && !echo_request)
         {
             goto no_rule;
         }
 
         u64 now = bpf_ktime_get_ns();
 
-        // Check if we have an existing connection.
+#ifdef ENABLE_DSR
+        // DSR rules don't track connections since backends answer clients directly. Maglev keeps each flow on the same backend instead.
+        if (rule->dsr)
+        {
+            backend_t* backend = get_backend(rule, src_ip, src_port);
+
+            if (!backend)
+            {
+                inc_pkt_stats(stats, STATS_TYPE_DROPPED);
+                inc_fwd_rule_stats(rule->id, 0, 0, XDP_DROP, pkt_len);
+
+#ifdef ENABLE_FAST_REJECT
+                if (rule->fast_reject)
+                {
+                    int ret = send_reject(ctx, data, data_end, eth, iph, iph6, tcph, udph);
+
+#ifdef ENABLE_TUNNELS
+                    ret = encap_local_reply(ctx, tunnel_id, ret);
+#endif
+
+                    return ret;
+                }
+#endif
+
+                return XDP_DROP;
+            }
+
+#ifdef ENABLE_POLICERS
+            if (police_client(rule, src_ip, pkt_len, now) || police_rule(rule, pkt_len, now))
+            {
+                inc_pkt_stats(stats, STATS_TYPE_DROPPED);
+                inc_fwd_rule_stats(rule->id, 0, 0, XDP_DROP, pkt_len);
+
+                return XDP_DROP;
+            }
+#endif
+
+            // The outer source IP is the source NAT IP (matching the backend's address family) or the bind IP.
+            u8 outer_protocol = 0;
+
+            if (encap_packet(ctx, rule->dsr, (rule->snat_ip) ? rule->snat_ip : dst_ip, backend->ip, get_flow_hash(src_ip, src_port), &data, &data_end, &eth, &iph, &iph6, &outer_protocol))
+            {
+                inc_pkt_stats(stats, STATS_TYPE_DROPPED);
+                inc_fwd_rule_stats(rule->id, 0, 0, XDP_DROP, pkt_len);
+
+                return XDP_DROP;
+            }
+
+            int ret = send_packet(1, stats, ctx, &data, &data_end, &eth, iph, iph6, outer_protocol);
+
+            inc_fwd_rule_stats(rule->id, 0, 0, ret, pkt_len);
+
+            return ret;
+        }
+#endif
+
+        // Check if we have an existing connection (a single lookup since the connection holds everything needed to forward the packet).
         conn_key_t conn_key = {0};
 
-        conn_key.src_ip = iph->saddr;
+        conn_key.src_ip = src_ip;
         conn_key.src_port = src_port;
 
-        conn_key.bind_ip = iph->daddr;
+        conn_key.bind_ip = dst_ip;
         conn_key.bind_port = dst_port;
 
-        conn_key.protocol = iph->protocol;
+        conn_key.protocol = protocol;
 
         conn_val_t* conn = bpf_map_lookup_elem(&map_connections, &conn_key);
 
         if (conn)
         {
-            // Perform lookup on ports map and make sure we're still valid.
-            port_key_t port_key = {0};
-            port_key.bind_ip = iph->daddr;
-            port_key.protocol = iph->protocol;
-
-            port_key.port = conn->port;
-
-            port_val_t* port_lookup = bpf_map_lookup_elem(&map_ports, &port_key);
-
-            // If lookup fails, destroy connection.
-            if (!port_lookup)
+#ifdef ENABLE_POLICERS
+            // Drop packets over the client's or rule's rates before they're rewritten (clients are checked first so they can't use up the rule's budget).
+            if (police_client(rule, src_ip, pkt_len, now) || police_rule(rule, pkt_len, now))
             {
-                bpf_map_delete_elem(&map_connections, &conn_key);
-
                 inc_pkt_stats(stats, STATS_TYPE_DROPPED);
+                inc_fwd_rule_stats(rule->id, 0, 0, XDP_DROP, pkt_len);
 
                 return XDP_DROP;
             }
+#endif
 
-            // If the port lookup's source IP doesn't match the client's information, also destroy.
-            if (port_lookup->src_ip != iph->saddr || port_lookup->src_port != src_port)
+#ifdef ENABLE_SYN_COOKIES
+            if (tcph && (rule->syn_cookies || conn->syn_proxy))
             {
-                bpf_map_delete_elem(&map_connections, &conn_key);
+                // Retransmitted SYNs and clients reusing their source port are answered with a SYN cookie as well.
+                if (rule->syn_cookies && tcph->syn && !tcph->ack)
+                {
+                    int ret = send_syn_cookie(ctx, data, data_end, eth, iph, iph6, tcph);
 
-                inc_pkt_stats(stats, STATS_TYPE_DROPPED);
+#ifdef ENABLE_TUNNELS
+                    ret = encap_local_reply(ctx, tunnel_id, ret);
+#endif
 
-                return XDP_DROP;
+                    inc_pkt_stats(stats, (ret == XDP_TX) ? STATS_TYPE_FORWARDED : STATS_TYPE_DROPPED);
+                    inc_fwd_rule_stats(rule->id, 0, 0, ret, pkt_len);
+
+                    return ret;
+                }
+
+                u32 cookie = 0;
+
+                // A valid cookie on a finished connection opens a new connection to the destination.
+                if (rule->syn_cookies && (conn->tcp_state == CONN_TCP_TIME_WAIT || conn->tcp_state == CONN_TCP_CLOSED) && check_syn_cookie(iph, iph6, tcph, &cookie) == 0)
+                {
+                    if (make_proxy_syn(ctx, &data, &data_end, &eth, &iph, &iph6, &tcph))
+                    {
+                        inc_pkt_stats(stats, STATS_TYPE_DROPPED);
+                        inc_fwd_rule_stats(rule->id, 0, 0, XDP_DROP, pkt_len);
+
+                        return XDP_DROP;
+                    }
+
+                    conn->syn_proxy = CONN_SYN_PROXY_HANDSHAKE;
+                    conn->seq_delta = cookie;
+                }
+                else if (conn->syn_proxy == CONN_SYN_PROXY_HANDSHAKE)
+                {
+                    // The destination hasn't answered yet (the client retransmits its packets).
+                    inc_pkt_stats(stats, STATS_TYPE_DROPPED);
+                    inc_fwd_rule_stats(rule->id, 0, 0, XDP_DROP, pkt_len);
+
+                    return XDP_DROP;
+                }
+                else if (conn->syn_proxy == CONN_SYN_PROXY_ESTABLISHED)
+                {
+                    adjust_proxy_seq(tcph, conn->seq_delta, 1);
+                }
             }
+#endif
 
-#ifdef CONNECTION_COUNTERS
             // Update connection stats.
+#ifndef RECYCLE_LAST_SEEN
             conn->count++;
-            conn->last_seen = now;
 #endif
+            update_conn_last_seen(conn, now);
 
-            // Update port stats.
-            port_lookup->count++;
-            port_lookup->last_seen = now;
+            // The reply copy only needs to be written when the state changed.
+            if (tcph && update_tcp_state(conn, tcph, 1))
+            {
+                sync_conn_state(conn, protocol, 1);
+            }
 
             // Forward the packet.
-            return fwd_packet(rule, conn, stats, ctx, &data, &data_end, &eth, &iph, &tcph, &udph, &icmph);
+            int ret = fwd_packet(rule, conn, stats, ctx, &data, &data_end, &eth, &iph, &iph6, &tcph, &udph, &icmph, &icmp6h);
+
+            inc_fwd_rule_stats(rule->id, 0, 0, ret, pkt_len);
+            inc_conn_stats(&conn_key, 0, 0, ret, pkt_len);
+
+            return ret;
         }
         else
         {
-            u16 port_to_use = 0;
+            // Ensure we aren't actually receiving replies from any of the rule's backends on a source port handed out from the bind address.
+            if (!echo_request)
+            {
+                conn_key_t reply_key = {0};
+                get_reply_conn_key(dst_ip, dst_port, protocol, &reply_key);
 
-            port_key_t port_key = {0};
-            port_key.bind_ip = iph->daddr;
-            port_key.protocol = iph->protocol;
+                if (bpf_map_lookup_elem(&map_connections, &reply_key))
+                {
+                    goto no_rule;
+                }
+            }
 
-            if (!icmph)
+            // Choose the backend for the new connection.
+            backend_t* backend = get_backend(rule, src_ip, src_port);
+
+            // The rule has no backends or all of them are down.
+            if (!backend)
             {
-                port_ctx_t port_ctx = {0};
-                port_ctx.last = UINT64_MAX;
-                port_ctx.port_to_use = 0;
-                port_ctx.port_key = port_key;
-
-#ifdef USE_NEW_LOOP
-                bpf_loop(MAX_PORTS, choose_port, &port_ctx, 0);
-#else
-                for (u16 i = MIN_PORT; i <= MAX_PORT; i++)
+                inc_pkt_stats(stats, STATS_TYPE_DROPPED);
+                inc_fwd_rule_stats(rule->id, 0, 0, XDP_DROP, pkt_len);
+
+#ifdef ENABLE_FAST_REJECT
+                if (rule->fast_reject)
                 {
-                    if (choose_port(i - MIN_PORT, &port_ctx))
-                    {
-                        break;
-                    }
+                    int ret = send_reject(ctx, data, data_end, eth, iph, iph6, tcph, udph);
+
+#ifdef ENABLE_TUNNELS
+                    ret = encap_local_reply(ctx, tunnel_id, ret);
+#endif
+
+                    return ret;
+                }
+#endif
+
+                return XDP_DROP;
+            }
+
+#ifdef ENABLE_POLICERS
+            // Drop packets over the client's or rule's rates before they're rewritten (clients are checked first so they can't use up the rule's budget).
+            if (police_client(rule, src_ip, pkt_len, now) || police_rule(rule, pkt_len, now))
+            {
+                inc_pkt_stats(stats, STATS_TYPE_DROPPED);
+                inc_fwd_rule_stats(rule->id, 0, 0, XDP_DROP, pkt_len);
+
+                return XDP_DROP;
+            }
+#endif
+
+            u8 syn_proxy = CONN_SYN_PROXY_NONE;
+
+#ifdef ENABLE_SYN_COOKIES
+            u32 cookie = 0;
+
+            if (tcph && rule->syn_cookies)
+            {
+                // Answer SYNs without allocating a source port.
+                if (tcph->syn && !tcph->ack)
+                {
+                    int ret = send_syn_cookie(ctx, data, data_end, eth, iph, iph6, tcph);
+
+#ifdef ENABLE_TUNNELS
+                    ret = encap_local_reply(ctx, tunnel_id, ret);
+#endif
+
+                    inc_pkt_stats(stats, (ret == XDP_TX) ? STATS_TYPE_FORWARDED : STATS_TYPE_DROPPED);
+                    inc_fwd_rule_stats(rule->id, 0, 0, ret, pkt_len);
+
+                    return ret;
                 }
+
+                // Only an ACK carrying a valid cookie creates a connection. It is turned into the SYN sent to the destination.
+                if (check_syn_cookie(iph, iph6, tcph, &cookie) || make_proxy_syn(ctx, &data, &data_end, &eth, &iph, &iph6, &tcph))
+                {
+                    inc_pkt_stats(stats, STATS_TYPE_DROPPED);
+                    inc_fwd_rule_stats(rule->id, 0, 0, XDP_DROP, pkt_len);
+
+                    return XDP_DROP;
+                }
+
+                syn_proxy = CONN_SYN_PROXY_HANDSHAKE;
+            }
 #endif
-                port_to_use = port_ctx.port_to_use;
+
+#ifdef ENABLE_CONN_RATE_LIMITS
+            // Cap how fast a client creates connections before it costs us a source port.
+            if (limit_new_conn(rule, src_ip, now))
+            {
+                inc_pkt_stats(stats, STATS_TYPE_DROPPED);
+                inc_fwd_rule_stats(rule->id, 0, 0, XDP_DROP, pkt_len);
+
+                return XDP_DROP;
             }
+#endif
+
+            u16 port_to_use = 0;
+
+            // Source ports belong to the IP used towards the destination.
+            u128 snat_ip = (rule->snat_ip) ? rule->snat_ip : dst_ip;
+
+            port_key_t port_key = {0};
+            port_key.bind_ip = snat_ip;
+            port_key.protocol = protocol;
+
+            // ICMP echoes are handed out an identifier from the same pool.
+            port_to_use = alloc_port(&port_key);
 
-            if (port_to_use > 0 || icmph)
+            if (port_to_use > 0)
             {
                 // Firstly, create connection.
                 conn_val_t new_conn = {0};
-                new_conn.src_ip = iph->saddr;
+                new_conn.src_ip = src_ip;
                 new_conn.src_port = src_port;
 
+                new_conn.bind_ip = dst_ip;
                 new_conn.bind_port = dst_port;
 
-#ifdef CONNECTION_COUNTERS
+                new_conn.snat_ip = snat_ip;
+
+                new_conn.dst_ip = backend->ip;
+                new_conn.dst_port = backend->port;
+
+                // Port range rules may forward each bind port to its own backend port.
+                if (rule->port_offset)
+                {
+                    new_conn.dst_port = htons(ntohs(backend->port) + (ntohs(dst_port) - ntohs(rule->bind_port)));
+                }
+
+                new_conn.rule_id = rule->id;
+
+#ifdef ENABLE_TUNNELS
+                new_conn.tunnel_id = tunnel_id;
+#endif
+
                 new_conn.count = 1;
+
                 new_conn.first_seen = now;
                 new_conn.last_seen = now;
+
+                new_conn.timeout = rule->timeout;
+                new_conn.close_timeout = rule->close_timeout;
+                new_conn.time_wait_timeout = rule->time_wait_timeout;
+
+                if (tcph)
+                {
+                    new_conn.tcp_state = get_new_tcp_state(tcph);
+                }
+
+#ifdef ENABLE_SYN_COOKIES
+                new_conn.syn_proxy = syn_proxy;
+                new_conn.seq_delta = cookie;
+#endif
+
+#ifdef CONNECTION_COUNTERS
+                // Don't carry over counters of a previous connection with the same key.
+                bpf_map_delete_elem(&map_conn_stats, &conn_key);
 #endif
                 
                 new_conn.port = htons(port_to_use);
 
-                bpf_map_update_elem(&map_connections, &conn_key, &new_conn, BPF_ANY);
+                set_conn_csum_deltas(&new_conn, protocol);
+
+                // Store the connection under the client's key and the reply key the destination's replies are looked up by.
+                conn_key_t reply_key = {0};
+                get_reply_conn_key(snat_ip, new_conn.port, protocol, &reply_key);
 
-                // Next, add to the port map.
-                port_key.port = new_conn.port;
+                int err = bpf_map_update_elem(&map_connections, &conn_key, &new_conn, BPF_ANY);
 
-                port_val_t new_port = {0};
-                new_port.src_ip = iph->saddr;
-                new_port.src_port = src_port;
+                // The reply key must not replace another connection's, or that connection's replies would be stolen.
+                if (!err)
+                {
+                    err = bpf_map_update_elem(&map_connections, &reply_key, &new_conn, BPF_NOEXIST);
+                }
+
+                if (err)
+                {
+                    // Don't keep a connection that replies can't find.
+                    bpf_map_delete_elem(&map_connections, &conn_key);
+
+                    // A port whose reply key exists still belongs to that connection and must not go back to the pool.
+                    if (err != -EEXIST)
+                    {
+                        port_key.port = new_conn.port;
+                        release_port(&port_key);
+                    }
 
-                new_port.bind_port = dst_port;
+                    inc_pkt_stats(stats, STATS_TYPE_DROPPED);
+                    inc_fwd_rule_stats(rule->id, 0, 0, XDP_DROP, pkt_len);
 
-                new_port.count = 1;
+                    return XDP_DROP;
+                }
 
-                new_port.first_seen = now;
-                new_port.last_seen = now;
+#ifdef ENABLE_CONN_REAPER
+                start_conn_reaper();
+#endif
 
-                bpf_map_update_elem(&map_ports, &port_key, &new_port, BPF_ANY);
+                int ret = fwd_packet(rule, &new_conn, stats, ctx, &data, &data_end, &eth, &iph, &iph6, &tcph, &udph, &icmph, &icmp6h);
 
-                int ret = fwd_packet(rule, &new_conn, stats, ctx, &data, &data_end, &eth, &iph, &tcph, &udph, &icmph);
+                inc_fwd_rule_stats(rule->id, 0, 1, ret, pkt_len);
+                inc_conn_stats(&conn_key, 0, 1, ret, pkt_len);
 
 #ifdef ENABLE_RULE_LOGGING
-                if (ret == XDP_TX && rule->log)
+                if ((ret == XDP_TX || ret == XDP_REDIRECT) && rule->log)
                 {
-                    log_msg(now, new_conn.port, new_port.src_ip, src_port, rule_key.ip, dst_port, iph->protocol, rule->dst_ip, rule->dst_port);
+                    log_msg(now, new_conn.port, src_ip, src_port, rule_key.ip, dst_port, protocol, new_conn.dst_ip, new_conn.dst_port);
                 }
 #endif
 
                 return ret;
             }
 
+            // There are no free source ports left.
             inc_pkt_stats(stats, STATS_TYPE_DROPPED);
+            inc_fwd_rule_stats(rule->id, 0, 0, XDP_DROP, pkt_len);
+
+#ifdef ENABLE_FAST_REJECT
+            // The client's ACK was already turned into the destination's SYN with the SYN proxy.
+            if (rule->fast_reject && syn_proxy == CONN_SYN_PROXY_NONE)
+            {
+                int ret = send_reject(ctx, data, data_end, eth, iph, iph6, tcph, udph);
+
+#ifdef ENABLE_TUNNELS
+                ret = encap_local_reply(ctx, tunnel_id, ret);
+#endif
+
+                return ret;
+            }
+#endif
 
             return XDP_DROP;
         }
@@ -282,43 +572,106 @@ int xdp_prog_main(struct xdp_md *ctx)
     {
 no_rule:;
         
-        if (!icmph)
+        if ((!icmph && !icmp6h) || echo_reply)
         {
-            port_key_t port_key = {0};
-            port_key.bind_ip = iph->daddr;
-            port_key.protocol = iph->protocol;
-            port_key.port = dst_port;
+            // Replies are looked up by the source NAT IP and port (or echo identifier) they're sent to.
+            conn_key_t reply_key = {0};
+            get_reply_conn_key(dst_ip, (echo_reply) ? echo_id : dst_port, protocol, &reply_key);
 
-            // Find out what the client IP is.
-            port_val_t* port_lookup = bpf_map_lookup_elem(&map_ports, &port_key);
+            conn_val_t* conn = bpf_map_lookup_elem(&map_connections, &reply_key);
 
-            if (port_lookup)
+            if (conn)
             {
-                // Perform connection lookup.
-                conn_key_t conn_key = {0};
-                conn_key.src_ip = port_lookup->src_ip;
-                conn_key.src_port = port_lookup->src_port;
+                // Replies keep the connection alive as well.
+                update_conn_last_seen(conn, bpf_ktime_get_ns());
 
-                conn_key.bind_ip = iph->daddr;
-                conn_key.bind_port = port_lookup->bind_port;
+#ifdef ENABLE_SYN_COOKIES
+                if (tcph && conn->syn_proxy == CONN_SYN_PROXY_HANDSHAKE)
+                {
+                    // The client already got its SYN-ACK, so we complete the handshake with the destination ourselves.
+                    if (tcph->syn && tcph->ack)
+                    {
+                        conn->seq_delta = ntohl(tcph->seq) - conn->seq_delta;
+                        conn->syn_proxy = CONN_SYN_PROXY_ESTABLISHED;
 
-                conn_key.protocol = iph->protocol;
+                        update_tcp_state(conn, tcph, 0);
+                        sync_conn_state(conn, protocol, 0);
 
-                conn_val_t* conn = bpf_map_lookup_elem(&map_connections, &conn_key);
+                        u32 rule_id = conn->rule_id;
+
+                        int ret = ack_proxy_synack(ctx, data, data_end, eth, iph, iph6, tcph);
+
+                        inc_pkt_stats(stats, (ret == XDP_TX) ? STATS_TYPE_FORWARDED : STATS_TYPE_DROPPED);
+                        inc_fwd_rule_stats(rule_id, 1, 0, ret, pkt_len);
+
+                        return ret;
+                    }
+
+                    if (!tcph->rst)
+                    {
+                        inc_pkt_stats(stats, STATS_TYPE_DROPPED);
+                        inc_fwd_rule_stats(conn->rule_id, 1, 0, XDP_DROP, pkt_len);
 
-                if (conn)
+                        return XDP_DROP;
+                    }
+
+                    // Pass on the destination refusing the connection with the sequence number the client expects.
+                    u32 old_seq = tcph->seq;
+
+                    tcph->seq = htonl(conn->seq_delta + 1);
+                    tcph->check = csum_diff4(old_seq, tcph->seq, tcph->check);
+                }
+                else if (tcph && conn->syn_proxy == CONN_SYN_PROXY_ESTABLISHED)
                 {
-                    // Now forward packet back to actual client.
-                    return fwd_packet(NULL, conn, stats, ctx, &data, &data_end, &eth, &iph, &tcph, &udph, &icmph);
+                    adjust_proxy_seq(tcph, conn->seq_delta, 0);
                 }
+#endif
+
+                if (tcph && update_tcp_state(conn, tcph, 0))
+                {
+                    sync_conn_state(conn, protocol, 0);
+                }
+
+                u32 rule_id = conn->rule_id;
+
+                // Replies are counted under the client's key.
+                conn_key_t conn_key = {0};
+                get_conn_key(conn, protocol, &conn_key);
+
+                // Now forward packet back to actual client.
+                int ret = fwd_packet(NULL, conn, stats, ctx, &data, &data_end, &eth, &iph, &iph6, &tcph, &udph, &icmph, &icmp6h);
+
+                inc_fwd_rule_stats(rule_id, 1, 0, ret, pkt_len);
+                inc_conn_stats(&conn_key, 1, 0, ret, pkt_len);
+
+                return ret;
             }
         }
-        else if (icmph->type == ICMP_ECHOREPLY)
+        else if (is_icmp_error(icmph, icmp6h))
         {
-            // Handle ICMP replies.
-            conn_val_t new_conn = {0};
+            // Errors about packets we forwarded (e.g. fragmentation needed for path MTU discovery) are sent on to the client.
+            conn_val_t* conn = rewrite_icmp_error(data_end, iph, iph6, icmph, icmp6h);
+
+            if (conn)
+            {
+                u32 rule_id = conn->rule_id;
 
-            return fwd_packet(NULL, &new_conn, stats, ctx, &data, &data_end, &eth, &iph, &tcph, &udph, &icmph);
+#ifdef ENABLE_TUNNELS
+                if (encap_tunnel_reply(ctx, conn->tunnel_id, &data, &data_end, &eth, &iph, &iph6, &protocol))
+                {
+                    inc_pkt_stats(stats, STATS_TYPE_DROPPED);
+                    inc_fwd_rule_stats(rule_id, 1, 0, XDP_DROP, pkt_len);
+
+                    return XDP_DROP;
+                }
+#endif
+
+                int ret = send_packet(0, stats, ctx, &data, &data_end, &eth, iph, iph6, protocol);
+
+                inc_fwd_rule_stats(rule_id, 1, 0, ret, pkt_len);
+
+                return ret;
+            }
         }
     }
 
@@ -0,0 +1,109 @@
+#include <xdp/utils/backend.h>
+
+/**
+ * Hashes a client's address and port (MurmurHash3 mixing).
+ * 
+ * @param src_ip The client's IP.
+ * @param src_port The client's port.
+ * 
+ * @return The 32-bit hash.
+ */
+static __always_inline u32 get_flow_hash(u128 src_ip, u16 src_port)
+{
+    u32 addr[4];
+
+    memcpy(addr, &src_ip, sizeof(addr));
+
+    u32 hash = src_port;
+
+#pragma clang loop unroll(full)
+    for (int i = 0; i < 4; i++)
+    {
+        u32 k = addr[i] * 0xcc9e2d51;
+        k = (k << 15) | (k >> 17);
+        k *= 0x1b873593;
+
+        hash ^= k;
+        hash = (hash << 13) | (hash >> 19);
+        hash = hash * 5 + 0xe6546b64;
+    }
+
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6b;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35;
+    hash ^= hash >> 16;
+
+    return hash;
+}
+
+/**
+ * Chooses the backend of a forward rule for a new connection. Backends marked down are skipped in favor of the following lookup table slots' backends.
+ * 
+ * @param rule A pointer to the forward rule.
+ * @param src_ip The client's IP.
+ * @param src_port The client's port.
+ * 
+ * @return A pointer to the backend or NULL if the rule has no backends or every backend tried is down.
+ */
+static __always_inline backend_t* get_backend(fwd_rule_val_t* rule, u128 src_ip, u16 src_port)
+{
+    if (rule->backends_cnt < 1 || rule->id >= MAX_FWD_RULES)
+    {
+        return NULL;
+    }
+
+    u32 key = rule->id * MAX_BACKENDS;
+
+    // Rules with a single backend don't need their lookup table and have nothing to fail over to.
+    if (rule->backends_cnt < 2)
+    {
+        backend_t* backend = bpf_map_lookup_elem(&map_backends, &key);
+
+        if (!backend || backend->down)
+        {
+            return NULL;
+        }
+
+        return backend;
+    }
+
+    void* table = bpf_map_lookup_elem(&map_maglev, &rule->id);
+
+    if (!table)
+    {
+        return NULL;
+    }
+
+    u32 slot = get_flow_hash(src_ip, src_port) % MAGLEV_TABLE_SIZE;
+
+    for (int i = 0; i < MAGLEV_FAILOVER_SLOTS; i++)
+    {
+        u32* backend_idx = bpf_map_lookup_elem(table, &slot);
+
+        if (!backend_idx)
+        {
+            break;
+        }
+
+        if (*backend_idx < MAX_BACKENDS)
+        {
+            u32 backend_key = key + *backend_idx;
+
+            backend_t* backend = bpf_map_lookup_elem(&map_backends, &backend_key);
+
+            if (backend && !backend->down)
+            {
+                return backend;
+            }
+        }
+
+        if (++slot >= MAGLEV_TABLE_SIZE)
+        {
+            slot = 0;
+        }
+    }
+
+    // Every backend tried is down, so the connection is dropped (or rejected) instead of being sent to a dead backend.
+    return NULL;
+}
\ No newline at end of file
@@ -0,0 +1,244 @@
+#include <xdp/utils/conn.h>
+
+/**
+ * Retrieves the client's key of a connection.
+ * 
+ * @param conn A pointer to the connection.
+ * @param protocol The connection's protocol.
+ * @param key A pointer to store the key in.
+ * 
+ * @return void
+ */
+static __always_inline void get_conn_key(conn_val_t* conn, u8 protocol, conn_key_t* key)
+{
+    key->src_ip = conn->src_ip;
+    key->src_port = conn->src_port;
+
+    key->bind_ip = conn->bind_ip;
+    key->bind_port = conn->bind_port;
+
+    key->protocol = protocol;
+}
+
+/**
+ * Retrieves the reply key of a connection (the source NAT IP and source port the destination replies to).
+ * 
+ * @param snat_ip The source NAT IP.
+ * @param port The source port (network byte order).
+ * @param protocol The connection's protocol.
+ * @param key A pointer to store the key in.
+ * 
+ * @return void
+ */
+static __always_inline void get_reply_conn_key(u128 snat_ip, u16 port, u8 protocol, conn_key_t* key)
+{
+    key->src_ip = 0;
+    key->src_port = 0;
+
+    key->bind_ip = snat_ip;
+    key->bind_port = port;
+
+    key->protocol = protocol;
+}
+
+/**
+ * Checks whether a key is the reply key of a connection (clients always have a source IP).
+ * 
+ * @param key A pointer to the key.
+ * 
+ * @return 1 if it's a reply key or 0 if it's a client's key.
+ */
+static __always_inline int is_reply_conn_key(conn_key_t* key)
+{
+    return key->src_ip == 0;
+}
+
+/**
+ * Updates the last seen time of a connection's copy if it's older than LAST_SEEN_UPDATE_INTERVAL.
+ * 
+ * @param conn A pointer to the connection.
+ * @param now The current timestamp.
+ * 
+ * @return void
+ */
+static __always_inline void update_conn_last_seen(conn_val_t* conn, u64 now)
+{
+    // Skip the write while the time is recent enough so the entry's cache line isn't dirtied on every packet.
+    if (now - conn->last_seen < LAST_SEEN_UPDATE_INTERVAL * 1000000ULL)
+    {
+        return;
+    }
+
+    conn->last_seen = now;
+}
+
+/**
+ * Retrieves when a connection was last seen in either direction.
+ * 
+ * @param conn A pointer to the connection's reply copy.
+ * @param protocol The connection's protocol.
+ * @param count If not NULL, stores the amount of packets sent by the client here.
+ * 
+ * @return The last seen timestamp.
+ */
+static __always_inline u64 get_conn_last_seen(conn_val_t* conn, u8 protocol, u64* count)
+{
+    u64 last_seen = conn->last_seen;
+
+    conn_key_t key = {0};
+    get_conn_key(conn, protocol, &key);
+
+    conn_val_t* client_conn = bpf_map_lookup_elem(&map_connections, &key);
+
+    if (client_conn && client_conn->last_seen > last_seen)
+    {
+        last_seen = client_conn->last_seen;
+    }
+
+    if (count)
+    {
+        *count = (client_conn) ? client_conn->count : conn->count;
+    }
+
+    return last_seen;
+}
+
+/**
+ * Copies a connection's TCP and SYN proxy states to its other copy.
+ * 
+ * This costs a second lookup, but is only needed when the states change.
+ * 
+ * @param conn A pointer to the connection's copy that was updated.
+ * @param protocol The connection's protocol.
+ * @param from_client 1 if the client's copy was updated or 0 if the reply copy was.
+ * 
+ * @return void
+ */
+static __always_inline void sync_conn_state(conn_val_t* conn, u8 protocol, int from_client)
+{
+    conn_key_t key = {0};
+
+    if (from_client)
+    {
+        get_reply_conn_key(conn->snat_ip, conn->port, protocol, &key);
+    }
+    else
+    {
+        get_conn_key(conn, protocol, &key);
+    }
+
+    conn_val_t* other = bpf_map_lookup_elem(&map_connections, &key);
+
+    if (!other)
+    {
+        return;
+    }
+
+    other->tcp_state = conn->tcp_state;
+    other->fin_flags = conn->fin_flags;
+
+    other->syn_proxy = conn->syn_proxy;
+    other->seq_delta = conn->seq_delta;
+}
+
+/**
+ * Checks whether two entries of the connections map belong to the same connection (both of a connection's entries are inserted with the same values).
+ * 
+ * @param conn A pointer to the first connection.
+ * @param other A pointer to the second connection.
+ * 
+ * @return 1 if they're the same connection or 0 if not.
+ */
+static __always_inline int is_same_conn(conn_val_t* conn, conn_val_t* other)
+{
+    return conn->src_ip == other->src_ip && conn->src_port == other->src_port && conn->bind_ip == other->bind_ip && conn->bind_port == other->bind_port && conn->snat_ip == other->snat_ip && conn->port == other->port && conn->first_seen == other->first_seen;
+}
+
+/**
+ * Removes both keys of a connection.
+ * 
+ * The reply key is removed first and the client key only if we removed the reply key. Either key is left alone if it belongs to another connection by now (e.g. the port was recycled or the client reconnected).
+ * 
+ * @param conn A pointer to a copy of the connection (it must not point into the map since the entries it's compared with are removed).
+ * @param protocol The connection's protocol.
+ * 
+ * @return 0 if we removed the reply key (the caller may release the source port) or 1 otherwise.
+ */
+static __always_inline int delete_conn(conn_val_t* conn, u8 protocol)
+{
+    conn_key_t reply_key = {0};
+    get_reply_conn_key(conn->snat_ip, conn->port, protocol, &reply_key);
+
+    conn_val_t* reply_conn = bpf_map_lookup_elem(&map_connections, &reply_key);
+
+    if (!reply_conn || !is_same_conn(conn, reply_conn))
+    {
+        return 1;
+    }
+
+    conn_key_t key = {0};
+    get_conn_key(conn, protocol, &key);
+
+    if (bpf_map_delete_elem(&map_connections, &reply_key) != 0)
+    {
+        return 1;
+    }
+
+    // The client may have reconnected with another source port in the meantime.
+    conn_val_t* client_conn = bpf_map_lookup_elem(&map_connections, &key);
+
+    if (client_conn && is_same_conn(conn, client_conn))
+    {
+        bpf_map_delete_elem(&map_connections, &key);
+
+#ifdef CONNECTION_COUNTERS
+        bpf_map_delete_elem(&map_conn_stats, &key);
+#endif
+    }
+
+    return 0;
+}
+
+/**
+ * Calculates the checksum deltas of a connection's rewrite in both directions, so packets only need a single checksum update each.
+ * 
+ * Clients send from their address and port to the bind address and port, which is rewritten to the source NAT IP and port towards the backend. Replies are rewritten the other way around.
+ * ICMP echoes only have their identifier rewritten (the ICMPv4 checksum doesn't cover the addresses).
+ * 
+ * @param conn A pointer to the connection (its source port must be set).
+ * @param protocol The connection's protocol.
+ * 
+ * @return void
+ */
+static __always_inline void set_conn_csum_deltas(conn_val_t* conn, u8 protocol)
+{
+    // IPv4-mapped addresses share their prefix, so only the IPv4 address adds to the delta.
+    u32 fwd_ips = csum_delta16(conn->src_ip, conn->snat_ip, 0);
+    fwd_ips = csum_delta16(conn->bind_ip, conn->dst_ip, fwd_ips);
+
+    u32 reply_ips = csum_delta16(conn->dst_ip, conn->bind_ip, 0);
+    reply_ips = csum_delta16(conn->snat_ip, conn->src_ip, reply_ips);
+
+    conn->fwd_l3_csum = fwd_ips;
+    conn->reply_l3_csum = reply_ips;
+
+    u32 fwd_ports = csum_delta4(conn->src_port, conn->port, 0);
+    u32 reply_ports = csum_delta4(conn->port, conn->src_port, 0);
+
+    if (protocol == IPPROTO_TCP || protocol == IPPROTO_UDP)
+    {
+        fwd_ports = csum_delta4(conn->bind_port, conn->dst_port, fwd_ports);
+        reply_ports = csum_delta4(conn->dst_port, conn->bind_port, reply_ports);
+    }
+
+    if (protocol == IPPROTO_ICMP)
+    {
+        conn->fwd_l4_csum = fwd_ports;
+        conn->reply_l4_csum = reply_ports;
+
+        return;
+    }
+
+    conn->fwd_l4_csum = csum_add(fwd_ips, fwd_ports);
+    conn->reply_l4_csum = csum_add(reply_ips, reply_ports);
+}
\ No newline at end of file
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <common/all.h>
+
+#include <xdp/utils/helpers.h>
+#include <xdp/utils/maps.h>
+#include <xdp/utils/csum.h>
+
+static __always_inline void get_conn_key(conn_val_t* conn, u8 protocol, conn_key_t* key);
+static __always_inline void get_reply_conn_key(u128 snat_ip, u16 port, u8 protocol, conn_key_t* key);
+static __always_inline int is_reply_conn_key(conn_key_t* key);
+static __always_inline void update_conn_last_seen(conn_val_t* conn, u64 now);
+static __always_inline u64 get_conn_last_seen(conn_val_t* conn, u8 protocol, u64* count);
+static __always_inline void sync_conn_state(conn_val_t* conn, u8 protocol, int from_client);
+static __always_inline int is_same_conn(conn_val_t* conn, conn_val_t* other);
+static __always_inline int delete_conn(conn_val_t* conn, u8 protocol);
+static __always_inline void set_conn_csum_deltas(conn_val_t* conn, u8 protocol);
+
+// The source file is included directly below instead of compiled and linked as an object because when linking, there is no guarantee the compiler will inline the function (which is crucial for performance).
+// I'd prefer not to include the function logic inside of the header file.
+// More Info: https://stackoverflow.com/questions/24289599/always-inline-does-not-work-when-function-is-implemented-in-different-file
+#include "conn.c"
\ No newline at end of file
@@ -42,4 +42,74 @@ static __always_inline u16 csum_diff4(u32 from, u32 to, u16 csum)
     u32 tmp = csum_sub(from, ~((u32)csum));
 
     return csum_fold_helper(csum_add(to, tmp));
+}
+
+static __always_inline u16 csum_diff16(u128 from, u128 to, u16 csum)
+{
+    u32 from_words[4];
+    u32 to_words[4];
+
+    memcpy(from_words, &from, sizeof(from_words));
+    memcpy(to_words, &to, sizeof(to_words));
+
+#pragma clang loop unroll(full)
+    for (int i = 0; i < 4; i++)
+    {
+        csum = csum_diff4(from_words[i], to_words[i], csum);
+    }
+
+    return csum;
+}
+
+/**
+ * Adds the change of a 32-bit word to a checksum delta.
+ * 
+ * @param from The old word.
+ * @param to The new word.
+ * @param delta The delta so far.
+ * 
+ * @return The new delta (apply it with csum_apply()).
+ */
+static __always_inline u32 csum_delta4(u32 from, u32 to, u32 delta)
+{
+    return csum_add(to, csum_add(~from, delta));
+}
+
+/**
+ * Adds the change of a 128-bit value (IPv6 address) to a checksum delta.
+ * 
+ * @param from The old value.
+ * @param to The new value.
+ * @param delta The delta so far.
+ * 
+ * @return The new delta (apply it with csum_apply()).
+ */
+static __always_inline u32 csum_delta16(u128 from, u128 to, u32 delta)
+{
+    u32 from_words[4];
+    u32 to_words[4];
+
+    memcpy(from_words, &from, sizeof(from_words));
+    memcpy(to_words, &to, sizeof(to_words));
+
+#pragma clang loop unroll(full)
+    for (int i = 0; i < 4; i++)
+    {
+        delta = csum_delta4(from_words[i], to_words[i], delta);
+    }
+
+    return delta;
+}
+
+/**
+ * Updates a checksum with a delta built by csum_delta4() and csum_delta16() (RFC 1624).
+ * 
+ * @param delta The checksum delta.
+ * @param csum The old checksum.
+ * 
+ * @return The new checksum.
+ */
+static __always_inline u16 csum_apply(u32 delta, u16 csum)
+{
+    return csum_fold_helper(csum_add(delta, ~((u32)csum)));
 }
\ No newline at end of file
@@ -16,6 +16,10 @@ static __always_inline u32 csum_add(u32 add_end, u32 csum);
 static __always_inline u32 csum_sub(u32 add_end, u32 csum);
 static __always_inline void update_iph_checksum(struct iphdr *iph);
 static __always_inline u16 csum_diff4(u32 from, u32 to, u16 csum);
+static __always_inline u16 csum_diff16(u128 from, u128 to, u16 csum);
+static __always_inline u32 csum_delta4(u32 from, u32 to, u32 delta);
+static __always_inline u32 csum_delta16(u128 from, u128 to, u32 delta);
+static __always_inline u16 csum_apply(u32 delta, u16 csum);
 
 // The source file is included directly below instead of compiled and linked as an object because when linking, there is no guarantee the compiler will inline the function (which is crucial for performance).
 // I'd prefer not to include the function logic inside of the header file.
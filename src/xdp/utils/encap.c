@@ -0,0 +1,186 @@
+#include <xdp/utils/encap.h>
+
+/**
+ * Encapsulates a packet in an outer IP header (and GRE or UDP/GUE header) addressed to a tunnel endpoint.
+ * 
+ * The outer header's address family follows the tunnel endpoint's, so IPv4 packets may be carried over IPv6 and vice versa.
+ * 
+ * @param ctx A pointer to the xdp_md struct containing all packet information.
+ * @param type The tunnel type (TUNNEL_IPIP, TUNNEL_GUE, or TUNNEL_GRE).
+ * @param src_ip The outer source IP.
+ * @param dst_ip The outer destination IP (the tunnel endpoint).
+ * @param flow_hash The packet's flow hash (used as GUE source port so receivers may spread tunnels across queues).
+ * @param data A pointer to the data pointer.
+ * @param data_end A pointer to the data end pointer.
+ * @param eth A pointer to the ethernet header pointer.
+ * @param iph A pointer to the IPv4 header pointer (set to the outer header if the endpoint is IPv4 or NULL otherwise).
+ * @param iph6 A pointer to the IPv6 header pointer (set to the outer header if the endpoint is IPv6 or NULL otherwise).
+ * @param protocol A pointer to the outer header's protocol (set on success).
+ * 
+ * @return 0 on success or 1 if the packet can't be encapsulated.
+ */
+static __always_inline int encap_packet(struct xdp_md* ctx, u8 type, u128 src_ip, u128 dst_ip, u32 flow_hash, void** data, void** data_end, struct ethhdr** eth, struct iphdr** iph, struct ipv6hdr** iph6, u8* protocol)
+{
+    struct ethhdr old_eth = **eth;
+
+    int outer_ip4 = is_ip4_mapped(dst_ip);
+
+    // The inner packet's traffic class is kept so QoS still applies to the tunnel.
+    u8 inner_protocol;
+    u8 tos;
+
+    if (*iph)
+    {
+        inner_protocol = IPPROTO_IPIP;
+        tos = (*iph)->tos;
+    }
+    else if (*iph6)
+    {
+        inner_protocol = IPPROTO_IPV6;
+        tos = ((*iph6)->priority << 4) | ((*iph6)->flow_lbl[0] >> 4);
+    }
+    else
+    {
+        return 1;
+    }
+
+    u32 inner_len = (*data_end - *data) - sizeof(struct ethhdr);
+
+    u32 l3_len = (outer_ip4) ? sizeof(struct iphdr) : sizeof(struct ipv6hdr);
+    u32 tun_len = (type == TUNNEL_GRE) ? GRE_ENCAP_LEN : (type == TUNNEL_GUE) ? GUE_ENCAP_LEN : 0;
+
+    u32 payload_len = tun_len + inner_len;
+
+    if (payload_len + l3_len > 0xffff)
+    {
+        return 1;
+    }
+
+    if (bpf_xdp_adjust_head(ctx, 0 - (int)(l3_len + tun_len)))
+    {
+        return 1;
+    }
+
+    // We need to redefine packet and check headers again.
+    *data = (void *)(long)ctx->data;
+    *data_end = (void *)(long)ctx->data_end;
+
+    *eth = *data;
+
+    if (*eth + 1 > (struct ethhdr *)*data_end)
+    {
+        return 1;
+    }
+
+    memcpy((*eth)->h_dest, old_eth.h_dest, ETH_ALEN);
+    memcpy((*eth)->h_source, old_eth.h_source, ETH_ALEN);
+
+    void* tun_hdr;
+
+    if (outer_ip4)
+    {
+        (*eth)->h_proto = htons(ETH_P_IP);
+
+        *iph6 = NULL;
+        *iph = *data + sizeof(struct ethhdr);
+
+        if (*iph + 1 > (struct iphdr *)*data_end)
+        {
+            return 1;
+        }
+
+        (*iph)->version = 4;
+        (*iph)->ihl = 5;
+        (*iph)->tos = tos;
+        (*iph)->tot_len = htons(l3_len + payload_len);
+        (*iph)->id = 0;
+        (*iph)->frag_off = 0;
+        (*iph)->ttl = 64;
+        (*iph)->saddr = ip6_to_ip4(src_ip);
+        (*iph)->daddr = ip6_to_ip4(dst_ip);
+
+        tun_hdr = *iph + 1;
+    }
+    else
+    {
+        (*eth)->h_proto = htons(ETH_P_IPV6);
+
+        *iph = NULL;
+        *iph6 = *data + sizeof(struct ethhdr);
+
+        if (*iph6 + 1 > (struct ipv6hdr *)*data_end)
+        {
+            return 1;
+        }
+
+        (*iph6)->version = 6;
+        (*iph6)->priority = tos >> 4;
+        (*iph6)->flow_lbl[0] = (tos & 0x0f) << 4;
+        (*iph6)->flow_lbl[1] = 0;
+        (*iph6)->flow_lbl[2] = 0;
+
+        (*iph6)->payload_len = htons(payload_len);
+        (*iph6)->hop_limit = 64;
+
+        memcpy(&(*iph6)->saddr, &src_ip, sizeof(src_ip));
+        memcpy(&(*iph6)->daddr, &dst_ip, sizeof(dst_ip));
+
+        tun_hdr = *iph6 + 1;
+    }
+
+    if (type == TUNNEL_GRE)
+    {
+        struct gre_hdr* greh = tun_hdr;
+
+        if (greh + 1 > (struct gre_hdr *)*data_end)
+        {
+            return 1;
+        }
+
+        greh->flags = 0;
+        greh->protocol = old_eth.h_proto;
+
+        *protocol = IPPROTO_GRE;
+    }
+    else if (type == TUNNEL_GUE)
+    {
+        struct udphdr* udph = tun_hdr;
+        struct gue_hdr* gueh = (void*)(udph + 1);
+
+        if (gueh + 1 > (struct gue_hdr *)*data_end)
+        {
+            return 1;
+        }
+
+        // Source ports are taken from the dynamic range (RFC 6335).
+        udph->source = htons(0xc000 | (flow_hash & 0x3fff));
+        udph->dest = htons(DSR_GUE_PORT);
+        udph->len = htons(payload_len);
+
+        // Tunnels may omit the UDP checksum since the inner packet carries its own (RFC 6935 for IPv6).
+        udph->check = 0;
+
+        gueh->hlen_ver = 0;
+        gueh->protocol = inner_protocol;
+        gueh->flags = 0;
+
+        *protocol = IPPROTO_UDP;
+    }
+    else
+    {
+        *protocol = inner_protocol;
+    }
+
+    if (*iph)
+    {
+        (*iph)->protocol = *protocol;
+
+        update_iph_checksum(*iph);
+    }
+    else
+    {
+        (*iph6)->nexthdr = *protocol;
+    }
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <common/all.h>
+
+#include <linux/if_ether.h>
+#include <linux/ip.h>
+#include <linux/ipv6.h>
+#include <linux/udp.h>
+#include <linux/in.h>
+
+#include <xdp/utils/helpers.h>
+#include <xdp/utils/csum.h>
+
+// The amount of bytes the outer headers of each tunnel type add on top of the outer IP header.
+#define GRE_ENCAP_LEN (sizeof(struct gre_hdr))
+#define GUE_ENCAP_LEN (sizeof(struct udphdr) + sizeof(struct gue_hdr))
+
+static __always_inline int encap_packet(struct xdp_md* ctx, u8 type, u128 src_ip, u128 dst_ip, u32 flow_hash, void** data, void** data_end, struct ethhdr** eth, struct iphdr** iph, struct ipv6hdr** iph6, u8* protocol);
+
+// The source file is included directly below instead of compiled and linked as an object because when linking, there is no guarantee the compiler will inline the function (which is crucial for performance).
+// I'd prefer not to include the function logic inside of the header file.
+// More Info: https://stackoverflow.com/questions/24289599/always-inline-does-not-work-when-function-is-implemented-in-different-file
+#include "encap.c"
\ No newline at end of file
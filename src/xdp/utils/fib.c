@@ -0,0 +1,97 @@
+#include <xdp/utils/fib.h>
+
+#ifdef ENABLE_FIB_LOOKUPS
+/**
+ * Retrieves the egress interface and MAC addresses for a packet's destination.
+ * 
+ * If ENABLE_FIB_CACHE is enabled, results are cached per destination IP so the FIB is only walked when the cached entry is missing or expired.
+ * 
+ * @param ctx A pointer to the xdp_md struct containing all packet information.
+ * @param iph A pointer to the IPv4 header (NULL for IPv6 packets).
+ * @param iph6 A pointer to the IPv6 header (NULL for IPv4 packets).
+ * @param l4_protocol The layer-4 protocol.
+ * @param fib Where to store the result.
+ * 
+ * @return BPF_FIB_LKUP_RET_SUCCESS on success or the return value of bpf_fib_lookup() on failure.
+ */
+static __always_inline int get_fib_entry(struct xdp_md* ctx, struct iphdr* iph, struct ipv6hdr* iph6, u8 l4_protocol, fib_entry_t* fib)
+{
+#ifdef ENABLE_FIB_CACHE
+    u128 dst_ip;
+
+    if (iph)
+    {
+        dst_ip = ip4_to_ip6(iph->daddr);
+    }
+    else
+    {
+        memcpy(&dst_ip, &iph6->daddr, sizeof(dst_ip));
+    }
+
+    u64 now = bpf_ktime_get_ns();
+
+    fib_entry_t* cached = bpf_map_lookup_elem(&map_fib_cache, &dst_ip);
+
+    if (cached && cached->expires > now)
+    {
+        *fib = *cached;
+
+        return BPF_FIB_LKUP_RET_SUCCESS;
+    }
+#endif
+
+    struct bpf_fib_lookup params = {0};
+
+    if (iph)
+    {
+        params.family = AF_INET;
+        params.tos = iph->tos;
+        params.l4_protocol = l4_protocol;
+        params.tot_len = ntohs(iph->tot_len);
+        params.ipv4_src = iph->saddr;
+        params.ipv4_dst = iph->daddr;
+    }
+    else
+    {
+        params.family = AF_INET6;
+        params.flowinfo = *(be32*)iph6 & IP6_FLOWINFO_MASK;
+        params.l4_protocol = l4_protocol;
+        params.tot_len = ntohs(iph6->payload_len) + sizeof(struct ipv6hdr);
+
+        memcpy(params.ipv6_src, &iph6->saddr, sizeof(params.ipv6_src));
+        memcpy(params.ipv6_dst, &iph6->daddr, sizeof(params.ipv6_dst));
+    }
+
+    params.ifindex = ctx->ingress_ifindex;
+
+    int ret = bpf_fib_lookup(ctx, &params, sizeof(params), BPF_FIB_LOOKUP_DIRECT);
+
+    if (ret != BPF_FIB_LKUP_RET_SUCCESS)
+    {
+        return ret;
+    }
+
+    fib->ifindex = params.ifindex;
+
+    memcpy(fib->smac, params.smac, ETH_ALEN);
+    memcpy(fib->dmac, params.dmac, ETH_ALEN);
+
+    // On success, the destination is replaced with the next hop.
+    if (iph)
+    {
+        fib->nh_ip = ip4_to_ip6(params.ipv4_dst);
+    }
+    else
+    {
+        memcpy(&fib->nh_ip, params.ipv6_dst, sizeof(fib->nh_ip));
+    }
+
+#ifdef ENABLE_FIB_CACHE
+    fib->expires = now + ((u64)FIB_CACHE_TTL * NANO_TO_SEC);
+
+    bpf_map_update_elem(&map_fib_cache, &dst_ip, fib, BPF_ANY);
+#endif
+
+    return ret;
+}
+#endif
\ No newline at end of file
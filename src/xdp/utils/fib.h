@@ -0,0 +1,28 @@
+#pragma once
+
+#include <common/all.h>
+
+#include <linux/ip.h>
+#include <linux/ipv6.h>
+
+#include <xdp/utils/helpers.h>
+#include <xdp/utils/maps.h>
+
+#ifndef AF_INET
+#define AF_INET 2
+#endif
+
+#ifndef AF_INET6
+#define AF_INET6 10
+#endif
+
+#define IP6_FLOWINFO_MASK htonl(0x0fffffff)
+
+#ifdef ENABLE_FIB_LOOKUPS
+static __always_inline int get_fib_entry(struct xdp_md* ctx, struct iphdr* iph, struct ipv6hdr* iph6, u8 l4_protocol, fib_entry_t* fib);
+#endif
+
+// The source file is included directly below instead of compiled and linked as an object because when linking, there is no guarantee the compiler will inline the function (which is crucial for performance).
+// I'd prefer not to include the function logic inside of the header file.
+// More Info: https://stackoverflow.com/questions/24289599/always-inline-does-not-work-when-function-is-implemented-in-different-file
+#include "fib.c"
\ No newline at end of file
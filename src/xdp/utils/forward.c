@@ -1,196 +1,138 @@
 #include <xdp/utils/forward.h>
 
 /**
- * Forwards an IPv4 packet from or back to the client.
+ * Forwards an IPv4 or IPv6 packet from or back to the client.
  * 
- * @param rule A pointer to the forward rule.
+ * @param rule A pointer to the forward rule (NULL for packets sent back to the client).
  * @param conn A pointer to the connection.
  * @param stats A pointer to the stats map.
  * @param ctx A pointer to the xdp_md struct containing all packet information.
  * @param data A pointer to the data pointer.
  * @param data_end A pointer to the data end pointer.
  * @param eth A pointer to the ethernet header pointer.
- * @param iph A pointer to the IP header pointer.
+ * @param iph A pointer to the IPv4 header pointer (NULL for IPv6 packets).
+ * @param iph6 A pointer to the IPv6 header pointer (NULL for IPv4 packets).
  * @param tcph A pointer to the TCP header pointer.
  * @param udph A pointer to the UDP header pointer.
  * @param icmph A pointer to the ICMP header pointer.
+ * @param icmp6h A pointer to the ICMPv6 header pointer.
  * 
- * @return XDP_TX (sends packet back out TX path).
+ * @return XDP_TX (sends packet back out TX path) or XDP_REDIRECT (sends packet out the interface chosen by the FIB lookup).
  */
-static __always_inline int fwd_packet(fwd_rule_val_t* rule, conn_val_t* conn, stats_t* stats, struct xdp_md* ctx, void** data, void** data_end, struct ethhdr** eth, struct iphdr** iph, struct tcphdr** tcph, struct udphdr** udph, struct icmphdr** icmph)
+static __always_inline int fwd_packet(fwd_rule_val_t* rule, conn_val_t* conn, stats_t* stats, struct xdp_md* ctx, void** data, void** data_end, struct ethhdr** eth, struct iphdr** iph, struct ipv6hdr** iph6, struct tcphdr** tcph, struct udphdr** udph, struct icmphdr** icmph, struct icmp6hdr** icmp6h)
 {
-    // Swap IP addresses.
-    u32 old_src_ip = (*iph)->saddr;
-    u32 old_dst_ip = (*iph)->daddr;
+    // Forwarded packets are sent from the source NAT IP to the connection's backend and replies from the bind IP to the client.
+    u128 src_ip = (rule) ? conn->snat_ip : conn->bind_ip;
+    u128 dst_ip = (rule) ? conn->dst_ip : conn->src_ip;
 
-    (*iph)->saddr = old_dst_ip;
+    // Translate TCP and UDP packets between IPv4 and IPv6 (NAT46/NAT64) when the destination is of the other address family.
+    int translated = 0;
 
-    if (rule)
+    if ((*tcph || *udph) && is_ip4_mapped(dst_ip) != (*iph != NULL))
     {
-        (*iph)->daddr = rule->dst_ip;
-    }
-    else
-    {
-        if (!*icmph)
-        {
-            (*iph)->daddr = conn->src_ip;
-        }
-    }
+        int ret = (*iph) ? xlate_ip4_to_ip6(ctx, data, data_end, eth, iph, iph6, tcph, udph, src_ip, dst_ip) : xlate_ip6_to_ip4(ctx, data, data_end, eth, iph, iph6, tcph, udph, src_ip, dst_ip);
 
-    // Handle ICMP protocol.
-    if (*icmph)
-    {
-        if (rule)
+        if (ret)
         {
-            // We'll want to add the client's unsigned 32-bit (4 bytes) IP address to the ICMP data so we know where to send it when it replies back.
-            // First, let's add four bytes to the packet.
-            if (bpf_xdp_adjust_tail(ctx, (int)sizeof(u32)))
-            {
-                return XDP_DROP;
-            }
-
-            // We need to redefine packet and check headers again.
-            *data = (void *)(long)ctx->data;
-            *data_end = (void *)(long)ctx->data_end;
-
-            *eth = *data;
-
-            if (*eth + 1 > (struct ethhdr *)*data_end)
-            {
-                inc_pkt_stats(stats, STATS_TYPE_DROPPED);
-
-                return XDP_DROP;
-            }
-
-            *iph = *data + sizeof(struct ethhdr);
-
-            if (*iph + 1 > (struct iphdr *)*data_end)
-            {
-                inc_pkt_stats(stats, STATS_TYPE_DROPPED);
-
-                return XDP_DROP;
-            }
-
-            *icmph = *data + sizeof(struct ethhdr) + ((*iph)->ihl * 4);
-
-            if (*icmph + 1 > (struct icmphdr *)*data_end)
-            {
-                inc_pkt_stats(stats, STATS_TYPE_DROPPED);
-
-                return XDP_DROP;
-            }
-
-            // Now let's add the new data.
-
-            // Unfortunately, we can't start from the packet end (data_end) pointer. Therefore, we must calculate the length of the packet and use the data pointer. Thanks for the help, Srivats! (https://lore.kernel.org/bpf/CANzUK5-g9wLiwUF88em4uVzMja_aR4xj9yzMS_ZObNKjvX6C6g@mail.gmail.com/)
-            unsigned int len = (*data_end - *data);
-
-            if (*data + len > *data_end)
-            {
-                inc_pkt_stats(stats, STATS_TYPE_DROPPED);
-
-                return XDP_DROP;
-            }
+            inc_pkt_stats(stats, STATS_TYPE_DROPPED);
 
-            unsigned int off = (len - sizeof(u32)) & 0x3fff;
-
-            u32 *icmp_data = *data + off;
+            return XDP_DROP;
+        }
 
-            if (icmp_data + 1 > (u32 *)*data_end)
-            {
-                inc_pkt_stats(stats, STATS_TYPE_DROPPED);
+        translated = 1;
+    }
 
-                return XDP_DROP;
-            }
+    // Connections carry the checksum deltas of their rewrite, so checksums are updated once. Replies only match them when sent from the connection's backend.
+    int precomputed = 0;
 
-            memcpy(icmp_data, &conn->src_ip, sizeof(u32));
+    u32 l3_csum = (rule) ? conn->fwd_l3_csum : conn->reply_l3_csum;
+    u32 l4_csum = (rule) ? conn->fwd_l4_csum : conn->reply_l4_csum;
 
-            // We'll want to add four bytes to the IP header.
-            (*iph)->tot_len = htons(ntohs((*iph)->tot_len) + sizeof(u32));
+    if (!translated)
+    {
+        u128 old_src = 0;
 
-            // Recalculate ICMP checksum.
-            (*icmph)->checksum = csum_diff4(0, conn->src_ip, (*icmph)->checksum);
+        if (*iph)
+        {
+            old_src = ip4_to_ip6((*iph)->saddr);
         }
         else
         {
-            // When sending packets back, we'll want to get the client IP address from the ICMP data (last four bytes).
-            // First ensure the ICMP data is enough.
-            if (*icmph + sizeof(u32) > (struct icmphdr *)*data_end)
-            {
-                inc_pkt_stats(stats, STATS_TYPE_PASSED);
-
-                return XDP_PASS;
-            }
-            
-            // Now access the data.
-            unsigned int len = (*data_end - *data);
-
-            if (*data + len > *data_end)
-            {
-                inc_pkt_stats(stats, STATS_TYPE_DROPPED);
-
-                return XDP_DROP;
-            }
-
-            unsigned int off = (len - sizeof(u32)) & 0x3fff;
-
-            u32 *src_ip = *data + off;
-
-            if (src_ip + 1 > (u32 *)*data_end)
-            {
-                inc_pkt_stats(stats, STATS_TYPE_DROPPED);
-
-                return XDP_DROP;
-            }
+            memcpy(&old_src, &(*iph6)->saddr, sizeof(old_src));
+        }
 
-            (*iph)->daddr = *src_ip;
-            
-            // Now we'll want to remove the additional four bytes we added when forwarding.
-            if (bpf_xdp_adjust_tail(ctx, 0 - (int)sizeof(u32)))
-            {
-                inc_pkt_stats(stats, STATS_TYPE_DROPPED);
+        // ICMP echo replies are only matched by their source address.
+        u16 old_src_port = (*tcph) ? (*tcph)->source : (*udph) ? (*udph)->source : conn->dst_port;
 
-                return XDP_DROP;
-            }
+        precomputed = rule || (old_src == conn->dst_ip && old_src_port == conn->dst_port);
+    }
 
-            // We need to redefine packet and check headers again.
-            *data = (void *)(long)ctx->data;
-            *data_end = (void *)(long)ctx->data_end;
+    // Swap IP addresses.
+    u32 old_src_ip = 0;
+    u32 old_dst_ip = 0;
 
-            *eth = *data;
+    u128 old_src_ip6 = 0;
+    u128 old_dst_ip6 = 0;
 
-            if (*eth + 1 > (struct ethhdr *)*data_end)
-            {
-                inc_pkt_stats(stats, STATS_TYPE_DROPPED);
+    u128 new_src_ip6 = 0;
+    u128 new_dst_ip6 = 0;
 
-                return XDP_DROP;
-            }
+    // Translated packets already have their new addresses.
+    if (*iph && !translated)
+    {
+        old_src_ip = (*iph)->saddr;
+        old_dst_ip = (*iph)->daddr;
 
-            *iph = *data + sizeof(struct ethhdr);
+        (*iph)->saddr = ip6_to_ip4(src_ip);
+        (*iph)->daddr = ip6_to_ip4(dst_ip);
+    }
+    else if (*iph6 && !translated)
+    {
+        memcpy(&old_src_ip6, &(*iph6)->saddr, sizeof(old_src_ip6));
+        memcpy(&old_dst_ip6, &(*iph6)->daddr, sizeof(old_dst_ip6));
 
-            if (*iph + 1 > (struct iphdr *)*data_end)
-            {
-                inc_pkt_stats(stats, STATS_TYPE_DROPPED);
+        new_src_ip6 = src_ip;
+        new_dst_ip6 = dst_ip;
 
-                return XDP_DROP;
-            }
+        memcpy(&(*iph6)->saddr, &new_src_ip6, sizeof(new_src_ip6));
+        memcpy(&(*iph6)->daddr, &new_dst_ip6, sizeof(new_dst_ip6));
+    }
 
-            *icmph = *data + sizeof(struct ethhdr) + ((*iph)->ihl * 4);
+    // Handle ICMP protocol. Echo identifiers are rewritten like source ports, so the packet's length stays the same.
+    if (*icmph)
+    {
+        u16 old_id = (*icmph)->un.echo.id;
 
-            if (*icmph + 1 > (struct icmphdr *)*data_end)
-            {
-                inc_pkt_stats(stats, STATS_TYPE_DROPPED);
+        (*icmph)->un.echo.id = (rule) ? conn->port : conn->src_port;
 
-                return XDP_DROP;
-            }
+        // Unlike ICMPv6, the ICMP checksum doesn't cover the addresses.
+        if (precomputed)
+        {
+            (*icmph)->checksum = csum_apply(l4_csum, (*icmph)->checksum);
+        }
+        else
+        {
+            (*icmph)->checksum = csum_diff4(old_id, (*icmph)->un.echo.id, (*icmph)->checksum);
+        }
+    }
+    else if (*icmp6h)
+    {
+        u16 old_id = (*icmp6h)->icmp6_dataun.u_echo.identifier;
 
-            // Remove four bytes from the IP header's total length.
-            (*iph)->tot_len = htons(ntohs((*iph)->tot_len) - sizeof(u32));
+        (*icmp6h)->icmp6_dataun.u_echo.identifier = (rule) ? conn->port : conn->src_port;
 
-            // Recalculate ICMP checksum.
-            (*icmph)->checksum = csum_diff4((*iph)->daddr, 0, (*icmph)->checksum);
+        if (precomputed)
+        {
+            (*icmp6h)->icmp6_cksum = csum_apply(l4_csum, (*icmp6h)->icmp6_cksum);
+        }
+        else
+        {
+            (*icmp6h)->icmp6_cksum = csum_diff16(old_src_ip6, new_src_ip6, (*icmp6h)->icmp6_cksum);
+            (*icmp6h)->icmp6_cksum = csum_diff16(old_dst_ip6, new_dst_ip6, (*icmp6h)->icmp6_cksum);
+            (*icmp6h)->icmp6_cksum = csum_diff4(old_id, (*icmp6h)->icmp6_dataun.u_echo.identifier, (*icmp6h)->icmp6_cksum);
         }
-    } else if (*tcph)
+    }
+    else if (*tcph)
     {
         // Handle ports.
         u16 old_src_port = (*tcph)->source;
@@ -199,7 +141,7 @@ static __always_inline int fwd_packet(fwd_rule_val_t* rule, conn_val_t* conn, st
         if (rule)
         {
             (*tcph)->source = conn->port;
-            (*tcph)->dest = rule->dst_port;
+            (*tcph)->dest = conn->dst_port;
         }
         else
         {
@@ -207,12 +149,27 @@ static __always_inline int fwd_packet(fwd_rule_val_t* rule, conn_val_t* conn, st
             (*tcph)->dest = conn->src_port;
         }
         
-        // Recalculate checksum.
-        (*tcph)->check = csum_diff4(old_src_ip, (*iph)->saddr, (*tcph)->check);
-        (*tcph)->check = csum_diff4(old_src_port, (*tcph)->source, (*tcph)->check);
+        // Recalculate checksum (translated packets already account for their new addresses).
+        if (precomputed)
+        {
+            (*tcph)->check = csum_apply(l4_csum, (*tcph)->check);
+        }
+        else
+        {
+            if (*iph && !translated)
+            {
+                (*tcph)->check = csum_diff4(old_src_ip, (*iph)->saddr, (*tcph)->check);
+                (*tcph)->check = csum_diff4(old_dst_ip, (*iph)->daddr, (*tcph)->check);
+            }
+            else if (*iph6 && !translated)
+            {
+                (*tcph)->check = csum_diff16(old_src_ip6, new_src_ip6, (*tcph)->check);
+                (*tcph)->check = csum_diff16(old_dst_ip6, new_dst_ip6, (*tcph)->check);
+            }
 
-        (*tcph)->check = csum_diff4(old_dst_ip, (*iph)->daddr, (*tcph)->check);
-        (*tcph)->check = csum_diff4(old_dst_port, (*tcph)->dest, (*tcph)->check);
+            (*tcph)->check = csum_diff4(old_src_port, (*tcph)->source, (*tcph)->check);
+            (*tcph)->check = csum_diff4(old_dst_port, (*tcph)->dest, (*tcph)->check);
+        }
     }
     else if (*udph)
     {
@@ -223,7 +180,7 @@ static __always_inline int fwd_packet(fwd_rule_val_t* rule, conn_val_t* conn, st
         if (rule)
         {
             (*udph)->source = conn->port;
-            (*udph)->dest = rule->dst_port;
+            (*udph)->dest = conn->dst_port;
         }
         else
         {
@@ -231,32 +188,97 @@ static __always_inline int fwd_packet(fwd_rule_val_t* rule, conn_val_t* conn, st
             (*udph)->dest = conn->src_port;
         }
 
-        // Recalculate checksum.
-        (*udph)->check = csum_diff4(old_dst_ip, (*iph)->daddr, (*udph)->check);
-        (*udph)->check = csum_diff4(old_src_ip, (*iph)->saddr, (*udph)->check);
+        // A zero checksum means the IPv4 sender didn't calculate one, so it's left unset (IPv6 requires it and receivers drop such packets anyway).
+        if ((*udph)->check)
+        {
+            // Recalculate checksum (translated packets already account for their new addresses).
+            if (precomputed)
+            {
+                (*udph)->check = csum_apply(l4_csum, (*udph)->check);
+            }
+            else
+            {
+                if (*iph && !translated)
+                {
+                    (*udph)->check = csum_diff4(old_dst_ip, (*iph)->daddr, (*udph)->check);
+                    (*udph)->check = csum_diff4(old_src_ip, (*iph)->saddr, (*udph)->check);
+                }
+                else if (*iph6 && !translated)
+                {
+                    (*udph)->check = csum_diff16(old_dst_ip6, new_dst_ip6, (*udph)->check);
+                    (*udph)->check = csum_diff16(old_src_ip6, new_src_ip6, (*udph)->check);
+                }
+
+                (*udph)->check = csum_diff4(old_src_port, (*udph)->source, (*udph)->check);
+                (*udph)->check = csum_diff4(old_dst_port, (*udph)->dest, (*udph)->check);
+            }
 
-        (*udph)->check = csum_diff4(old_src_port, (*udph)->source, (*udph)->check);
-        (*udph)->check = csum_diff4(old_dst_port, (*udph)->dest, (*udph)->check);
+            // A calculated checksum of zero is sent as all ones.
+            if (!(*udph)->check)
+            {
+                (*udph)->check = 0xffff;
+            }
+        }
     }
 
-    // Recalculate IP checksum and send packet back out TX path.
-    update_iph_checksum(*iph);
+    // Update the IP checksum (IPv6 doesn't have a header checksum) and send packet back out TX path.
+    // Only the rewritten fields are accounted for, so options of longer headers (ihl > 5) stay covered.
+    if (*iph && !translated)
+    {
+        if (precomputed)
+        {
+            (*iph)->check = csum_apply(l3_csum, (*iph)->check);
+        }
+        else
+        {
+            (*iph)->check = csum_diff4(old_src_ip, (*iph)->saddr, (*iph)->check);
+            (*iph)->check = csum_diff4(old_dst_ip, (*iph)->daddr, (*iph)->check);
+        }
+    }
+    else if (*iph)
+    {
+        // Translated packets have a new header without options.
+        update_iph_checksum(*iph);
+    }
 
-#ifdef ENABLE_FIB_LOOKUPS
-    struct bpf_fib_lookup params = {0};
+    u8 l4_protocol = (*tcph) ? IPPROTO_TCP : (*udph) ? IPPROTO_UDP : (*icmph) ? IPPROTO_ICMP : IPPROTO_ICMPV6;
 
-    params.family = AF_INET;
-    params.tos = (*iph)->tos;
-    params.l4_protocol = (*iph)->protocol;
-    params.tot_len = ntohs((*iph)->tot_len);
-    params.ipv4_src = (*iph)->saddr;
-    params.ipv4_dst = (*iph)->daddr;
+#ifdef ENABLE_TUNNELS
+    // Clients behind a tunnel are answered through it.
+    if (!rule && encap_tunnel_reply(ctx, conn->tunnel_id, data, data_end, eth, iph, iph6, &l4_protocol))
+    {
+        inc_pkt_stats(stats, STATS_TYPE_DROPPED);
 
-    params.ifindex = ctx->ingress_ifindex;
+        return XDP_DROP;
+    }
+#endif
 
-    int fwd = bpf_fib_lookup(ctx, &params, sizeof(params), BPF_FIB_LOOKUP_DIRECT);
+    return send_packet(rule != NULL, stats, ctx, data, data_end, eth, *iph, *iph6, l4_protocol);
+}
 
-    if (fwd != BPF_FIB_LKUP_RET_SUCCESS)
+/**
+ * Sends a rewritten packet out the interface chosen by the FIB lookup (or back out the TX path).
+ * 
+ * @param fwd 1 if the packet is forwarded to a destination or 0 if it's sent back to a client.
+ * @param stats A pointer to the stats map.
+ * @param ctx A pointer to the xdp_md struct containing all packet information.
+ * @param data A pointer to the data pointer.
+ * @param data_end A pointer to the data end pointer.
+ * @param eth A pointer to the ethernet header pointer.
+ * @param iph A pointer to the IPv4 header (NULL for IPv6 packets).
+ * @param iph6 A pointer to the IPv6 header (NULL for IPv4 packets).
+ * @param l4_protocol The packet's layer-4 protocol.
+ * 
+ * @return XDP_TX (sends packet back out TX path), XDP_REDIRECT (sends packet out the interface chosen by the FIB lookup), or XDP_DROP if there is no route.
+ */
+static __always_inline int send_packet(int fwd, stats_t* stats, struct xdp_md* ctx, void** data, void** data_end, struct ethhdr** eth, struct iphdr* iph, struct ipv6hdr* iph6, u8 l4_protocol)
+{
+    int action = XDP_TX;
+
+#ifdef ENABLE_FIB_LOOKUPS
+    fib_entry_t fib = {0};
+
+    if (get_fib_entry(ctx, iph, iph6, l4_protocol, &fib) != BPF_FIB_LKUP_RET_SUCCESS)
     {
         inc_pkt_stats(stats, STATS_TYPE_DROPPED);
 
@@ -275,23 +297,29 @@ static __always_inline int fwd_packet(fwd_rule_val_t* rule, conn_val_t* conn, st
         return XDP_DROP;
     }
 
-    *iph = *data + sizeof(struct ethhdr);
+    memcpy((*eth)->h_source, fib.smac, ETH_ALEN);
+    memcpy((*eth)->h_dest, fib.dmac, ETH_ALEN);
 
-    if (*iph + 1 > (struct iphdr*)*data_end)
+#ifdef ENABLE_FIB_REDIRECT
+    // Send the packet out the interface chosen by the FIB lookup if it isn't the one the packet arrived on.
+    if (fib.ifindex != ctx->ingress_ifindex)
     {
-        inc_pkt_stats(stats, STATS_TYPE_DROPPED);
+        action = bpf_redirect_map(&map_devices, fib.ifindex, 0);
 
-        return XDP_DROP;
-    }
+        if (action != XDP_REDIRECT)
+        {
+            inc_pkt_stats(stats, STATS_TYPE_DROPPED);
 
-    memcpy((*eth)->h_source, params.smac, ETH_ALEN);
-    memcpy((*eth)->h_dest, params.dmac, ETH_ALEN);
+            return XDP_DROP;
+        }
+    }
+#endif
 #else
     // Swap ethernet source and destination MAC addresses.
     swap_eth(*eth);
 #endif
 
-    if (rule)
+    if (fwd)
     {
         inc_pkt_stats(stats, STATS_TYPE_FORWARDED);
     }
@@ -302,5 +330,5 @@ static __always_inline int fwd_packet(fwd_rule_val_t* rule, conn_val_t* conn, st
     }
 #endif
 
-    return XDP_TX;
+    return action;
 }
\ No newline at end of file
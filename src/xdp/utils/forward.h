@@ -8,12 +8,14 @@
 
 #include <xdp/utils/helpers.h>
 #include <xdp/utils/csum.h>
+#include <xdp/utils/xlate.h>
+#include <xdp/utils/fib.h>
+#include <xdp/utils/tunnel.h>
 
-#ifndef AF_INET
-#define AF_INET 2
-#endif
+#include <linux/icmpv6.h>
 
-static __always_inline int fwd_packet(fwd_rule_val_t* rule, conn_val_t* conn, stats_t* stats, struct xdp_md* ctx, void** data, void** data_end, struct ethhdr** eth, struct iphdr** iph, struct tcphdr** tcph, struct udphdr** udph, struct icmphdr** icmph);
+static __always_inline int fwd_packet(fwd_rule_val_t* rule, conn_val_t* conn, stats_t* stats, struct xdp_md* ctx, void** data, void** data_end, struct ethhdr** eth, struct iphdr** iph, struct ipv6hdr** iph6, struct tcphdr** tcph, struct udphdr** udph, struct icmphdr** icmph, struct icmp6hdr** icmp6h);
+static __always_inline int send_packet(int fwd, stats_t* stats, struct xdp_md* ctx, void** data, void** data_end, struct ethhdr** eth, struct iphdr* iph, struct ipv6hdr* iph6, u8 l4_protocol);
 
 // The source file is included directly below instead of compiled and linked as an object because when linking, there is no guarantee the compiler will inline the function (which is crucial for performance).
 // I'd prefer not to include the function logic inside of the header file.
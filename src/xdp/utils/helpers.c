@@ -14,4 +14,176 @@ static __always_inline void swap_eth(struct ethhdr* eth)
     memcpy(&tmp, eth->h_source, ETH_ALEN);
     memcpy(eth->h_source, eth->h_dest, ETH_ALEN);
     memcpy(eth->h_dest, &tmp, ETH_ALEN);
+}
+
+/**
+ * Converts an IPv4 address to an IPv4-mapped IPv6 address (::ffff:a.b.c.d).
+ * 
+ * @param ip The IPv4 address in network byte order.
+ * 
+ * @return The IPv4-mapped IPv6 address.
+ */
+static __always_inline u128 ip4_to_ip6(u32 ip)
+{
+    u32 addr[4] = { 0, 0, htonl(0xffff), ip };
+    u128 ret;
+
+    memcpy(&ret, addr, sizeof(ret));
+
+    return ret;
+}
+
+/**
+ * Retrieves the IPv4 address from an IPv4-mapped IPv6 address.
+ * 
+ * @param ip The IPv4-mapped IPv6 address.
+ * 
+ * @return The IPv4 address in network byte order.
+ */
+static __always_inline u32 ip6_to_ip4(u128 ip)
+{
+    u32 addr[4];
+
+    memcpy(addr, &ip, sizeof(addr));
+
+    return addr[3];
+}
+
+/**
+ * Checks whether an address is an IPv4-mapped IPv6 address.
+ * 
+ * @param ip The address.
+ * 
+ * @return 1 if the address is IPv4-mapped or 0 otherwise.
+ */
+static __always_inline int is_ip4_mapped(u128 ip)
+{
+    u32 addr[4];
+
+    memcpy(addr, &ip, sizeof(addr));
+
+    return addr[0] == 0 && addr[1] == 0 && addr[2] == htonl(0xffff);
+}
+
+/**
+ * Skips the IPv6 extension headers and retrieves the layer-4 header.
+ * 
+ * @param iph6 A pointer to the IPv6 header.
+ * @param data_end The packet's data end pointer.
+ * @param protocol Where to store the layer-4 protocol.
+ * 
+ * @return A pointer to the layer-4 header or NULL if the headers are malformed, there are too many extension headers, or the packet is a fragment.
+ */
+static __always_inline void* get_ip6_l4_hdr(struct ipv6hdr* iph6, void* data_end, u8* protocol)
+{
+    void* hdr = iph6 + 1;
+    u8 next_hdr = iph6->nexthdr;
+
+#pragma clang loop unroll(full)
+    for (int i = 0; i < MAX_IP6_EXT_HDRS; i++)
+    {
+        struct ipv6_opt_hdr* opt = hdr;
+
+        if (opt + 1 > (struct ipv6_opt_hdr*)data_end)
+        {
+            return NULL;
+        }
+
+        switch (next_hdr)
+        {
+            case IPPROTO_HOPOPTS:
+            case IPPROTO_ROUTING:
+            case IPPROTO_DSTOPTS:
+                next_hdr = opt->nexthdr;
+                hdr += (opt->hdrlen + 1) * 8;
+
+                break;
+
+            case IPPROTO_AH:
+                next_hdr = opt->nexthdr;
+                hdr += (opt->hdrlen + 2) * 4;
+
+                break;
+
+            // All fragments (the first one included) are left to the network stack. Forwarding the first fragment would split the datagram between us and the network stack, which has no NAT state for the rest and could never reassemble it.
+            case IPPROTO_FRAGMENT:
+                return NULL;
+
+            default:
+                *protocol = next_hdr;
+
+                return hdr;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Parses the IPv4 or IPv6 header following the ethernet header.
+ * 
+ * @param data The packet's data pointer.
+ * @param data_end The packet's data end pointer.
+ * @param iph A pointer to the IPv4 header pointer (set for IPv4 packets or NULL otherwise).
+ * @param iph6 A pointer to the IPv6 header pointer (set for IPv6 packets or NULL otherwise).
+ * @param protocol Where to store the layer-4 protocol.
+ * @param l4_hdr Where to store the layer-4 header pointer.
+ * @param src_ip Where to store the source IP.
+ * @param dst_ip Where to store the destination IP.
+ * 
+ * @return 0 on success, XDP_DROP if the headers are truncated, or XDP_PASS if the packet isn't IPv4 or IPv6 or its IPv6 extension headers can't be skipped.
+ */
+static __always_inline int parse_ip_hdr(void* data, void* data_end, struct iphdr** iph, struct ipv6hdr** iph6, u8* protocol, void** l4_hdr, u128* src_ip, u128* dst_ip)
+{
+    struct ethhdr* eth = data;
+
+    *iph = NULL;
+    *iph6 = NULL;
+
+    if (unlikely(eth + 1 > (struct ethhdr*)data_end))
+    {
+        return XDP_DROP;
+    }
+
+    if (eth->h_proto == htons(ETH_P_IP))
+    {
+        *iph = data + sizeof(struct ethhdr);
+
+        if (unlikely(*iph + 1 > (struct iphdr*)data_end))
+        {
+            return XDP_DROP;
+        }
+
+        *protocol = (*iph)->protocol;
+        *l4_hdr = data + sizeof(struct ethhdr) + ((*iph)->ihl * 4);
+
+        *src_ip = ip4_to_ip6((*iph)->saddr);
+        *dst_ip = ip4_to_ip6((*iph)->daddr);
+    }
+    else if (eth->h_proto == htons(ETH_P_IPV6))
+    {
+        *iph6 = data + sizeof(struct ethhdr);
+
+        if (unlikely(*iph6 + 1 > (struct ipv6hdr*)data_end))
+        {
+            return XDP_DROP;
+        }
+
+        // Fragments and packets with too many extension headers are left to the network stack.
+        *l4_hdr = get_ip6_l4_hdr(*iph6, data_end, protocol);
+
+        if (!*l4_hdr)
+        {
+            return XDP_PASS;
+        }
+
+        memcpy(src_ip, &(*iph6)->saddr, sizeof(*src_ip));
+        memcpy(dst_ip, &(*iph6)->daddr, sizeof(*dst_ip));
+    }
+    else
+    {
+        return XDP_PASS;
+    }
+
+    return 0;
 }
\ No newline at end of file
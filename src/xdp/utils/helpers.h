@@ -3,6 +3,9 @@
 #include <common/all.h>
 
 #include <linux/if_ether.h>
+#include <linux/in.h>
+#include <linux/ip.h>
+#include <linux/ipv6.h>
 
 #include <linux/bpf.h>
 
@@ -34,7 +37,39 @@
 #define memcpy(dest, src, n) __builtin_memcpy((dest), (src), (n))
 #endif
 
+#ifndef IP_MF
+#define IP_MF 0x2000
+#endif
+
+#ifndef IP_DF
+#define IP_DF 0x4000
+#endif
+
+#ifndef IP_OFFSET
+#define IP_OFFSET 0x1fff
+#endif
+
+// The base GRE header (RFC 2784) without checksum, key, or sequence number.
+struct gre_hdr
+{
+    be16 flags;
+    be16 protocol;
+};
+
+// The GUE header (version 0 without optional fields). The protocol is the encapsulated packet's IP protocol (IPPROTO_IPIP or IPPROTO_IPV6).
+struct gue_hdr
+{
+    u8 hlen_ver;
+    u8 protocol;
+    be16 flags;
+};
+
 static __always_inline void swap_eth(struct ethhdr* eth);
+static __always_inline u128 ip4_to_ip6(u32 ip);
+static __always_inline u32 ip6_to_ip4(u128 ip);
+static __always_inline int is_ip4_mapped(u128 ip);
+static __always_inline void* get_ip6_l4_hdr(struct ipv6hdr* iph6, void* data_end, u8* protocol);
+static __always_inline int parse_ip_hdr(void* data, void* data_end, struct iphdr** iph, struct ipv6hdr** iph6, u8* protocol, void** l4_hdr, u128* src_ip, u128* dst_ip);
 
 // The source file is included directly below instead of compiled and linked as an object because when linking, there is no guarantee the compiler will inline the function (which is crucial for performance).
 // I'd prefer not to include the function logic inside of the header file.
@@ -0,0 +1,310 @@
+#include <xdp/utils/icmp.h>
+
+/**
+ * Checks whether an ICMP or ICMPv6 message is an error quoting the packet that caused it.
+ * 
+ * @param icmph A pointer to the ICMP header (NULL for ICMPv6).
+ * @param icmp6h A pointer to the ICMPv6 header (NULL for ICMP).
+ * 
+ * @return 1 if it's an error or 0 otherwise.
+ */
+static __always_inline int is_icmp_error(struct icmphdr* icmph, struct icmp6hdr* icmp6h)
+{
+    if (icmph)
+    {
+        return icmph->type == ICMP_DEST_UNREACH || icmph->type == ICMP_TIME_EXCEEDED || icmph->type == ICMP_PARAMETERPROB;
+    }
+
+    if (icmp6h)
+    {
+        return icmp6h->icmp6_type == ICMPV6_DEST_UNREACH || icmp6h->icmp6_type == ICMPV6_PKT_TOOBIG || icmp6h->icmp6_type == ICMPV6_TIME_EXCEED || icmp6h->icmp6_type == ICMPV6_PARAMPROB;
+    }
+
+    return 0;
+}
+
+/**
+ * Retrieves the source port (or echo identifier) of a packet quoted by an ICMP error.
+ * 
+ * @param protocol The quoted packet's protocol.
+ * @param l4_hdr A pointer to the quoted layer-4 header (at least eight bytes must be in bounds).
+ * @param port A pointer to store the port in (network byte order).
+ * 
+ * @return 0 on success or 1 if the quoted packet can't belong to a connection.
+ */
+static __always_inline int get_quoted_port(u8 protocol, void* l4_hdr, u16* port)
+{
+    switch (protocol)
+    {
+        case IPPROTO_TCP:
+        case IPPROTO_UDP:
+            // The ports sit at the same offsets in both headers.
+            *port = ((struct udphdr*)l4_hdr)->source;
+
+            return 0;
+
+        case IPPROTO_ICMP:
+            if (((struct icmphdr*)l4_hdr)->type != ICMP_ECHO)
+            {
+                return 1;
+            }
+
+            *port = ((struct icmphdr*)l4_hdr)->un.echo.id;
+
+            return 0;
+
+        case IPPROTO_ICMPV6:
+            if (((struct icmp6hdr*)l4_hdr)->icmp6_type != ICMPV6_ECHO_REQUEST)
+            {
+                return 1;
+            }
+
+            *port = ((struct icmp6hdr*)l4_hdr)->icmp6_dataun.u_echo.identifier;
+
+            return 0;
+    }
+
+    return 1;
+}
+
+/**
+ * Restores the client's ports (or echo identifier) in the layer-4 header of a packet quoted by an ICMP error.
+ * 
+ * @param conn A pointer to the connection the quoted packet belongs to.
+ * @param protocol The quoted packet's protocol.
+ * @param l4_hdr A pointer to the quoted layer-4 header (at least eight bytes must be in bounds).
+ * @param data_end The packet's data end pointer.
+ * @param pseudo The checksum delta of the quoted addresses if the layer-4 checksum covers them (0 with ICMP).
+ * @param delta The checksum delta of the error's quoted packet so far.
+ * 
+ * @return The new checksum delta of the error's quoted packet.
+ */
+static __always_inline u32 rewrite_icmp_error_l4(conn_val_t* conn, u8 protocol, void* l4_hdr, void* data_end, u32 pseudo, u32 delta)
+{
+    u16* check = NULL;
+    u32 ports = 0;
+
+    if (protocol == IPPROTO_TCP || protocol == IPPROTO_UDP)
+    {
+        struct udphdr* udph = l4_hdr;
+
+        ports = csum_delta4(udph->source, conn->src_port, 0);
+        ports = csum_delta4(udph->dest, conn->bind_port, ports);
+
+        udph->source = conn->src_port;
+        udph->dest = conn->bind_port;
+
+        // Errors may only quote the first eight bytes, which don't include the TCP checksum. A zero UDP checksum means there is none.
+        if (protocol == IPPROTO_UDP)
+        {
+            if (udph->check)
+            {
+                check = &udph->check;
+            }
+        }
+        else
+        {
+            struct tcphdr* tcph = l4_hdr;
+
+            if (tcph + 1 <= (struct tcphdr*)data_end)
+            {
+                check = &tcph->check;
+            }
+        }
+    }
+    else
+    {
+        // Echo identifiers sit at the same offset with ICMP and ICMPv6.
+        struct icmphdr* icmph = l4_hdr;
+
+        ports = csum_delta4(icmph->un.echo.id, conn->src_port, 0);
+
+        icmph->un.echo.id = conn->src_port;
+
+        check = &icmph->checksum;
+    }
+
+    delta = csum_add(ports, delta);
+
+    if (check)
+    {
+        u16 old_check = *check;
+        u16 new_check = csum_apply(csum_add(pseudo, ports), old_check);
+
+        if (protocol == IPPROTO_UDP && !new_check)
+        {
+            new_check = 0xffff;
+        }
+
+        *check = new_check;
+
+        delta = csum_delta4(old_check, new_check, delta);
+    }
+
+    return delta;
+}
+
+/**
+ * Rewrites an ICMP error about a packet forwarded to a connection's destination so it can be sent on to the client.
+ * 
+ * The quoted packet is restored to what the client sent (client to bind address and port) and the error is sent from the bind IP to the client.
+ * Errors about translated connections (NAT64/NAT46) are left alone.
+ * 
+ * @param data_end The packet's data end pointer.
+ * @param iph A pointer to the IPv4 header (NULL for IPv6 packets).
+ * @param iph6 A pointer to the IPv6 header (NULL for IPv4 packets).
+ * @param icmph A pointer to the ICMP header (NULL for ICMPv6).
+ * @param icmp6h A pointer to the ICMPv6 header (NULL for ICMP).
+ * 
+ * @return A pointer to the connection or NULL if the error doesn't belong to one (the packet is left unchanged).
+ */
+static __always_inline conn_val_t* rewrite_icmp_error(void* data_end, struct iphdr* iph, struct ipv6hdr* iph6, struct icmphdr* icmph, struct icmp6hdr* icmp6h)
+{
+    conn_key_t key = {0};
+    u16 port = 0;
+
+    if (iph && icmph)
+    {
+        // The error quotes the IP header and at least the first eight bytes of the packet we forwarded.
+        struct iphdr* inner = (void*)(icmph + 1);
+
+        if (inner + 1 > (struct iphdr*)data_end || inner->ihl < 5 || (inner->frag_off & htons(IP_OFFSET)))
+        {
+            return NULL;
+        }
+
+        void* l4_hdr = (void*)inner + (inner->ihl * 4);
+
+        if (l4_hdr + 8 > data_end)
+        {
+            return NULL;
+        }
+
+        u8 protocol = inner->protocol;
+
+        if (get_quoted_port(protocol, l4_hdr, &port))
+        {
+            return NULL;
+        }
+
+        // Quoted packets are sent from the source NAT IP and port, so they're looked up like replies.
+        get_reply_conn_key(ip4_to_ip6(inner->saddr), port, protocol, &key);
+
+        conn_val_t* conn = bpf_map_lookup_elem(&map_connections, &key);
+
+        if (!conn || !is_ip4_mapped(conn->src_ip) || inner->daddr != ip6_to_ip4(conn->dst_ip))
+        {
+            return NULL;
+        }
+
+        if ((protocol == IPPROTO_TCP || protocol == IPPROTO_UDP) && ((struct udphdr*)l4_hdr)->dest != conn->dst_port)
+        {
+            return NULL;
+        }
+
+        u32 client_ip = ip6_to_ip4(conn->src_ip);
+        u32 bind_ip = ip6_to_ip4(conn->bind_ip);
+
+        u32 addrs = csum_delta4(inner->saddr, client_ip, 0);
+        addrs = csum_delta4(inner->daddr, bind_ip, addrs);
+
+        inner->saddr = client_ip;
+        inner->daddr = bind_ip;
+
+        u16 old_check = inner->check;
+
+        inner->check = csum_apply(addrs, old_check);
+
+        // The error's checksum covers the whole quoted packet.
+        u32 delta = csum_delta4(old_check, inner->check, addrs);
+        delta = rewrite_icmp_error_l4(conn, protocol, l4_hdr, data_end, (protocol == IPPROTO_ICMP) ? 0 : addrs, delta);
+
+        icmph->checksum = csum_apply(delta, icmph->checksum);
+
+        // The error is sent from the bind IP like any other reply.
+        u32 outer = csum_delta4(iph->saddr, bind_ip, 0);
+        outer = csum_delta4(iph->daddr, client_ip, outer);
+
+        iph->saddr = bind_ip;
+        iph->daddr = client_ip;
+
+        iph->check = csum_apply(outer, iph->check);
+
+        return conn;
+    }
+
+    if (iph6 && icmp6h)
+    {
+        struct ipv6hdr* inner = (void*)(icmp6h + 1);
+
+        if (inner + 1 > (struct ipv6hdr*)data_end)
+        {
+            return NULL;
+        }
+
+        u8 protocol = 0;
+
+        void* l4_hdr = get_ip6_l4_hdr(inner, data_end, &protocol);
+
+        if (!l4_hdr || l4_hdr + 8 > data_end)
+        {
+            return NULL;
+        }
+
+        if (get_quoted_port(protocol, l4_hdr, &port))
+        {
+            return NULL;
+        }
+
+        u128 inner_src = 0;
+        u128 inner_dst = 0;
+
+        memcpy(&inner_src, &inner->saddr, sizeof(inner_src));
+        memcpy(&inner_dst, &inner->daddr, sizeof(inner_dst));
+
+        get_reply_conn_key(inner_src, port, protocol, &key);
+
+        conn_val_t* conn = bpf_map_lookup_elem(&map_connections, &key);
+
+        if (!conn || is_ip4_mapped(conn->src_ip) || inner_dst != conn->dst_ip)
+        {
+            return NULL;
+        }
+
+        if ((protocol == IPPROTO_TCP || protocol == IPPROTO_UDP) && ((struct udphdr*)l4_hdr)->dest != conn->dst_port)
+        {
+            return NULL;
+        }
+
+        u128 client_ip = conn->src_ip;
+        u128 bind_ip = conn->bind_ip;
+
+        u32 addrs = csum_delta16(inner_src, client_ip, 0);
+        addrs = csum_delta16(inner_dst, bind_ip, addrs);
+
+        memcpy(&inner->saddr, &client_ip, sizeof(client_ip));
+        memcpy(&inner->daddr, &bind_ip, sizeof(bind_ip));
+
+        // IPv6 has no header checksum, but every layer-4 checksum covers the addresses.
+        u32 delta = rewrite_icmp_error_l4(conn, protocol, l4_hdr, data_end, addrs, addrs);
+
+        // The ICMPv6 checksum covers the error's own addresses as well.
+        u128 old_src = 0;
+        u128 old_dst = 0;
+
+        memcpy(&old_src, &iph6->saddr, sizeof(old_src));
+        memcpy(&old_dst, &iph6->daddr, sizeof(old_dst));
+
+        delta = csum_delta16(old_src, bind_ip, delta);
+        delta = csum_delta16(old_dst, client_ip, delta);
+
+        memcpy(&iph6->saddr, &bind_ip, sizeof(bind_ip));
+        memcpy(&iph6->daddr, &client_ip, sizeof(client_ip));
+
+        icmp6h->icmp6_cksum = csum_apply(delta, icmp6h->icmp6_cksum);
+
+        return conn;
+    }
+
+    return NULL;
+}
\ No newline at end of file
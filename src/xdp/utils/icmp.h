@@ -0,0 +1,25 @@
+#pragma once
+
+#include <common/all.h>
+
+#include <linux/ip.h>
+#include <linux/ipv6.h>
+#include <linux/tcp.h>
+#include <linux/udp.h>
+#include <linux/icmp.h>
+#include <linux/icmpv6.h>
+
+#include <xdp/utils/helpers.h>
+#include <xdp/utils/maps.h>
+#include <xdp/utils/csum.h>
+#include <xdp/utils/conn.h>
+#include <xdp/utils/xlate.h>
+
+static __always_inline int is_icmp_error(struct icmphdr* icmph, struct icmp6hdr* icmp6h);
+static __always_inline u32 rewrite_icmp_error_l4(conn_val_t* conn, u8 protocol, void* l4_hdr, void* data_end, u32 pseudo, u32 delta);
+static __always_inline conn_val_t* rewrite_icmp_error(void* data_end, struct iphdr* iph, struct ipv6hdr* iph6, struct icmphdr* icmph, struct icmp6hdr* icmp6h);
+
+// The source file is included directly below instead of compiled and linked as an object because when linking, there is no guarantee the compiler will inline the function (which is crucial for performance).
+// I'd prefer not to include the function logic inside of the header file.
+// More Info: https://stackoverflow.com/questions/24289599/always-inline-does-not-work-when-function-is-implemented-in-different-file
+#include "icmp.c"
\ No newline at end of file
@@ -20,7 +20,7 @@
  * 
  * @return always 0
  */
-static __always_inline int log_msg(u64 now, u16 port, u32 src_ip, u16 src_port, u32 bind_ip, u16 bind_port, u8 protocol, u32 dst_ip, u16 dst_port)
+static __always_inline int log_msg(u64 now, u16 port, u128 src_ip, u16 src_port, u128 bind_ip, u16 bind_port, u8 protocol, u128 dst_ip, u16 dst_port)
 {
     fwd_rule_log_event_t* e = bpf_ringbuf_reserve(&map_fwd_rules_log, sizeof(*e), 0);
 
@@ -4,6 +4,13 @@
 
 #include <xdp/utils/helpers.h>
 
+// The flags of LRU maps written when connections and clients are created.
+#ifdef ENABLE_PER_CPU_LRU
+#define CONN_LRU_MAP_FLAGS BPF_F_NO_COMMON_LRU
+#else
+#define CONN_LRU_MAP_FLAGS 0
+#endif
+
 struct 
 {
     __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
@@ -12,6 +19,65 @@ struct
     __type(value, stats_t);
 } map_stats SEC(".maps");
 
+#ifdef ENABLE_POLICERS
+// Policers are stored by rule ID.
+struct
+{
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __uint(max_entries, MAX_FWD_RULES);
+    __type(key, u32);
+    __type(value, policer_t);
+} map_policers SEC(".maps");
+
+struct
+{
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+    __uint(max_entries, MAX_FWD_RULES);
+    __type(key, u32);
+    __type(value, policer_tokens_t);
+} map_policer_tokens SEC(".maps");
+
+struct
+{
+    __uint(type, BPF_MAP_TYPE_LRU_HASH);
+    __uint(max_entries, MAX_POLICED_CLIENTS);
+    __uint(map_flags, CONN_LRU_MAP_FLAGS);
+    __type(key, client_policer_key_t);
+    __type(value, policer_t);
+} map_client_policers SEC(".maps");
+
+struct
+{
+    __uint(type, BPF_MAP_TYPE_LRU_PERCPU_HASH);
+    __uint(max_entries, MAX_POLICED_CLIENTS);
+    __uint(map_flags, CONN_LRU_MAP_FLAGS);
+    __type(key, client_policer_key_t);
+    __type(value, policer_tokens_t);
+} map_client_policer_tokens SEC(".maps");
+#endif
+
+#ifdef ENABLE_CONN_RATE_LIMITS
+// New connection rate limiters are stored by client IP and rule ID.
+struct
+{
+    __uint(type, BPF_MAP_TYPE_LRU_HASH);
+    __uint(max_entries, MAX_CONN_RATE_CLIENTS);
+    __uint(map_flags, CONN_LRU_MAP_FLAGS);
+    __type(key, client_policer_key_t);
+    __type(value, conn_limiter_t);
+} map_conn_limiters SEC(".maps");
+#endif
+
+#ifdef ENABLE_FWD_RULE_STATS
+struct 
+{
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+    __uint(max_entries, MAX_FWD_RULES);
+    __type(key, u32);
+    __type(value, fwd_rule_stats_t);
+} map_fwd_rule_stats SEC(".maps");
+#endif
+
 struct
 {
     __uint(type, BPF_MAP_TYPE_HASH);
@@ -20,21 +86,130 @@ struct
     __type(value, fwd_rule_val_t);
 } map_fwd_rules SEC(".maps");
 
+#ifdef ENABLE_FWD_RULE_RANGES
 struct
 {
-    __uint(type, BPF_MAP_TYPE_LRU_HASH);
-    __uint(max_entries, (MAX_BIND_IPS * MAX_PROTOCOLS) * MAX_PORTS);
+    __uint(type, BPF_MAP_TYPE_LPM_TRIE);
+    __uint(max_entries, MAX_FWD_RULE_RANGE_ENTRIES);
+    __uint(map_flags, BPF_F_NO_PREALLOC);
+    __type(key, fwd_rule_range_key_t);
+    __type(value, fwd_rule_val_t);
+} map_fwd_rule_ranges SEC(".maps");
+#endif
+
+#ifdef ENABLE_FWD_RULE_PREFIXES
+struct
+{
+    __uint(type, BPF_MAP_TYPE_LPM_TRIE);
+    __uint(max_entries, MAX_FWD_RULES);
+    __uint(map_flags, BPF_F_NO_PREALLOC);
+    __type(key, fwd_rule_prefix_key_t);
+    __type(value, fwd_rule_val_t);
+} map_fwd_rule_prefixes SEC(".maps");
+#endif
+
+// Backends are stored at (rule ID * MAX_BACKENDS) + backend index.
+struct
+{
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __uint(max_entries, MAX_FWD_RULES * MAX_BACKENDS);
+    __type(key, u32);
+    __type(value, backend_t);
+} map_backends SEC(".maps");
+
+// Each rule's Maglev lookup table maps a slot to a backend index. The loader builds the tables and swaps them in by rule ID.
+struct maglev_table
+{
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __uint(max_entries, MAGLEV_TABLE_SIZE);
+    __type(key, u32);
+    __type(value, u32);
+};
+
+struct
+{
+    __uint(type, BPF_MAP_TYPE_ARRAY_OF_MAPS);
+    __uint(max_entries, MAX_FWD_RULES);
+    __type(key, u32);
+    __array(values, struct maglev_table);
+} map_maglev SEC(".maps");
+
+// Not a LRU map so both entries of a connection are always removed together (by the connection reaper or when its source port is recycled).
+struct
+{
+    __uint(type, BPF_MAP_TYPE_HASH);
+    __uint(max_entries, MAX_CONNS);
     __type(key, conn_key_t);
     __type(value, conn_val_t);
 } map_connections SEC(".maps");
 
+#ifdef CONNECTION_COUNTERS
+struct
+{
+    __uint(type, BPF_MAP_TYPE_LRU_PERCPU_HASH);
+    __uint(max_entries, (MAX_BIND_IPS * MAX_PROTOCOLS) * MAX_PORTS);
+    __uint(map_flags, CONN_LRU_MAP_FLAGS);
+    __type(key, conn_key_t);
+    __type(value, conn_stats_t);
+} map_conn_stats SEC(".maps");
+#endif
+
+struct
+{
+    __uint(type, BPF_MAP_TYPE_HASH);
+    __uint(max_entries, (MAX_BIND_IPS * MAX_PROTOCOLS) * PORT_SLICES);
+    __type(key, port_pool_key_t);
+    __type(value, port_pool_t);
+} map_port_pools SEC(".maps");
+
+#ifdef ENABLE_CONN_REAPER
+struct
+{
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __uint(max_entries, 1);
+    __type(key, u32);
+    __type(value, conn_reaper_t);
+} map_conn_reaper SEC(".maps");
+#endif
+
+#if defined(ENABLE_FIB_LOOKUPS) && defined(ENABLE_FIB_CACHE)
+struct
+{
+    __uint(type, BPF_MAP_TYPE_LRU_HASH);
+    __uint(max_entries, FIB_CACHE_MAX_ENTRIES);
+    __type(key, u128);
+    __type(value, fib_entry_t);
+} map_fib_cache SEC(".maps");
+#endif
+
+#if defined(ENABLE_FIB_LOOKUPS) && defined(ENABLE_FIB_REDIRECT)
+struct
+{
+    __uint(type, BPF_MAP_TYPE_DEVMAP_HASH);
+    __uint(max_entries, MAX_INTERFACES);
+    __type(key, u32);
+    __type(value, u32);
+} map_devices SEC(".maps");
+#endif
+
+#ifdef ENABLE_TUNNELS
+// Tunnels are stored by ID (0 = no tunnel).
+struct
+{
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __uint(max_entries, MAX_TUNNELS + 1);
+    __type(key, u32);
+    __type(value, tunnel_t);
+} map_tunnels SEC(".maps");
+
 struct
 {
     __uint(type, BPF_MAP_TYPE_HASH);
-    __uint(max_entries, MAX_BIND_IPS * MAX_PORTS);
-    __type(key, port_key_t);
-    __type(value, port_val_t);
-} map_ports SEC(".maps");
+    __uint(max_entries, MAX_TUNNELS);
+    __type(key, tunnel_key_t);
+    __type(value, u32);
+} map_tunnel_ids SEC(".maps");
+#endif
 
 #ifdef ENABLE_RULE_LOGGING
 struct
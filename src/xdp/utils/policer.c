@@ -0,0 +1,252 @@
+#include <xdp/utils/policer.h>
+
+#ifdef ENABLE_POLICERS
+/**
+ * Borrows tokens from a shared budget if a CPU's tokens don't cover a packet. The budget is the theoretical arrival time (GCRA) of its rate and borrowing moves it forward.
+ * 
+ * @param tat A pointer to the budget's theoretical arrival time.
+ * @param rate The rate in tokens per second (0 = unlimited).
+ * @param need The amount of tokens the packet needs.
+ * @param now The current timestamp.
+ * @param tokens A pointer to the CPU's tokens.
+ * 
+ * @return 0 if the CPU has enough tokens or 1 if the budget is used up.
+ */
+static __always_inline int borrow_tokens(u64* tat, u64 rate, u64 need, u64 now, u64* tokens)
+{
+    if (!rate || *tokens >= need)
+    {
+        return 0;
+    }
+
+    // Borrow at least POLICER_BORROW_TIME worth of tokens and round up so the tokens cover the packet.
+    u64 cost = ((need - *tokens) * NANO_TO_SEC + rate - 1) / rate;
+
+    if (cost < POLICER_BORROW_TIME * 1000ULL)
+    {
+        cost = POLICER_BORROW_TIME * 1000ULL;
+    }
+
+#pragma clang loop unroll(full)
+    for (int i = 0; i < POLICER_CAS_ATTEMPTS; i++)
+    {
+        u64 old = *tat;
+        u64 base = (old > now) ? old : now;
+
+        // A full bucket always lets a packet through so packets larger than the burst aren't dropped forever.
+        if (base > now && (base - now) + cost > POLICER_BURST * 1000000ULL)
+        {
+            return 1;
+        }
+
+        if (__sync_val_compare_and_swap(tat, old, base + cost) == old)
+        {
+            *tokens += (cost * rate) / NANO_TO_SEC;
+
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/**
+ * Takes a packet's tokens from a CPU's tokens if there are enough of them.
+ * 
+ * @param tokens A pointer to the CPU's tokens.
+ * @param pps The packets per second rate (0 = unlimited).
+ * @param bytes_ps The bytes per second rate (0 = unlimited).
+ * @param bytes The packet's length.
+ * 
+ * @return 0 if the tokens were taken or 1 if there aren't enough tokens.
+ */
+static __always_inline int use_tokens(policer_tokens_t* tokens, u64 pps, u64 bytes_ps, u64 bytes)
+{
+    if ((pps && tokens->pkts < 1) || (bytes_ps && tokens->bytes < bytes))
+    {
+        return 1;
+    }
+
+    if (pps)
+    {
+        tokens->pkts--;
+    }
+
+    if (bytes_ps)
+    {
+        tokens->bytes -= bytes;
+    }
+
+    return 0;
+}
+
+/**
+ * Polices a packet against its forward rule's rates.
+ * 
+ * @param rule A pointer to the forward rule.
+ * @param bytes The packet's length.
+ * @param now The current timestamp.
+ * 
+ * @return 0 if the packet conforms or 1 if it should be dropped.
+ */
+static __always_inline int police_rule(fwd_rule_val_t* rule, u64 bytes, u64 now)
+{
+    if (!rule->pps && !rule->bytes_ps)
+    {
+        return 0;
+    }
+
+    u32 key = rule->id;
+
+    policer_tokens_t* tokens = bpf_map_lookup_elem(&map_policer_tokens, &key);
+
+    if (!tokens)
+    {
+        return 0;
+    }
+
+    // The shared budget is only touched when the CPU's tokens run out.
+    if (use_tokens(tokens, rule->pps, rule->bytes_ps, bytes) == 0)
+    {
+        return 0;
+    }
+
+    policer_t* policer = bpf_map_lookup_elem(&map_policers, &key);
+
+    if (!policer)
+    {
+        return 0;
+    }
+
+    if (borrow_tokens(&policer->pkt_tat, rule->pps, 1, now, &tokens->pkts) || borrow_tokens(&policer->byte_tat, rule->bytes_ps, bytes, now, &tokens->bytes))
+    {
+        return 1;
+    }
+
+    return use_tokens(tokens, rule->pps, rule->bytes_ps, bytes);
+}
+
+/**
+ * Polices a packet against its forward rule's per-client rates.
+ * 
+ * @param rule A pointer to the forward rule.
+ * @param src_ip The client's IP.
+ * @param bytes The packet's length.
+ * @param now The current timestamp.
+ * 
+ * @return 0 if the packet conforms or 1 if it should be dropped.
+ */
+static __always_inline int police_client(fwd_rule_val_t* rule, u128 src_ip, u64 bytes, u64 now)
+{
+    if (!rule->client_pps && !rule->client_bytes_ps)
+    {
+        return 0;
+    }
+
+    client_policer_key_t key = {0};
+    key.ip = src_ip;
+    key.rule_id = rule->id;
+
+    policer_tokens_t* tokens = bpf_map_lookup_elem(&map_client_policer_tokens, &key);
+
+    if (!tokens)
+    {
+        policer_tokens_t new_tokens = {0};
+
+        bpf_map_update_elem(&map_client_policer_tokens, &key, &new_tokens, BPF_NOEXIST);
+
+        if ((tokens = bpf_map_lookup_elem(&map_client_policer_tokens, &key)) == NULL)
+        {
+            return 0;
+        }
+    }
+
+    if (use_tokens(tokens, rule->client_pps, rule->client_bytes_ps, bytes) == 0)
+    {
+        return 0;
+    }
+
+    policer_t* policer = bpf_map_lookup_elem(&map_client_policers, &key);
+
+    if (!policer)
+    {
+        // New clients start with a full budget.
+        policer_t new_policer = {0};
+
+        bpf_map_update_elem(&map_client_policers, &key, &new_policer, BPF_NOEXIST);
+
+        if ((policer = bpf_map_lookup_elem(&map_client_policers, &key)) == NULL)
+        {
+            return 0;
+        }
+    }
+
+    if (borrow_tokens(&policer->pkt_tat, rule->client_pps, 1, now, &tokens->pkts) || borrow_tokens(&policer->byte_tat, rule->client_bytes_ps, bytes, now, &tokens->bytes))
+    {
+        return 1;
+    }
+
+    return use_tokens(tokens, rule->client_pps, rule->client_bytes_ps, bytes);
+}
+#endif
+
+#ifdef ENABLE_CONN_RATE_LIMITS
+/**
+ * Checks whether a client may create another connection through its forward rule.
+ * 
+ * @param rule A pointer to the forward rule.
+ * @param src_ip The client's IP.
+ * @param now The current timestamp.
+ * 
+ * @return 0 if the connection may be created or 1 if the client is over the rule's new connection rate.
+ */
+static __always_inline int limit_new_conn(fwd_rule_val_t* rule, u128 src_ip, u64 now)
+{
+    if (!rule->conn_rate)
+    {
+        return 0;
+    }
+
+    client_policer_key_t key = {0};
+    key.ip = src_ip;
+    key.rule_id = rule->id;
+
+    conn_limiter_t* limiter = bpf_map_lookup_elem(&map_conn_limiters, &key);
+
+    if (!limiter)
+    {
+        // New clients start with a full budget.
+        conn_limiter_t new_limiter = {0};
+
+        bpf_map_update_elem(&map_conn_limiters, &key, &new_limiter, BPF_NOEXIST);
+
+        if ((limiter = bpf_map_lookup_elem(&map_conn_limiters, &key)) == NULL)
+        {
+            return 0;
+        }
+    }
+
+    // Each connection moves the theoretical arrival time forward by one interval and a client may be up to a burst of intervals ahead.
+    u64 interval = NANO_TO_SEC / rule->conn_rate;
+    u64 burst = (u64)((rule->conn_burst) ? rule->conn_burst : 1) * interval;
+
+#pragma clang loop unroll(full)
+    for (int i = 0; i < POLICER_CAS_ATTEMPTS; i++)
+    {
+        u64 old = limiter->tat;
+        u64 base = (old > now) ? old : now;
+
+        if ((base + interval) - now > burst)
+        {
+            return 1;
+        }
+
+        if (__sync_val_compare_and_swap(&limiter->tat, old, base + interval) == old)
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+#endif
\ No newline at end of file
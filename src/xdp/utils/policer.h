@@ -0,0 +1,25 @@
+#pragma once
+
+#include <common/all.h>
+
+#include <xdp/utils/helpers.h>
+#include <xdp/utils/maps.h>
+
+// The amount of times borrowing from a shared budget is retried when another CPU updated it at the same time.
+#define POLICER_CAS_ATTEMPTS 4
+
+#ifdef ENABLE_POLICERS
+static __always_inline int borrow_tokens(u64* tat, u64 rate, u64 need, u64 now, u64* tokens);
+static __always_inline int use_tokens(policer_tokens_t* tokens, u64 pps, u64 bytes_ps, u64 bytes);
+static __always_inline int police_rule(fwd_rule_val_t* rule, u64 bytes, u64 now);
+static __always_inline int police_client(fwd_rule_val_t* rule, u128 src_ip, u64 bytes, u64 now);
+#endif
+
+#ifdef ENABLE_CONN_RATE_LIMITS
+static __always_inline int limit_new_conn(fwd_rule_val_t* rule, u128 src_ip, u64 now);
+#endif
+
+// The source file is included directly below instead of compiled and linked as an object because when linking, there is no guarantee the compiler will inline the function (which is crucial for performance).
+// I'd prefer not to include the function logic inside of the header file.
+// More Info: https://stackoverflow.com/questions/24289599/always-inline-does-not-work-when-function-is-implemented-in-different-file
+#include "policer.c"
\ No newline at end of file
@@ -1,47 +1,285 @@
 #include <xdp/utils/port.h>
 
 /**
- * Chooses the next available source port.
+ * Pops a free port off a port pool (slice).
  * 
- * @param idx The loop index.
- * @param data A pointer to a port context.
+ * @param pool A pointer to the port pool.
+ * @param hand If not NULL and the pool has no free ports, stores the pool's clock hand here and moves it forward for the next recycle.
  * 
- * @return 1 to break the loop or 0 to continue the loop.
+ * @return The port (host byte order) or 0 if the pool has no free ports.
  */
-static __always_inline long choose_port(u32 idx, void* data)
+static __always_inline u16 pop_port(port_pool_t* pool, u32* hand)
 {
-    port_ctx_t* ctx = data;
+    u16 port = 0;
 
-    u16 port = MIN_PORT + idx;
+    bpf_spin_lock(&pool->lock);
 
-    ctx->port_key.port = htons(port);
+    u32 free_cnt = pool->free_cnt;
 
-    port_val_t *port_lookup = bpf_map_lookup_elem(&map_ports, &ctx->port_key);
+    if (free_cnt > 0 && free_cnt <= PORT_SLICE_SIZE)
+    {
+        port = pool->free[free_cnt - 1];
+
+        pool->free_cnt = free_cnt - 1;
+    }
+    else if (hand)
+    {
+        // Move the clock hand past the ports we're about to inspect so other CPUs recycling at the same time look elsewhere.
+        *hand = pool->hand;
+
+        pool->hand = (*hand + PORT_RECYCLE_CANDIDATES) % PORT_SLICE_SIZE;
+    }
+
+    bpf_spin_unlock(&pool->lock);
+
+    return port;
+}
+
+/**
+ * Claims a port in use by removing the connection owning it.
+ * 
+ * The reply key is deleted first. Only the CPU whose delete succeeds owns the port afterwards, so CPUs recycling the same port at once (or the connection reaper releasing it) can't hand it out twice.
+ * 
+ * @param port_key A pointer to the port key (bind IP and protocol must be set).
+ * @param port The port to claim (host byte order).
+ * 
+ * @return 1 if we claimed the port or 0 if it has no owner or another CPU removed the owner first.
+ */
+static __always_inline int claim_port(port_key_t* port_key, u16 port)
+{
+    conn_key_t reply_key = {0};
+    get_reply_conn_key(port_key->bind_ip, htons(port), port_key->protocol, &reply_key);
+
+    conn_val_t* conn = bpf_map_lookup_elem(&map_connections, &reply_key);
+
+    if (!conn)
+    {
+        return 0;
+    }
+
+    // The connection may be gone once its reply key is deleted, so the client key is retrieved beforehand.
+    conn_key_t key = {0};
+    get_conn_key(conn, port_key->protocol, &key);
+
+    if (bpf_map_delete_elem(&map_connections, &reply_key) != 0)
+    {
+        return 0;
+    }
+
+    // The client key is only removed if it still belongs to the connection we took the port from.
+    conn_val_t* client_conn = bpf_map_lookup_elem(&map_connections, &key);
+
+    if (client_conn && client_conn->snat_ip == port_key->bind_ip && client_conn->port == htons(port))
+    {
+        bpf_map_delete_elem(&map_connections, &key);
+
+#ifdef CONNECTION_COUNTERS
+        bpf_map_delete_elem(&map_conn_stats, &key);
+#endif
+    }
 
-    if (!port_lookup)
+    inc_evicted_stats();
+
+    return 1;
+}
+
+/**
+ * Picks a port in use to hand out again once a port pool (slice) has no free ports left.
+ * 
+ * Only PORT_RECYCLE_CANDIDATES ports starting at the slice's clock hand are inspected. Since the hand moves forward on every recycle, the ports it visits are the ones handed out the longest time ago.
+ * Ports without an owner are skipped since they're either on the free stack or were just handed out and their connection isn't inserted yet. The connection owning the chosen port is removed with claim_port() and the other candidates are tried in order if another CPU claimed it first.
+ * 
+ * @param port_key A pointer to the port key (bind IP and protocol must be set).
+ * @param slice The slice to recycle a port from.
+ * @param hand The slice's clock hand (offset from the start of the slice).
+ * 
+ * @return The port to use (host byte order) or 0 on failure.
+ */
+static __always_inline u16 recycle_port(port_key_t* port_key, u32 slice, u32 hand)
+{
+    u16 port_to_use = 0;
+    u64 last = UINT64_MAX;
+
+    // The last slice may be shorter than the others.
+    u32 base = slice * PORT_SLICE_SIZE;
+    u32 size = PORT_SLICE_SIZE;
+
+    if (base + size > MAX_PORTS)
     {
-        ctx->port_to_use = port;
-        
-        return 1;
+        size = MAX_PORTS - base;
     }
 
+    if (size < 1 || size > PORT_SLICE_SIZE)
+    {
+        return 0;
+    }
+
+    // The candidates owned by a connection (0 = no owner).
+    u16 owned[PORT_RECYCLE_CANDIDATES] = {0};
+
+#pragma clang loop unroll(full)
+    for (u32 i = 0; i < PORT_RECYCLE_CANDIDATES; i++)
+    {
+        u16 port = MIN_PORT + base + ((hand + i) % size);
+
+        conn_key_t conn_key = {0};
+        get_reply_conn_key(port_key->bind_ip, htons(port), port_key->protocol, &conn_key);
+
+        conn_val_t* conn = bpf_map_lookup_elem(&map_connections, &conn_key);
+
+        if (!conn)
+        {
+            continue;
+        }
+
+        owned[i] = port;
+
+        u64 count = 0;
+        u64 last_seen = get_conn_last_seen(conn, port_key->protocol, &count);
+
 #ifdef RECYCLE_LAST_SEEN
-    if (port_lookup->last_seen < ctx->last)
+        if (last_seen < last)
+        {
+            port_to_use = port;
+            last = last_seen;
+        }
+#else
+        if (count > 0)
+        {
+            u64 pps = (last_seen - conn->first_seen) / count;
+
+            if (last > pps)
+            {
+                port_to_use = port;
+                last = pps;
+            }
+        }
+#endif
+    }
+
+    // The port is handed out again right away, so it isn't released.
+    if (port_to_use && claim_port(port_key, port_to_use))
+    {
+        return port_to_use;
+    }
+
+#pragma clang loop unroll(full)
+    for (u32 i = 0; i < PORT_RECYCLE_CANDIDATES; i++)
     {
-        ctx->port_to_use = port;
-        ctx->last = port_lookup->last_seen;
+        if (owned[i] && owned[i] != port_to_use && claim_port(port_key, owned[i]))
+        {
+            return owned[i];
+        }
     }
+
+    return 0;
+}
+
+/**
+ * Allocates a source port for a new connection from the bind IP's port pool.
+ * 
+ * Free ports are popped off the pool's stack in constant time. With port pool slices enabled, each CPU pops from its own slice and only steals from neighbouring slices when its slice is exhausted.
+ * When no free ports are found, a port in use is recycled from the CPU's slice using recycle_port().
+ * 
+ * @param port_key A pointer to the port key (bind IP and protocol must be set).
+ * 
+ * @return The port to use (host byte order) or 0 on failure.
+ */
+static __always_inline u16 alloc_port(port_key_t* port_key)
+{
+    port_pool_key_t pool_key = {0};
+    pool_key.bind_ip = port_key->bind_ip;
+    pool_key.protocol = port_key->protocol;
+
+#ifdef ENABLE_PORT_POOL_SLICES
+    u32 slice = bpf_get_smp_processor_id() % PORT_SLICES;
 #else
-    if (port_lookup->count > 0)
+    u32 slice = 0;
+#endif
+
+    pool_key.slice = slice;
+
+    port_pool_t* pool = bpf_map_lookup_elem(&map_port_pools, &pool_key);
+
+    // The loader creates a pool for every bind IP and protocol used by a forward rule.
+    if (!pool)
+    {
+        return 0;
+    }
+
+    u32 hand = 0;
+
+    u16 port = pop_port(pool, &hand);
+
+    if (port)
+    {
+        return port;
+    }
+
+#ifdef ENABLE_PORT_POOL_SLICES
+    // Our slice is exhausted, so try stealing a free port from our neighbours.
+#pragma clang loop unroll(full)
+    for (u32 i = 1; i <= PORT_POOL_STEAL_ATTEMPTS && i < PORT_SLICES; i++)
     {
-        u64 pps = (port_lookup->last_seen - port_lookup->first_seen) / port_lookup->count;
-        if (ctx->last > pps)
+        pool_key.slice = (slice + i) % PORT_SLICES;
+
+        port_pool_t* neighbour = bpf_map_lookup_elem(&map_port_pools, &pool_key);
+
+        if (!neighbour)
+        {
+            continue;
+        }
+
+        if ((port = pop_port(neighbour, NULL)))
         {
-            ctx->port_to_use = port;
-            ctx->last = pps;
+            return port;
         }
     }
 #endif
 
-    return 0;
+    return recycle_port(port_key, slice, hand);
+}
+
+/**
+ * Returns a source port to the free stack of the port pool (slice) it was handed out from.
+ * 
+ * The caller must make sure the port is no longer owned by a connection (its reply key is deleted), otherwise it may be handed out twice.
+ * 
+ * @param port_key A pointer to the port key of the port to release.
+ * 
+ * @return void
+ */
+static __always_inline void release_port(port_key_t* port_key)
+{
+    u16 port = ntohs(port_key->port);
+
+    if (port < MIN_PORT || port > MAX_PORT)
+    {
+        return;
+    }
+
+    port_pool_key_t pool_key = {0};
+    pool_key.bind_ip = port_key->bind_ip;
+    pool_key.protocol = port_key->protocol;
+    pool_key.slice = (port - MIN_PORT) / PORT_SLICE_SIZE;
+
+    port_pool_t* pool = bpf_map_lookup_elem(&map_port_pools, &pool_key);
+
+    if (!pool)
+    {
+        return;
+    }
+
+    bpf_spin_lock(&pool->lock);
+
+    u32 free_cnt = pool->free_cnt;
+
+    if (free_cnt < PORT_SLICE_SIZE)
+    {
+        pool->free[free_cnt] = port;
+
+        pool->free_cnt = free_cnt + 1;
+    }
+
+    bpf_spin_unlock(&pool->lock);
 }
\ No newline at end of file
@@ -3,17 +3,16 @@
 #include <common/all.h>
 
 #include <xdp/utils/maps.h>
+#include <xdp/utils/conn.h>
+#include <xdp/utils/stats.h>
 
-struct port_ctx
-{
-    u64 last;
-    u16 port_to_use;
-    port_key_t port_key;
-} typedef port_ctx_t;
-
-static __always_inline long choose_port(u32 idx, void* data);
+static __always_inline u16 pop_port(port_pool_t* pool, u32* hand);
+static __always_inline int claim_port(port_key_t* port_key, u16 port);
+static __always_inline u16 recycle_port(port_key_t* port_key, u32 slice, u32 hand);
+static __always_inline u16 alloc_port(port_key_t* port_key);
+static __always_inline void release_port(port_key_t* port_key);
 
 // The source file is included directly below instead of compiled and linked as an object because when linking, there is no guarantee the compiler will inline the function (which is crucial for performance).
 // I'd prefer not to include the function logic inside of the header file.
 // More Info: https://stackoverflow.com/questions/24289599/always-inline-does-not-work-when-function-is-implemented-in-different-file
-#include "port.c"
\ No newline at end of file
+#include "port.c"
@@ -0,0 +1,136 @@
+#include <xdp/utils/reaper.h>
+
+#ifdef ENABLE_CONN_REAPER
+/**
+ * Expires a connection if it has been idle longer than its timeout in both directions.
+ * 
+ * Connections are expired through their reply key and release their source port. Client keys are only expired by themselves if their reply key is already gone.
+ * 
+ * @param map A pointer to the connections map.
+ * @param key A pointer to the connection key.
+ * @param val A pointer to the connection.
+ * @param now A pointer to the current timestamp.
+ * 
+ * @return Always 0 (continue iterating).
+ */
+static __always_inline long reap_conn(void* map, conn_key_t* key, conn_val_t* val, u64* now)
+{
+    u8 protocol = key->protocol;
+    int reply = is_reply_conn_key(key);
+
+    u64 last_seen = val->last_seen;
+
+    if (reply)
+    {
+        last_seen = get_conn_last_seen(val, protocol, NULL);
+    }
+    else
+    {
+        conn_key_t reply_key = {0};
+        get_reply_conn_key(val->snat_ip, val->port, protocol, &reply_key);
+
+        // The reply key takes care of it.
+        if (bpf_map_lookup_elem(&map_connections, &reply_key))
+        {
+            return 0;
+        }
+    }
+
+    if (last_seen > *now)
+    {
+        return 0;
+    }
+
+    u64 timeout = val->timeout;
+
+    // TCP connections that aren't established expire sooner.
+    if (protocol == IPPROTO_TCP)
+    {
+        switch (val->tcp_state)
+        {
+            case CONN_TCP_SYN_SENT:
+            case CONN_TCP_FIN_WAIT:
+                timeout = val->close_timeout;
+
+                break;
+
+            case CONN_TCP_TIME_WAIT:
+            case CONN_TCP_CLOSED:
+                timeout = val->time_wait_timeout;
+
+                break;
+        }
+    }
+
+    // A timeout of 0 means the connection never expires.
+    if (timeout < 1 || (*now - last_seen) < timeout * NANO_TO_SEC)
+    {
+        return 0;
+    }
+
+    // The entry is gone once the connection is deleted.
+    conn_val_t conn = *val;
+
+    // Only hand the port back if we were the ones to remove it.
+    if (delete_conn(&conn, protocol) == 0 && reply)
+    {
+        port_key_t port_key = {0};
+        port_key.bind_ip = conn.snat_ip;
+        port_key.protocol = protocol;
+        port_key.port = conn.port;
+
+        release_port(&port_key);
+    }
+
+    return 0;
+}
+
+/**
+ * Timer callback that sweeps the connections map for idle connections and re-arms itself.
+ * 
+ * @param map A pointer to the connection reaper map.
+ * @param key A pointer to the connection reaper key.
+ * @param reaper A pointer to the connection reaper.
+ * 
+ * @return Always 0.
+ */
+static __always_inline int reap_conns(void* map, u32* key, conn_reaper_t* reaper)
+{
+    u64 now = bpf_ktime_get_ns();
+
+    bpf_for_each_map_elem(&map_connections, reap_conn, &now, 0);
+
+    bpf_timer_start(&reaper->timer, CONN_REAPER_INTERVAL * NANO_TO_SEC, 0);
+
+    return 0;
+}
+
+/**
+ * Starts the connection reaper timer if it isn't running yet.
+ * 
+ * BPF timers can only be initialized from a BPF program, so this is called when connections are created.
+ * 
+ * @return void
+ */
+static __always_inline void start_conn_reaper()
+{
+    u32 key = 0;
+
+    conn_reaper_t* reaper = bpf_map_lookup_elem(&map_conn_reaper, &key);
+
+    if (!reaper || reaper->started)
+    {
+        return;
+    }
+
+    // Make sure only one CPU initializes the timer.
+    if (__sync_val_compare_and_swap(&reaper->started, 0, 1) != 0)
+    {
+        return;
+    }
+
+    bpf_timer_init(&reaper->timer, &map_conn_reaper, CLOCK_MONOTONIC);
+    bpf_timer_set_callback(&reaper->timer, reap_conns);
+    bpf_timer_start(&reaper->timer, CONN_REAPER_INTERVAL * NANO_TO_SEC, 0);
+}
+#endif
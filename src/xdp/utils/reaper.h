@@ -0,0 +1,25 @@
+#pragma once
+
+#include <common/all.h>
+
+#include <linux/in.h>
+
+#include <xdp/utils/helpers.h>
+#include <xdp/utils/maps.h>
+#include <xdp/utils/port.h>
+#include <xdp/utils/conn.h>
+
+#ifndef CLOCK_MONOTONIC
+#define CLOCK_MONOTONIC 1
+#endif
+
+#ifdef ENABLE_CONN_REAPER
+static __always_inline long reap_conn(void* map, conn_key_t* key, conn_val_t* val, u64* now);
+static __always_inline int reap_conns(void* map, u32* key, conn_reaper_t* reaper);
+static __always_inline void start_conn_reaper();
+#endif
+
+// The source file is included directly below instead of compiled and linked as an object because when linking, there is no guarantee the compiler will inline the function (which is crucial for performance).
+// I'd prefer not to include the function logic inside of the header file.
+// More Info: https://stackoverflow.com/questions/24289599/always-inline-does-not-work-when-function-is-implemented-in-different-file
+#include "reaper.c"
@@ -0,0 +1,214 @@
+#include <xdp/utils/reject.h>
+
+#ifdef ENABLE_FAST_REJECT
+/**
+ * Turns a TCP packet into a RST sent back to the client (RFC 793's reset generation for segments without a connection).
+ * 
+ * @param ctx A pointer to the xdp_md struct containing all packet information.
+ * @param data The packet's data pointer.
+ * @param data_end The packet's data end pointer.
+ * @param eth A pointer to the ethernet header.
+ * @param iph A pointer to the IPv4 header (NULL for IPv6 packets).
+ * @param iph6 A pointer to the IPv6 header (NULL for IPv4 packets).
+ * @param tcph A pointer to the TCP header.
+ * 
+ * @return XDP_TX (sends the RST back out the TX path) or XDP_DROP.
+ */
+static __always_inline int send_tcp_rst(struct xdp_md* ctx, void* data, void* data_end, struct ethhdr* eth, struct iphdr* iph, struct ipv6hdr* iph6, struct tcphdr* tcph)
+{
+    // Resets are never answered. We also only rewrite packets without IPv4 options or IPv6 extension headers.
+    if (tcph->rst || (iph && iph->ihl != 5) || (iph6 && iph6->nexthdr != IPPROTO_TCP))
+    {
+        return XDP_DROP;
+    }
+
+    // Segments acknowledging something are reset with the sequence number they expect.
+    if (tcph->ack)
+    {
+        return send_tcp_reply(ctx, data, data_end, eth, iph, iph6, tcph, ntohl(tcph->ack_seq), 0, TCP_FLAG_RST, 0);
+    }
+
+    // Otherwise, the RST acknowledges the segment (SYN and FIN count as one byte each).
+    u32 th_len = tcph->doff * 4;
+    u32 l4_len = (iph) ? ntohs(iph->tot_len) - sizeof(struct iphdr) : ntohs(iph6->payload_len);
+
+    if (th_len < sizeof(struct tcphdr) || th_len > l4_len)
+    {
+        return XDP_DROP;
+    }
+
+    u32 ack_seq = ntohl(tcph->seq) + (l4_len - th_len) + tcph->syn + tcph->fin;
+
+    return send_tcp_reply(ctx, data, data_end, eth, iph, iph6, tcph, 0, ack_seq, TCP_FLAG_RST | TCP_FLAG_ACK, 0);
+}
+
+/**
+ * Turns a UDP packet into an ICMP (or ICMPv6) port unreachable message sent back to the client.
+ * 
+ * The new IP and ICMP headers are prepended, so the rejected packet's IP header and the first REJECT_QUOTE_LEN bytes of its UDP header are quoted in place.
+ * 
+ * @param ctx A pointer to the xdp_md struct containing all packet information.
+ * @param iph A pointer to the IPv4 header (NULL for IPv6 packets).
+ * @param iph6 A pointer to the IPv6 header (NULL for IPv4 packets).
+ * 
+ * @return XDP_TX (sends the message back out the TX path) or XDP_DROP.
+ */
+static __always_inline int send_port_unreach(struct xdp_md* ctx, struct iphdr* iph, struct ipv6hdr* iph6)
+{
+    // Only headers without IPv4 options or IPv6 extension headers are quoted.
+    if ((iph && iph->ihl != 5) || (iph6 && iph6->nexthdr != IPPROTO_UDP))
+    {
+        return XDP_DROP;
+    }
+
+    int is_ip4 = (iph != NULL);
+
+    // The ICMP and ICMPv6 headers are both eight bytes long.
+    int l3_len = (is_ip4) ? sizeof(struct iphdr) : sizeof(struct ipv6hdr);
+    int hdr_len = l3_len + sizeof(struct icmphdr);
+
+    if (bpf_xdp_adjust_head(ctx, 0 - hdr_len))
+    {
+        return XDP_DROP;
+    }
+
+    void* data = (void*)(long)ctx->data;
+    void* data_end = (void*)(long)ctx->data_end;
+
+    // Remove what follows the quoted bytes.
+    int len = sizeof(struct ethhdr) + hdr_len + l3_len + REJECT_QUOTE_LEN;
+    int delta = len - (int)(data_end - data);
+
+    if (delta < 0 && bpf_xdp_adjust_tail(ctx, delta))
+    {
+        return XDP_DROP;
+    }
+
+    data = (void*)(long)ctx->data;
+    data_end = (void*)(long)ctx->data_end;
+
+    struct ethhdr* eth = data;
+    struct ethhdr* old_eth = data + hdr_len;
+
+    if (old_eth + 1 > (struct ethhdr*)data_end)
+    {
+        return XDP_DROP;
+    }
+
+    // Send the message back where the packet came from (the old ethernet header is overwritten by the new IP header afterwards).
+    memcpy(eth->h_dest, old_eth->h_source, ETH_ALEN);
+    memcpy(eth->h_source, old_eth->h_dest, ETH_ALEN);
+    eth->h_proto = old_eth->h_proto;
+
+    if (is_ip4)
+    {
+        struct iphdr* new_iph = data + sizeof(struct ethhdr);
+        struct icmphdr* icmph = (void*)(new_iph + 1);
+        struct iphdr* quoted = (void*)(icmph + 1);
+
+        if ((void*)(quoted + 1) + REJECT_QUOTE_LEN > data_end)
+        {
+            return XDP_DROP;
+        }
+
+        u32 saddr = quoted->daddr;
+        u32 daddr = quoted->saddr;
+
+        new_iph->version = 4;
+        new_iph->ihl = 5;
+        new_iph->tos = 0;
+        new_iph->tot_len = htons(sizeof(struct iphdr) + sizeof(struct icmphdr) + sizeof(struct iphdr) + REJECT_QUOTE_LEN);
+        new_iph->id = 0;
+        new_iph->frag_off = 0;
+        new_iph->ttl = 64;
+        new_iph->protocol = IPPROTO_ICMP;
+        new_iph->saddr = saddr;
+        new_iph->daddr = daddr;
+
+        update_iph_checksum(new_iph);
+
+        icmph->type = ICMP_DEST_UNREACH;
+        icmph->code = ICMP_PORT_UNREACH;
+        icmph->checksum = 0;
+        icmph->un.gateway = 0;
+
+        icmph->checksum = csum_fold_helper(bpf_csum_diff(NULL, 0, (__be32*)icmph, sizeof(struct icmphdr) + sizeof(struct iphdr) + REJECT_QUOTE_LEN, 0));
+    }
+    else
+    {
+        struct ipv6hdr* new_iph6 = data + sizeof(struct ethhdr);
+        struct icmp6hdr* icmp6h = (void*)(new_iph6 + 1);
+        struct ipv6hdr* quoted = (void*)(icmp6h + 1);
+
+        if ((void*)(quoted + 1) + REJECT_QUOTE_LEN > data_end)
+        {
+            return XDP_DROP;
+        }
+
+        u32 icmp_len = sizeof(struct icmp6hdr) + sizeof(struct ipv6hdr) + REJECT_QUOTE_LEN;
+
+        // Version 6 without traffic class and flow label.
+        *(be32*)new_iph6 = htonl(6 << 28);
+
+        new_iph6->payload_len = htons(icmp_len);
+        new_iph6->nexthdr = IPPROTO_ICMPV6;
+        new_iph6->hop_limit = 64;
+
+        memcpy(&new_iph6->saddr, &quoted->daddr, sizeof(new_iph6->saddr));
+        memcpy(&new_iph6->daddr, &quoted->saddr, sizeof(new_iph6->daddr));
+
+        icmp6h->icmp6_type = ICMPV6_DEST_UNREACH;
+        icmp6h->icmp6_code = ICMPV6_PORT_UNREACH;
+        icmp6h->icmp6_cksum = 0;
+        icmp6h->icmp6_dataun.un_data32[0] = 0;
+
+        // The ICMPv6 checksum covers a pseudo-header with the addresses, length, and next header.
+        u32 csum = 0;
+
+        // The source and destination addresses are next to each other.
+        u32* addrs = (u32*)&new_iph6->saddr;
+
+#pragma clang loop unroll(full)
+        for (int i = 0; i < 8; i++)
+        {
+            csum = csum_add(addrs[i], csum);
+        }
+
+        csum = csum_add(htonl(icmp_len), csum);
+        csum = csum_add(htonl(IPPROTO_ICMPV6), csum);
+
+        icmp6h->icmp6_cksum = csum_fold_helper(bpf_csum_diff(NULL, 0, (__be32*)icmp6h, sizeof(struct icmp6hdr) + sizeof(struct ipv6hdr) + REJECT_QUOTE_LEN, csum));
+    }
+
+    return XDP_TX;
+}
+
+/**
+ * Rejects a packet of a new connection so the client fails over right away instead of retransmitting.
+ * 
+ * @param ctx A pointer to the xdp_md struct containing all packet information.
+ * @param data The packet's data pointer.
+ * @param data_end The packet's data end pointer.
+ * @param eth A pointer to the ethernet header.
+ * @param iph A pointer to the IPv4 header (NULL for IPv6 packets).
+ * @param iph6 A pointer to the IPv6 header (NULL for IPv4 packets).
+ * @param tcph A pointer to the TCP header (NULL if not TCP).
+ * @param udph A pointer to the UDP header (NULL if not UDP).
+ * 
+ * @return XDP_TX (sends a TCP RST or ICMP port unreachable back out the TX path) or XDP_DROP (other protocols and packets we can't answer).
+ */
+static __always_inline int send_reject(struct xdp_md* ctx, void* data, void* data_end, struct ethhdr* eth, struct iphdr* iph, struct ipv6hdr* iph6, struct tcphdr* tcph, struct udphdr* udph)
+{
+    if (tcph)
+    {
+        return send_tcp_rst(ctx, data, data_end, eth, iph, iph6, tcph);
+    }
+
+    if (udph)
+    {
+        return send_port_unreach(ctx, iph, iph6);
+    }
+
+    return XDP_DROP;
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <common/all.h>
+
+#include <linux/if_ether.h>
+#include <linux/ip.h>
+#include <linux/ipv6.h>
+#include <linux/tcp.h>
+#include <linux/udp.h>
+#include <linux/icmp.h>
+#include <linux/icmpv6.h>
+#include <linux/in.h>
+
+#include <xdp/utils/csum.h>
+#include <xdp/utils/helpers.h>
+#include <xdp/utils/synproxy.h>
+
+// The amount of bytes of the rejected packet's layer-4 header quoted in ICMP port unreachable messages.
+#define REJECT_QUOTE_LEN 8
+
+#ifdef ENABLE_FAST_REJECT
+static __always_inline int send_tcp_rst(struct xdp_md* ctx, void* data, void* data_end, struct ethhdr* eth, struct iphdr* iph, struct ipv6hdr* iph6, struct tcphdr* tcph);
+static __always_inline int send_port_unreach(struct xdp_md* ctx, struct iphdr* iph, struct ipv6hdr* iph6);
+static __always_inline int send_reject(struct xdp_md* ctx, void* data, void* data_end, struct ethhdr* eth, struct iphdr* iph, struct ipv6hdr* iph6, struct tcphdr* tcph, struct udphdr* udph);
+#endif
+
+// The source file is included directly below instead of compiled and linked as an object because when linking, there is no guarantee the compiler will inline the function (which is crucial for performance).
+// I'd prefer not to include the function logic inside of the header file.
+// More Info: https://stackoverflow.com/questions/24289599/always-inline-does-not-work-when-function-is-implemented-in-different-file
+#include "reject.c"
\ No newline at end of file
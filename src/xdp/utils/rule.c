@@ -0,0 +1,43 @@
+#include <xdp/utils/rule.h>
+
+/**
+ * Finds the forward rule matching a packet's destination. Single-port rules take precedence over port range rules which take precedence over bind prefix rules.
+ * 
+ * @param key A pointer to the forward rule key (destination IP, port, and protocol).
+ * 
+ * @return A pointer to the forward rule or NULL if no rule matches.
+ */
+static __always_inline fwd_rule_val_t* get_fwd_rule(fwd_rule_key_t* key)
+{
+    fwd_rule_val_t* rule = bpf_map_lookup_elem(&map_fwd_rules, key);
+
+#ifdef ENABLE_FWD_RULE_RANGES
+    if (!rule && key->port)
+    {
+        fwd_rule_range_key_t range_key = {0};
+        range_key.prefixlen = FWD_RULE_RANGE_PREFIXLEN;
+
+        range_key.protocol = key->protocol;
+        range_key.ip = key->ip;
+        range_key.port = key->port;
+
+        rule = bpf_map_lookup_elem(&map_fwd_rule_ranges, &range_key);
+    }
+#endif
+
+#ifdef ENABLE_FWD_RULE_PREFIXES
+    if (!rule)
+    {
+        fwd_rule_prefix_key_t prefix_key = {0};
+        prefix_key.prefixlen = FWD_RULE_PREFIX_BASE_LEN + 128;
+
+        prefix_key.protocol = key->protocol;
+        prefix_key.port = key->port;
+        prefix_key.ip = key->ip;
+
+        rule = bpf_map_lookup_elem(&map_fwd_rule_prefixes, &prefix_key);
+    }
+#endif
+
+    return rule;
+}
\ No newline at end of file
@@ -0,0 +1,111 @@
+#include <xdp/utils/state.h>
+
+/**
+ * Retrieves the TCP state of a new connection from the client's first packet.
+ * 
+ * @param tcph A pointer to the TCP header.
+ * 
+ * @return The TCP state (CONN_TCP_ESTABLISHED if we picked up the connection mid-stream).
+ */
+static __always_inline u8 get_new_tcp_state(struct tcphdr* tcph)
+{
+    if (tcph->rst)
+    {
+        return CONN_TCP_CLOSED;
+    }
+
+    if (tcph->syn && !tcph->ack)
+    {
+        return CONN_TCP_SYN_SENT;
+    }
+
+    return CONN_TCP_ESTABLISHED;
+}
+
+/**
+ * Moves a connection through the TCP state machine based off of the flags seen in either direction.
+ * 
+ * @param conn A pointer to the connection.
+ * @param tcph A pointer to the TCP header.
+ * @param from_client 1 if the packet was sent by the client or 0 if it was sent by the destination.
+ * 
+ * @return 1 if the state changed or 0 otherwise.
+ */
+static __always_inline int update_tcp_state(conn_val_t* conn, struct tcphdr* tcph, int from_client)
+{
+    u8 state = conn->tcp_state;
+    u8 fin_flags = conn->fin_flags;
+
+    if (tcph->rst)
+    {
+        state = CONN_TCP_CLOSED;
+    }
+    else
+    {
+        switch (state)
+        {
+            case CONN_TCP_SYN_SENT:
+                if (tcph->fin)
+                {
+                    state = CONN_TCP_FIN_WAIT;
+                    fin_flags |= (from_client) ? CONN_FIN_CLIENT : CONN_FIN_SERVER;
+                }
+                else if (!from_client && tcph->syn && tcph->ack)
+                {
+                    state = CONN_TCP_ESTABLISHED;
+                }
+
+                break;
+
+            case CONN_TCP_ESTABLISHED:
+                if (tcph->fin)
+                {
+                    state = CONN_TCP_FIN_WAIT;
+                    fin_flags |= (from_client) ? CONN_FIN_CLIENT : CONN_FIN_SERVER;
+                }
+
+                break;
+
+            case CONN_TCP_FIN_WAIT:
+                if (tcph->fin)
+                {
+                    fin_flags |= (from_client) ? CONN_FIN_CLIENT : CONN_FIN_SERVER;
+
+                    // Both sides are done once each of them sent a FIN.
+                    if ((fin_flags & (CONN_FIN_CLIENT | CONN_FIN_SERVER)) == (CONN_FIN_CLIENT | CONN_FIN_SERVER))
+                    {
+                        state = CONN_TCP_TIME_WAIT;
+                    }
+                }
+
+                break;
+
+            case CONN_TCP_TIME_WAIT:
+            case CONN_TCP_CLOSED:
+                // The client is reusing its source port for a new connection before we expired the old one.
+                if (from_client && tcph->syn && !tcph->ack)
+                {
+                    state = CONN_TCP_SYN_SENT;
+                    fin_flags = 0;
+                }
+
+                break;
+
+            default:
+                state = (from_client) ? get_new_tcp_state(tcph) : CONN_TCP_ESTABLISHED;
+
+                break;
+        }
+    }
+
+    // Avoid dirtying the connection's cache line when nothing changed.
+    if (state == conn->tcp_state && fin_flags == conn->fin_flags)
+    {
+        return 0;
+    }
+
+    conn->tcp_state = state;
+    conn->fin_flags = fin_flags;
+
+    return 1;
+}
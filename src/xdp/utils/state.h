@@ -0,0 +1,15 @@
+#pragma once
+
+#include <common/all.h>
+
+#include <linux/tcp.h>
+
+#include <xdp/utils/helpers.h>
+
+static __always_inline u8 get_new_tcp_state(struct tcphdr* tcph);
+static __always_inline int update_tcp_state(conn_val_t* conn, struct tcphdr* tcph, int from_client);
+
+// The source file is included directly below instead of compiled and linked as an object because when linking, there is no guarantee the compiler will inline the function (which is crucial for performance).
+// I'd prefer not to include the function logic inside of the header file.
+// More Info: https://stackoverflow.com/questions/24289599/always-inline-does-not-work-when-function-is-implemented-in-different-file
+#include "state.c"
@@ -26,4 +26,127 @@ static __always_inline int inc_pkt_stats(stats_t* stats, STATS_TYPE_T type)
     }
 
     return 0;
+}
+
+/**
+ * Counts a connection (or its counters) removed to make room for a new one before it expired.
+ * 
+ * @return void
+ */
+static __always_inline void inc_evicted_stats()
+{
+    u32 key = 0;
+
+    stats_t* stats = bpf_map_lookup_elem(&map_stats, &key);
+
+    if (stats)
+    {
+        stats->evicted++;
+    }
+}
+
+/**
+ * Increments the counters of a forward rule (does nothing if ENABLE_FWD_RULE_STATS is disabled).
+ * 
+ * @param rule_id The rule's ID.
+ * @param reply Whether the packet was sent by the destination back to the client.
+ * @param new_conn Whether the packet created a new connection.
+ * @param action The XDP action returned for the packet (only XDP_TX, XDP_REDIRECT, and XDP_DROP are counted).
+ * @param bytes The packet's length.
+ * 
+ * @return void
+ */
+static __always_inline void inc_fwd_rule_stats(u32 rule_id, int reply, int new_conn, int action, u64 bytes)
+{
+#ifdef ENABLE_FWD_RULE_STATS
+    fwd_rule_stats_t* rule_stats = bpf_map_lookup_elem(&map_fwd_rule_stats, &rule_id);
+
+    if (!rule_stats)
+    {
+        return;
+    }
+
+    if (new_conn)
+    {
+        rule_stats->new_conns++;
+    }
+
+    if (action == XDP_DROP)
+    {
+        if (reply)
+        {
+            rule_stats->reply_dropped++;
+        }
+        else
+        {
+            rule_stats->fwd_dropped++;
+        }
+    }
+    else if (action == XDP_TX || action == XDP_REDIRECT)
+    {
+        if (reply)
+        {
+            rule_stats->reply_packets++;
+            rule_stats->reply_bytes += bytes;
+        }
+        else
+        {
+            rule_stats->fwd_packets++;
+            rule_stats->fwd_bytes += bytes;
+        }
+    }
+#endif
+}
+
+/**
+ * Increments the counters of a connection in the current CPU's slot (does nothing if CONNECTION_COUNTERS is disabled).
+ * 
+ * @param conn_key A pointer to the connection key.
+ * @param reply Whether the packet was sent by the destination back to the client.
+ * @param new_conn Whether the packet created the connection.
+ * @param action The XDP action returned for the packet (only XDP_TX and XDP_REDIRECT are counted).
+ * @param bytes The packet's length.
+ * 
+ * @return void
+ */
+static __always_inline void inc_conn_stats(conn_key_t* conn_key, int reply, int new_conn, int action, u64 bytes)
+{
+#ifdef CONNECTION_COUNTERS
+    if (action != XDP_TX && action != XDP_REDIRECT)
+    {
+        return;
+    }
+
+    conn_stats_t* conn_stats = bpf_map_lookup_elem(&map_conn_stats, conn_key);
+
+    if (!conn_stats)
+    {
+        // The counters of an existing connection were evicted from the LRU map.
+        if (!new_conn)
+        {
+            inc_evicted_stats();
+        }
+
+        // Creating the entry zeroes the other CPUs' slots.
+        conn_stats_t new_stats = {0};
+
+        bpf_map_update_elem(&map_conn_stats, conn_key, &new_stats, BPF_NOEXIST);
+
+        if ((conn_stats = bpf_map_lookup_elem(&map_conn_stats, conn_key)) == NULL)
+        {
+            return;
+        }
+    }
+
+    if (reply)
+    {
+        conn_stats->reply_packets++;
+        conn_stats->reply_bytes += bytes;
+    }
+    else
+    {
+        conn_stats->fwd_packets++;
+        conn_stats->fwd_bytes += bytes;
+    }
+#endif
 }
\ No newline at end of file
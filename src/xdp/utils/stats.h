@@ -7,6 +7,8 @@
 #include <xdp/xdp_helpers.h>
 #include <xdp/prog_dispatcher.h>
 
+#include <xdp/utils/maps.h>
+
 enum STATS_TYPE
 {
     STATS_TYPE_FORWARDED = 0,
@@ -15,6 +17,9 @@ enum STATS_TYPE
 } typedef STATS_TYPE_T;
 
 static __always_inline int inc_pkt_stats(stats_t* stats, STATS_TYPE_T type);
+static __always_inline void inc_evicted_stats();
+static __always_inline void inc_fwd_rule_stats(u32 rule_id, int reply, int new_conn, int action, u64 bytes);
+static __always_inline void inc_conn_stats(conn_key_t* conn_key, int reply, int new_conn, int action, u64 bytes);
 
 // The source file is included directly below instead of compiled and linked as an object because when linking, there is no guarantee the compiler will inline the function (which is crucial for performance).
 // I'd prefer not to include the function logic inside of the header file.
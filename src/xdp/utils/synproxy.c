@@ -0,0 +1,400 @@
+#include <xdp/utils/synproxy.h>
+
+#if defined(ENABLE_SYN_COOKIES) || defined(ENABLE_FAST_REJECT)
+/**
+ * Writes a TCP header without payload (and an optional MSS option) over a TCP packet and updates the IP length and checksums.
+ * 
+ * @param iph A pointer to the IPv4 header (NULL for IPv6 packets).
+ * @param iph6 A pointer to the IPv6 header (NULL for IPv4 packets).
+ * @param tcph A pointer to the TCP header.
+ * @param data_end The packet's data end pointer.
+ * @param seq The sequence number.
+ * @param ack_seq The acknowledgement number.
+ * @param flags The TCP flags (TCP_FLAG_*).
+ * @param mss The MSS option's value (0 = no options).
+ * 
+ * @return 0 on success or -1 if the packet is too short.
+ */
+static __always_inline int write_tcp_hdr(struct iphdr* iph, struct ipv6hdr* iph6, struct tcphdr* tcph, void* data_end, u32 seq, u32 ack_seq, u32 flags, u16 mss)
+{
+    u32 tcp_len = (mss) ? SYN_PROXY_TCP_LEN_MSS : SYN_PROXY_TCP_LEN;
+
+    if ((void*)tcph + SYN_PROXY_TCP_LEN > data_end || (mss && (void*)tcph + SYN_PROXY_TCP_LEN_MSS > data_end))
+    {
+        return -1;
+    }
+
+    tcph->seq = htonl(seq);
+    tcph->ack_seq = htonl(ack_seq);
+
+    // The flag word holds the data offset, flags, and window.
+    tcp_flag_word(tcph) = htonl((tcp_len / 4) << 28) | flags;
+    tcph->window = htons(SYN_PROXY_WINDOW);
+
+    tcph->urg_ptr = 0;
+    tcph->check = 0;
+
+    if (mss)
+    {
+        // MSS option (kind 2, length 4).
+        u32* opt = (u32*)(tcph + 1);
+
+        *opt = htonl((2 << 24) | (4 << 16) | mss);
+    }
+
+    // The TCP checksum covers a pseudo-header with the addresses, protocol, and TCP length.
+    u32 csum = 0;
+
+    if (iph)
+    {
+        iph->tot_len = htons(sizeof(struct iphdr) + tcp_len);
+        update_iph_checksum(iph);
+
+        csum = csum_add(iph->saddr, csum);
+        csum = csum_add(iph->daddr, csum);
+        csum = csum_add(htonl((IPPROTO_TCP << 16) | tcp_len), csum);
+    }
+    else
+    {
+        iph6->payload_len = htons(tcp_len);
+
+        // The source and destination addresses are next to each other.
+        u32* addrs = (u32*)&iph6->saddr;
+
+#pragma clang loop unroll(full)
+        for (int i = 0; i < 8; i++)
+        {
+            csum = csum_add(addrs[i], csum);
+        }
+
+        csum = csum_add(htonl(tcp_len), csum);
+        csum = csum_add(htonl(IPPROTO_TCP), csum);
+    }
+
+    if (mss)
+    {
+        csum = bpf_csum_diff(NULL, 0, (__be32*)tcph, SYN_PROXY_TCP_LEN_MSS, csum);
+    }
+    else
+    {
+        csum = bpf_csum_diff(NULL, 0, (__be32*)tcph, SYN_PROXY_TCP_LEN, csum);
+    }
+
+    tcph->check = csum_fold_helper(csum);
+
+    return 0;
+}
+
+/**
+ * Turns a TCP packet into a segment without payload sent back out where it came from.
+ * 
+ * @param ctx A pointer to the xdp_md struct containing all packet information.
+ * @param data The packet's data pointer.
+ * @param data_end The packet's data end pointer.
+ * @param eth A pointer to the ethernet header.
+ * @param iph A pointer to the IPv4 header (NULL for IPv6 packets).
+ * @param iph6 A pointer to the IPv6 header (NULL for IPv4 packets).
+ * @param tcph A pointer to the TCP header (must follow the IP header without IPv4 options or IPv6 extension headers).
+ * @param seq The sequence number.
+ * @param ack_seq The acknowledgement number.
+ * @param flags The TCP flags (TCP_FLAG_*).
+ * @param mss The MSS option's value (0 = no options).
+ * 
+ * @return XDP_TX on success or XDP_DROP.
+ */
+static __always_inline int send_tcp_reply(struct xdp_md* ctx, void* data, void* data_end, struct ethhdr* eth, struct iphdr* iph, struct ipv6hdr* iph6, struct tcphdr* tcph, u32 seq, u32 ack_seq, u32 flags, u16 mss)
+{
+    // Swap MAC addresses.
+    u8 mac[ETH_ALEN];
+
+    memcpy(mac, eth->h_source, ETH_ALEN);
+    memcpy(eth->h_source, eth->h_dest, ETH_ALEN);
+    memcpy(eth->h_dest, mac, ETH_ALEN);
+
+    // Swap IP addresses.
+    u32 l3_len = 0;
+
+    if (iph)
+    {
+        u32 ip = iph->saddr;
+
+        iph->saddr = iph->daddr;
+        iph->daddr = ip;
+
+        l3_len = sizeof(struct iphdr);
+    }
+    else
+    {
+        u128 ip6 = 0;
+
+        memcpy(&ip6, &iph6->saddr, sizeof(ip6));
+        memcpy(&iph6->saddr, &iph6->daddr, sizeof(ip6));
+        memcpy(&iph6->daddr, &ip6, sizeof(ip6));
+
+        l3_len = sizeof(struct ipv6hdr);
+    }
+
+    // Swap ports.
+    u16 port = tcph->source;
+
+    tcph->source = tcph->dest;
+    tcph->dest = port;
+
+    // Remove the payload and options the packet carried (or make room for the MSS option if it carried neither).
+    int len = sizeof(struct ethhdr) + l3_len + ((mss) ? SYN_PROXY_TCP_LEN_MSS : SYN_PROXY_TCP_LEN);
+    int delta = len - (int)(data_end - data);
+
+    if (delta != 0)
+    {
+        if (bpf_xdp_adjust_tail(ctx, delta))
+        {
+            return XDP_DROP;
+        }
+
+        // We need to redefine packet and check headers again.
+        data = (void *)(long)ctx->data;
+        data_end = (void *)(long)ctx->data_end;
+
+        if (iph)
+        {
+            iph = data + sizeof(struct ethhdr);
+
+            if (iph + 1 > (struct iphdr *)data_end)
+            {
+                return XDP_DROP;
+            }
+        }
+        else
+        {
+            iph6 = data + sizeof(struct ethhdr);
+
+            if (iph6 + 1 > (struct ipv6hdr *)data_end)
+            {
+                return XDP_DROP;
+            }
+        }
+
+        tcph = data + sizeof(struct ethhdr) + l3_len;
+
+        if (tcph + 1 > (struct tcphdr *)data_end)
+        {
+            return XDP_DROP;
+        }
+    }
+
+    if (write_tcp_hdr(iph, iph6, tcph, data_end, seq, ack_seq, flags, mss))
+    {
+        return XDP_DROP;
+    }
+
+    return XDP_TX;
+}
+#endif
+
+#ifdef ENABLE_SYN_COOKIES
+/**
+ * Answers a client's SYN with a SYN-ACK carrying a SYN cookie instead of creating a connection.
+ * 
+ * @param ctx A pointer to the xdp_md struct containing all packet information.
+ * @param data The packet's data pointer.
+ * @param data_end The packet's data end pointer.
+ * @param eth A pointer to the ethernet header.
+ * @param iph A pointer to the IPv4 header (NULL for IPv6 packets).
+ * @param iph6 A pointer to the IPv6 header (NULL for IPv4 packets).
+ * @param tcph A pointer to the TCP header.
+ * 
+ * @return XDP_TX (sends the SYN-ACK back out the TX path) or XDP_DROP.
+ */
+static __always_inline int send_syn_cookie(struct xdp_md* ctx, void* data, void* data_end, struct ethhdr* eth, struct iphdr* iph, struct ipv6hdr* iph6, struct tcphdr* tcph)
+{
+    // We only rewrite packets without IPv4 options or IPv6 extension headers.
+    if ((iph && iph->ihl != 5) || (iph6 && iph6->nexthdr != IPPROTO_TCP))
+    {
+        return XDP_DROP;
+    }
+
+    u32 th_len = tcph->doff * 4;
+
+    if (th_len < sizeof(struct tcphdr) || (void*)tcph + th_len > data_end)
+    {
+        return XDP_DROP;
+    }
+
+    // The lower 32 bits hold the cookie (the MSS encoded into it is only needed by the kernel's TCP stack).
+    s64 value = (iph) ? bpf_tcp_raw_gen_syncookie_ipv4(iph, tcph, th_len) : bpf_tcp_raw_gen_syncookie_ipv6(iph6, tcph, th_len);
+
+    if (value < 0)
+    {
+        return XDP_DROP;
+    }
+
+    u32 cookie = (u32)value;
+    u32 seq = ntohl(tcph->seq);
+
+    // SACK, timestamps, and window scaling aren't offered, so the destination's sequence numbers are all we need to translate later on.
+    return send_tcp_reply(ctx, data, data_end, eth, iph, iph6, tcph, cookie, seq + 1, TCP_FLAG_SYN | TCP_FLAG_ACK, (iph) ? SYN_PROXY_MSS : SYN_PROXY_MSS - 20);
+}
+
+/**
+ * Checks the SYN cookie acknowledged by a client's ACK.
+ * 
+ * @param iph A pointer to the IPv4 header (NULL for IPv6 packets).
+ * @param iph6 A pointer to the IPv6 header (NULL for IPv4 packets).
+ * @param tcph A pointer to the TCP header.
+ * @param cookie A pointer to store the cookie (our initial sequence number) in.
+ * 
+ * @return 0 if the cookie is valid or -1 otherwise.
+ */
+static __always_inline int check_syn_cookie(struct iphdr* iph, struct ipv6hdr* iph6, struct tcphdr* tcph, u32* cookie)
+{
+    // The ACK is rewritten into a SYN later on.
+    if ((iph && iph->ihl != 5) || (iph6 && iph6->nexthdr != IPPROTO_TCP))
+    {
+        return -1;
+    }
+
+    if (!tcph->ack || tcph->syn || tcph->rst)
+    {
+        return -1;
+    }
+
+    long ret = (iph) ? bpf_tcp_raw_check_syncookie_ipv4(iph, tcph) : bpf_tcp_raw_check_syncookie_ipv6(iph6, tcph);
+
+    if (ret)
+    {
+        return -1;
+    }
+
+    *cookie = ntohl(tcph->ack_seq) - 1;
+
+    return 0;
+}
+
+/**
+ * Rewrites a client's ACK carrying a valid SYN cookie into the SYN that opens the connection to the destination.
+ * 
+ * @param ctx A pointer to the xdp_md struct containing all packet information.
+ * @param data A pointer to the data pointer.
+ * @param data_end A pointer to the data end pointer.
+ * @param eth A pointer to the ethernet header pointer.
+ * @param iph A pointer to the IPv4 header pointer (NULL for IPv6 packets).
+ * @param iph6 A pointer to the IPv6 header pointer (NULL for IPv4 packets).
+ * @param tcph A pointer to the TCP header pointer.
+ * 
+ * @return 0 on success or -1 on failure.
+ */
+static __always_inline int make_proxy_syn(struct xdp_md* ctx, void** data, void** data_end, struct ethhdr** eth, struct iphdr** iph, struct ipv6hdr** iph6, struct tcphdr** tcph)
+{
+    int ip4 = (*iph != NULL);
+
+    u32 l4_off = sizeof(struct ethhdr) + ((ip4) ? sizeof(struct iphdr) : sizeof(struct ipv6hdr));
+
+    // The client's initial sequence number.
+    u32 seq = ntohl((*tcph)->seq) - 1;
+
+    // Any data sent along with the ACK is dropped (the client retransmits it once the destination answered).
+    int delta = (int)(l4_off + SYN_PROXY_TCP_LEN_MSS) - (int)(*data_end - *data);
+
+    if (delta != 0)
+    {
+        if (bpf_xdp_adjust_tail(ctx, delta))
+        {
+            return -1;
+        }
+
+        // We need to redefine packet and check headers again.
+        *data = (void *)(long)ctx->data;
+        *data_end = (void *)(long)ctx->data_end;
+
+        *eth = *data;
+
+        if (*eth + 1 > (struct ethhdr *)*data_end)
+        {
+            return -1;
+        }
+
+        if (ip4)
+        {
+            *iph = *data + sizeof(struct ethhdr);
+
+            if (*iph + 1 > (struct iphdr *)*data_end)
+            {
+                return -1;
+            }
+
+            *tcph = *data + sizeof(struct ethhdr) + sizeof(struct iphdr);
+        }
+        else
+        {
+            *iph6 = *data + sizeof(struct ethhdr);
+
+            if (*iph6 + 1 > (struct ipv6hdr *)*data_end)
+            {
+                return -1;
+            }
+
+            *tcph = *data + sizeof(struct ethhdr) + sizeof(struct ipv6hdr);
+        }
+
+        if (*tcph + 1 > (struct tcphdr *)*data_end)
+        {
+            return -1;
+        }
+    }
+
+    return write_tcp_hdr(*iph, *iph6, *tcph, *data_end, seq, 0, TCP_FLAG_SYN, (ip4) ? SYN_PROXY_MSS : SYN_PROXY_MSS - 20);
+}
+
+/**
+ * Answers the destination's SYN-ACK of a proxied connection with the ACK completing its handshake.
+ * 
+ * @param ctx A pointer to the xdp_md struct containing all packet information.
+ * @param data The packet's data pointer.
+ * @param data_end The packet's data end pointer.
+ * @param eth A pointer to the ethernet header.
+ * @param iph A pointer to the IPv4 header (NULL for IPv6 packets).
+ * @param iph6 A pointer to the IPv6 header (NULL for IPv4 packets).
+ * @param tcph A pointer to the TCP header.
+ * 
+ * @return XDP_TX (sends the ACK back out the TX path) or XDP_DROP.
+ */
+static __always_inline int ack_proxy_synack(struct xdp_md* ctx, void* data, void* data_end, struct ethhdr* eth, struct iphdr* iph, struct ipv6hdr* iph6, struct tcphdr* tcph)
+{
+    if ((iph && iph->ihl != 5) || (iph6 && iph6->nexthdr != IPPROTO_TCP))
+    {
+        return XDP_DROP;
+    }
+
+    u32 seq = ntohl(tcph->ack_seq);
+    u32 ack_seq = ntohl(tcph->seq) + 1;
+
+    return send_tcp_reply(ctx, data, data_end, eth, iph, iph6, tcph, seq, ack_seq, TCP_FLAG_ACK, 0);
+}
+
+/**
+ * Translates the destination's sequence numbers of a proxied connection to the ones the client got with its SYN cookie and back.
+ * 
+ * @param tcph A pointer to the TCP header.
+ * @param delta The destination's initial sequence number minus the cookie.
+ * @param from_client 1 if the packet was sent by the client or 0 if it was sent by the destination.
+ * 
+ * @return void
+ */
+static __always_inline void adjust_proxy_seq(struct tcphdr* tcph, u32 delta, int from_client)
+{
+    if (from_client)
+    {
+        u32 old_ack_seq = tcph->ack_seq;
+
+        tcph->ack_seq = htonl(ntohl(old_ack_seq) + delta);
+        tcph->check = csum_diff4(old_ack_seq, tcph->ack_seq, tcph->check);
+    }
+    else
+    {
+        u32 old_seq = tcph->seq;
+
+        tcph->seq = htonl(ntohl(old_seq) - delta);
+        tcph->check = csum_diff4(old_seq, tcph->seq, tcph->check);
+    }
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <common/all.h>
+
+#include <linux/if_ether.h>
+#include <linux/ip.h>
+#include <linux/ipv6.h>
+#include <linux/tcp.h>
+#include <linux/in.h>
+
+#include <xdp/utils/csum.h>
+#include <xdp/utils/helpers.h>
+
+// The length of the TCP headers we craft with (MSS option) and without options.
+#define SYN_PROXY_TCP_LEN_MSS 24
+#define SYN_PROXY_TCP_LEN 20
+
+// The receive window advertised in crafted segments (window scaling isn't offered).
+#define SYN_PROXY_WINDOW 65535
+
+// Crafted TCP replies are shared with fast rejects (TCP RST).
+#if defined(ENABLE_SYN_COOKIES) || defined(ENABLE_FAST_REJECT)
+static __always_inline int write_tcp_hdr(struct iphdr* iph, struct ipv6hdr* iph6, struct tcphdr* tcph, void* data_end, u32 seq, u32 ack_seq, u32 flags, u16 mss);
+static __always_inline int send_tcp_reply(struct xdp_md* ctx, void* data, void* data_end, struct ethhdr* eth, struct iphdr* iph, struct ipv6hdr* iph6, struct tcphdr* tcph, u32 seq, u32 ack_seq, u32 flags, u16 mss);
+#endif
+
+#ifdef ENABLE_SYN_COOKIES
+static __always_inline int send_syn_cookie(struct xdp_md* ctx, void* data, void* data_end, struct ethhdr* eth, struct iphdr* iph, struct ipv6hdr* iph6, struct tcphdr* tcph);
+static __always_inline int check_syn_cookie(struct iphdr* iph, struct ipv6hdr* iph6, struct tcphdr* tcph, u32* cookie);
+static __always_inline int make_proxy_syn(struct xdp_md* ctx, void** data, void** data_end, struct ethhdr** eth, struct iphdr** iph, struct ipv6hdr** iph6, struct tcphdr** tcph);
+static __always_inline int ack_proxy_synack(struct xdp_md* ctx, void* data, void* data_end, struct ethhdr* eth, struct iphdr* iph, struct ipv6hdr* iph6, struct tcphdr* tcph);
+static __always_inline void adjust_proxy_seq(struct tcphdr* tcph, u32 delta, int from_client);
+#endif
+
+// The source file is included directly below instead of compiled and linked as an object because when linking, there is no guarantee the compiler will inline the function (which is crucial for performance).
+// I'd prefer not to include the function logic inside of the header file.
+// More Info: https://stackoverflow.com/questions/24289599/always-inline-does-not-work-when-function-is-implemented-in-different-file
+#include "synproxy.c"
\ No newline at end of file
@@ -0,0 +1,185 @@
+#include <xdp/utils/tunnel.h>
+
+#ifdef ENABLE_TUNNELS
+/**
+ * Removes the outer headers of a GRE or IPIP packet received from a configured tunnel endpoint.
+ * 
+ * @param ctx A pointer to the xdp_md struct containing all packet information.
+ * @param iph A pointer to the outer IPv4 header (NULL for IPv6 packets).
+ * @param iph6 A pointer to the outer IPv6 header (NULL for IPv4 packets).
+ * @param protocol The outer header's protocol.
+ * @param src_ip The outer source IP (the tunnel's remote endpoint).
+ * @param dst_ip The outer destination IP (the tunnel's local endpoint).
+ * @param l4_hdr A pointer to the header following the outer IP header.
+ * @param data A pointer to the data pointer.
+ * @param data_end A pointer to the data end pointer.
+ * @param eth A pointer to the ethernet header pointer.
+ * 
+ * @return The tunnel's ID if the outer headers were removed or 0 if the packet isn't from a configured tunnel (the packet is left as is).
+ */
+static __always_inline u32 strip_tunnel(struct xdp_md* ctx, struct iphdr* iph, struct ipv6hdr* iph6, u8 protocol, u128 src_ip, u128 dst_ip, void* l4_hdr, void** data, void** data_end, struct ethhdr** eth)
+{
+    // Fragmented tunnel packets and extension headers are left to the network stack.
+    if ((iph && (iph->frag_off & htons(IP_MF | IP_OFFSET))) || (iph6 && iph6->nexthdr != protocol))
+    {
+        return 0;
+    }
+
+    tunnel_key_t key = {0};
+    key.local_ip = dst_ip;
+    key.remote_ip = src_ip;
+
+    u32* id = bpf_map_lookup_elem(&map_tunnel_ids, &key);
+
+    if (!id)
+    {
+        return 0;
+    }
+
+    u32 tunnel_id = *id;
+
+    tunnel_t* tunnel = bpf_map_lookup_elem(&map_tunnels, &tunnel_id);
+
+    if (!tunnel)
+    {
+        return 0;
+    }
+
+    be16 inner_proto = 0;
+    u32 tun_len = 0;
+
+    if (tunnel->type == TUNNEL_GRE && protocol == IPPROTO_GRE)
+    {
+        struct gre_hdr* greh = l4_hdr;
+
+        if (greh + 1 > (struct gre_hdr *)*data_end)
+        {
+            return 0;
+        }
+
+        // Only GRE headers without checksum, key, or sequence number are supported (the same header is used towards the tunnel).
+        if (greh->flags != 0)
+        {
+            return 0;
+        }
+
+        inner_proto = greh->protocol;
+        tun_len = GRE_ENCAP_LEN;
+    }
+    else if (tunnel->type == TUNNEL_IPIP && protocol == IPPROTO_IPIP)
+    {
+        inner_proto = htons(ETH_P_IP);
+    }
+    else if (tunnel->type == TUNNEL_IPIP && protocol == IPPROTO_IPV6)
+    {
+        inner_proto = htons(ETH_P_IPV6);
+    }
+
+    if (inner_proto != htons(ETH_P_IP) && inner_proto != htons(ETH_P_IPV6))
+    {
+        return 0;
+    }
+
+    struct ethhdr old_eth = **eth;
+
+    u32 outer_len = (l4_hdr - (*data + sizeof(struct ethhdr))) + tun_len;
+
+    if (bpf_xdp_adjust_head(ctx, (int)outer_len))
+    {
+        return 0;
+    }
+
+    // We need to redefine packet and check headers again.
+    *data = (void *)(long)ctx->data;
+    *data_end = (void *)(long)ctx->data_end;
+
+    *eth = *data;
+
+    // Truncated packets are dropped when the inner headers are parsed.
+    if (*eth + 1 > (struct ethhdr *)*data_end)
+    {
+        return tunnel_id;
+    }
+
+    memcpy((*eth)->h_dest, old_eth.h_dest, ETH_ALEN);
+    memcpy((*eth)->h_source, old_eth.h_source, ETH_ALEN);
+    (*eth)->h_proto = inner_proto;
+
+    return tunnel_id;
+}
+
+/**
+ * Encapsulates a packet sent back to a client towards the remote endpoint of the tunnel the client's packets arrived through.
+ * 
+ * @param ctx A pointer to the xdp_md struct containing all packet information.
+ * @param tunnel_id The tunnel's ID (0 = none).
+ * @param data A pointer to the data pointer.
+ * @param data_end A pointer to the data end pointer.
+ * @param eth A pointer to the ethernet header pointer.
+ * @param iph A pointer to the IPv4 header pointer (set to the outer header).
+ * @param iph6 A pointer to the IPv6 header pointer (set to the outer header).
+ * @param protocol A pointer to the packet's protocol (set to the outer header's protocol).
+ * 
+ * @return 0 on success (or if there is no tunnel) or 1 if the packet can't be encapsulated.
+ */
+static __always_inline int encap_tunnel_reply(struct xdp_md* ctx, u32 tunnel_id, void** data, void** data_end, struct ethhdr** eth, struct iphdr** iph, struct ipv6hdr** iph6, u8* protocol)
+{
+    if (!tunnel_id)
+    {
+        return 0;
+    }
+
+    tunnel_t* tunnel = bpf_map_lookup_elem(&map_tunnels, &tunnel_id);
+
+    // Tunnels removed from the config are no longer used.
+    if (!tunnel || tunnel->type == TUNNEL_NONE)
+    {
+        return 0;
+    }
+
+    return encap_packet(ctx, tunnel->type, tunnel->local_ip, tunnel->remote_ip, 0, data, data_end, eth, iph, iph6, protocol);
+}
+
+/**
+ * Encapsulates a reply the program built in place of a client's packet (e.g. a TCP RST, ICMP port unreachable, or SYN-ACK) if the client's packet arrived through a tunnel.
+ * 
+ * @param ctx A pointer to the xdp_md struct containing all packet information.
+ * @param tunnel_id The tunnel's ID (0 = none).
+ * @param action The action returned when building the reply.
+ * 
+ * @return The action to take with the reply (XDP_DROP if it can't be encapsulated).
+ */
+static __always_inline int encap_local_reply(struct xdp_md* ctx, u32 tunnel_id, int action)
+{
+    if (!tunnel_id || action != XDP_TX)
+    {
+        return action;
+    }
+
+    // The reply may have been resized, so its headers need to be found again.
+    void* data = (void*)(long)ctx->data;
+    void* data_end = (void*)(long)ctx->data_end;
+
+    struct ethhdr* eth = data;
+    struct iphdr* iph = NULL;
+    struct ipv6hdr* iph6 = NULL;
+
+    u8 protocol = 0;
+    void* l4_hdr = NULL;
+
+    u128 src_ip = 0;
+    u128 dst_ip = 0;
+
+    if (parse_ip_hdr(data, data_end, &iph, &iph6, &protocol, &l4_hdr, &src_ip, &dst_ip))
+    {
+        return XDP_DROP;
+    }
+
+    if (encap_tunnel_reply(ctx, tunnel_id, &data, &data_end, &eth, &iph, &iph6, &protocol))
+    {
+        return XDP_DROP;
+    }
+
+    return XDP_TX;
+}
+#endif
\ No newline at end of file
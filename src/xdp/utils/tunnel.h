@@ -0,0 +1,23 @@
+#pragma once
+
+#include <common/all.h>
+
+#include <linux/if_ether.h>
+#include <linux/ip.h>
+#include <linux/ipv6.h>
+#include <linux/in.h>
+
+#include <xdp/utils/helpers.h>
+#include <xdp/utils/maps.h>
+#include <xdp/utils/encap.h>
+
+#ifdef ENABLE_TUNNELS
+static __always_inline u32 strip_tunnel(struct xdp_md* ctx, struct iphdr* iph, struct ipv6hdr* iph6, u8 protocol, u128 src_ip, u128 dst_ip, void* l4_hdr, void** data, void** data_end, struct ethhdr** eth);
+static __always_inline int encap_tunnel_reply(struct xdp_md* ctx, u32 tunnel_id, void** data, void** data_end, struct ethhdr** eth, struct iphdr** iph, struct ipv6hdr** iph6, u8* protocol);
+static __always_inline int encap_local_reply(struct xdp_md* ctx, u32 tunnel_id, int action);
+#endif
+
+// The source file is included directly below instead of compiled and linked as an object because when linking, there is no guarantee the compiler will inline the function (which is crucial for performance).
+// I'd prefer not to include the function logic inside of the header file.
+// More Info: https://stackoverflow.com/questions/24289599/always-inline-does-not-work-when-function-is-implemented-in-different-file
+#include "tunnel.c"
\ No newline at end of file
@@ -0,0 +1,250 @@
+#include <xdp/utils/xlate.h>
+
+/**
+ * Translates an IPv4 TCP or UDP packet to IPv6 (NAT46).
+ * 
+ * The IPv4 header (including options) is replaced with an IPv6 header carrying the new addresses and the layer-4 checksum is updated for the new pseudo-header.
+ * 
+ * @param ctx A pointer to the xdp_md struct containing all packet information.
+ * @param data A pointer to the data pointer.
+ * @param data_end A pointer to the data end pointer.
+ * @param eth A pointer to the ethernet header pointer.
+ * @param iph A pointer to the IPv4 header pointer (set to NULL on success).
+ * @param iph6 A pointer to the IPv6 header pointer (set on success).
+ * @param tcph A pointer to the TCP header pointer.
+ * @param udph A pointer to the UDP header pointer.
+ * @param src_ip The new source IPv6 address.
+ * @param dst_ip The new destination IPv6 address.
+ * 
+ * @return 0 on success or 1 if the packet can't be translated.
+ */
+static __always_inline int xlate_ip4_to_ip6(struct xdp_md* ctx, void** data, void** data_end, struct ethhdr** eth, struct iphdr** iph, struct ipv6hdr** iph6, struct tcphdr** tcph, struct udphdr** udph, u128 src_ip, u128 dst_ip)
+{
+    struct ethhdr old_eth = **eth;
+    struct iphdr old_iph = **iph;
+
+    if (old_iph.ihl < 5)
+    {
+        return 1;
+    }
+
+    // Fragments would require an IPv6 fragment header.
+    if (old_iph.frag_off & htons(IP_MF | IP_OFFSET))
+    {
+        return 1;
+    }
+
+    u16 l3_len = old_iph.ihl * 4;
+    u16 l4_len = ntohs(old_iph.tot_len) - l3_len;
+
+    // Only the addresses differ between the pseudo-headers. IPv4-mapped addresses work here since the ::ffff prefix doesn't change a one's complement sum.
+    u128 old_src_ip = ip4_to_ip6(old_iph.saddr);
+    u128 old_dst_ip = ip4_to_ip6(old_iph.daddr);
+
+    if (*tcph)
+    {
+        (*tcph)->check = csum_diff16(old_src_ip, src_ip, (*tcph)->check);
+        (*tcph)->check = csum_diff16(old_dst_ip, dst_ip, (*tcph)->check);
+    }
+    else if (*udph)
+    {
+        // UDP checksums are mandatory with IPv6 and we can't calculate a full checksum here.
+        if (!(*udph)->check)
+        {
+            return 1;
+        }
+
+        (*udph)->check = csum_diff16(old_src_ip, src_ip, (*udph)->check);
+        (*udph)->check = csum_diff16(old_dst_ip, dst_ip, (*udph)->check);
+    }
+
+    // Grow the head so the IPv6 header fits in place of the IPv4 header.
+    if (bpf_xdp_adjust_head(ctx, (int)l3_len - (int)sizeof(struct ipv6hdr)))
+    {
+        return 1;
+    }
+
+    // We need to redefine packet and check headers again.
+    *data = (void *)(long)ctx->data;
+    *data_end = (void *)(long)ctx->data_end;
+
+    *eth = *data;
+
+    if (*eth + 1 > (struct ethhdr *)*data_end)
+    {
+        return 1;
+    }
+
+    memcpy((*eth)->h_dest, old_eth.h_dest, ETH_ALEN);
+    memcpy((*eth)->h_source, old_eth.h_source, ETH_ALEN);
+    (*eth)->h_proto = htons(ETH_P_IPV6);
+
+    *iph6 = *data + sizeof(struct ethhdr);
+
+    if (*iph6 + 1 > (struct ipv6hdr *)*data_end)
+    {
+        return 1;
+    }
+
+    (*iph6)->version = 6;
+    (*iph6)->priority = old_iph.tos >> 4;
+    (*iph6)->flow_lbl[0] = (old_iph.tos & 0x0f) << 4;
+    (*iph6)->flow_lbl[1] = 0;
+    (*iph6)->flow_lbl[2] = 0;
+
+    (*iph6)->payload_len = htons(l4_len);
+    (*iph6)->nexthdr = old_iph.protocol;
+    (*iph6)->hop_limit = old_iph.ttl;
+
+    memcpy(&(*iph6)->saddr, &src_ip, sizeof(src_ip));
+    memcpy(&(*iph6)->daddr, &dst_ip, sizeof(dst_ip));
+
+    *iph = NULL;
+
+    if (*tcph)
+    {
+        *tcph = (void *)(*iph6 + 1);
+
+        if (*tcph + 1 > (struct tcphdr *)*data_end)
+        {
+            return 1;
+        }
+    }
+    else
+    {
+        *udph = (void *)(*iph6 + 1);
+
+        if (*udph + 1 > (struct udphdr *)*data_end)
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Translates an IPv6 TCP or UDP packet to IPv4 (NAT64).
+ * 
+ * The IPv6 header (including extension headers) is replaced with an IPv4 header carrying the new addresses and the layer-4 checksum is updated for the new pseudo-header.
+ * The IPv4 header checksum is left to the caller.
+ * 
+ * @param ctx A pointer to the xdp_md struct containing all packet information.
+ * @param data A pointer to the data pointer.
+ * @param data_end A pointer to the data end pointer.
+ * @param eth A pointer to the ethernet header pointer.
+ * @param iph A pointer to the IPv4 header pointer (set on success).
+ * @param iph6 A pointer to the IPv6 header pointer (set to NULL on success).
+ * @param tcph A pointer to the TCP header pointer.
+ * @param udph A pointer to the UDP header pointer.
+ * @param src_ip The new source address (IPv4-mapped).
+ * @param dst_ip The new destination address (IPv4-mapped).
+ * 
+ * @return 0 on success or 1 if the packet can't be translated.
+ */
+static __always_inline int xlate_ip6_to_ip4(struct xdp_md* ctx, void** data, void** data_end, struct ethhdr** eth, struct iphdr** iph, struct ipv6hdr** iph6, struct tcphdr** tcph, struct udphdr** udph, u128 src_ip, u128 dst_ip)
+{
+    struct ethhdr old_eth = **eth;
+    struct ipv6hdr old_iph6 = **iph6;
+
+    // Extension headers are dropped along with the IPv6 header (fragments never get here since get_ip6_l4_hdr() leaves them to the network stack).
+    void *l4_hdr = (*tcph) ? (void *)*tcph : (void *)*udph;
+
+    unsigned int l3_len = (l4_hdr - (void *)*iph6) & 0x7ff;
+
+    if (l3_len < sizeof(struct ipv6hdr))
+    {
+        return 1;
+    }
+
+    u16 l4_len = ntohs(old_iph6.payload_len) - (l3_len - sizeof(struct ipv6hdr));
+
+    u8 protocol = (*tcph) ? IPPROTO_TCP : IPPROTO_UDP;
+
+    // Only the addresses differ between the pseudo-headers.
+    u128 old_src_ip;
+    u128 old_dst_ip;
+
+    memcpy(&old_src_ip, &old_iph6.saddr, sizeof(old_src_ip));
+    memcpy(&old_dst_ip, &old_iph6.daddr, sizeof(old_dst_ip));
+
+    if (*tcph)
+    {
+        (*tcph)->check = csum_diff16(old_src_ip, src_ip, (*tcph)->check);
+        (*tcph)->check = csum_diff16(old_dst_ip, dst_ip, (*tcph)->check);
+    }
+    else if (*udph)
+    {
+        (*udph)->check = csum_diff16(old_src_ip, src_ip, (*udph)->check);
+        (*udph)->check = csum_diff16(old_dst_ip, dst_ip, (*udph)->check);
+
+        // A zero UDP checksum means no checksum with IPv4.
+        if (!(*udph)->check)
+        {
+            (*udph)->check = 0xffff;
+        }
+    }
+
+    // Shrink the head so only the IPv4 header is in place of the IPv6 headers.
+    if (bpf_xdp_adjust_head(ctx, (int)l3_len - (int)sizeof(struct iphdr)))
+    {
+        return 1;
+    }
+
+    // We need to redefine packet and check headers again.
+    *data = (void *)(long)ctx->data;
+    *data_end = (void *)(long)ctx->data_end;
+
+    *eth = *data;
+
+    if (*eth + 1 > (struct ethhdr *)*data_end)
+    {
+        return 1;
+    }
+
+    memcpy((*eth)->h_dest, old_eth.h_dest, ETH_ALEN);
+    memcpy((*eth)->h_source, old_eth.h_source, ETH_ALEN);
+    (*eth)->h_proto = htons(ETH_P_IP);
+
+    *iph = *data + sizeof(struct ethhdr);
+
+    if (*iph + 1 > (struct iphdr *)*data_end)
+    {
+        return 1;
+    }
+
+    (*iph)->version = 4;
+    (*iph)->ihl = 5;
+    (*iph)->tos = (old_iph6.priority << 4) | (old_iph6.flow_lbl[0] >> 4);
+    (*iph)->tot_len = htons(l4_len + sizeof(struct iphdr));
+    (*iph)->id = 0;
+    (*iph)->frag_off = htons(IP_DF);
+    (*iph)->ttl = old_iph6.hop_limit;
+    (*iph)->protocol = protocol;
+    (*iph)->check = 0;
+    (*iph)->saddr = ip6_to_ip4(src_ip);
+    (*iph)->daddr = ip6_to_ip4(dst_ip);
+
+    *iph6 = NULL;
+
+    if (*tcph)
+    {
+        *tcph = (void *)(*iph + 1);
+
+        if (*tcph + 1 > (struct tcphdr *)*data_end)
+        {
+            return 1;
+        }
+    }
+    else
+    {
+        *udph = (void *)(*iph + 1);
+
+        if (*udph + 1 > (struct udphdr *)*data_end)
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <common/all.h>
+
+#include <linux/if_ether.h>
+#include <linux/ip.h>
+#include <linux/ipv6.h>
+#include <linux/tcp.h>
+#include <linux/udp.h>
+
+#include <xdp/utils/helpers.h>
+#include <xdp/utils/csum.h>
+
+static __always_inline int xlate_ip4_to_ip6(struct xdp_md* ctx, void** data, void** data_end, struct ethhdr** eth, struct iphdr** iph, struct ipv6hdr** iph6, struct tcphdr** tcph, struct udphdr** udph, u128 src_ip, u128 dst_ip);
+static __always_inline int xlate_ip6_to_ip4(struct xdp_md* ctx, void** data, void** data_end, struct ethhdr** eth, struct iphdr** iph, struct ipv6hdr** iph6, struct tcphdr** tcph, struct udphdr** udph, u128 src_ip, u128 dst_ip);
+
+// The source file is included directly below instead of compiled and linked as an object because when linking, there is no guarantee the compiler will inline the function (which is crucial for performance).
+// I'd prefer not to include the function logic inside of the header file.
+// More Info: https://stackoverflow.com/questions/24289599/always-inline-does-not-work-when-function-is-implemented-in-different-file
+#include "xlate.c"
\ No newline at end of file
@@ -0,0 +1,203 @@
+#include <linux/if_ether.h>
+#include <linux/ip.h>
+#include <linux/ipv6.h>
+#include <linux/udp.h>
+#include <linux/in.h>
+
+#include <common/all.h>
+
+#include <xdp/utils/helpers.h>
+#include <xdp/utils/encap.h>
+
+// Runs on backends of DSR rules and strips the IPIP, GUE, or GRE header the forwarding program added, so the network stack receives the client's packet unchanged.
+// The bind IP must be assigned to the backend (e.g. on its loopback interface) and replies are routed to the client directly.
+struct 
+{
+    __uint(priority, 10);
+    __uint(XDP_PASS, 1);
+} XDP_RUN_CONFIG(xdp_decap_main);
+
+// The outer source IPs (IPv4-mapped for IPv4) tunnel packets are accepted from. Packets from other sources are passed on unchanged so the tunnel can't be used to slip packets past the backend's firewall.
+// The map is pinned by name under xdp-loader's pin path and filled with bpftool.
+struct
+{
+    __uint(type, BPF_MAP_TYPE_HASH);
+    __uint(max_entries, MAX_DECAP_SOURCES);
+    __type(key, u128);
+    __type(value, u8);
+    __uint(pinning, LIBBPF_PIN_BY_NAME);
+} map_decap_sources SEC(".maps");
+
+SEC("xdp_decap")
+int xdp_decap_main(struct xdp_md *ctx)
+{
+    // Initialize packet information.
+    void *data = (void *)(long)ctx->data;
+    void *data_end = (void *)(long)ctx->data_end;
+
+    // Initialize Ethernet header.
+    struct ethhdr *eth = data;
+
+    // Anything we can't parse is left to the network stack.
+    if (unlikely(eth + 1 > (struct ethhdr *)data_end))
+    {
+        return XDP_PASS;
+    }
+
+    u8 protocol = 0;
+    u32 outer_len = 0;
+
+    u128 src_ip = 0;
+
+    if (eth->h_proto == htons(ETH_P_IP))
+    {
+        struct iphdr *iph = data + sizeof(struct ethhdr);
+
+        if (unlikely(iph + 1 > (struct iphdr *)data_end))
+        {
+            return XDP_PASS;
+        }
+
+        // Fragmented tunnel packets are reassembled by the network stack.
+        if (iph->ihl < 5 || (iph->frag_off & htons(IP_MF | IP_OFFSET)))
+        {
+            return XDP_PASS;
+        }
+
+        protocol = iph->protocol;
+        outer_len = iph->ihl * 4;
+
+        src_ip = ip4_to_ip6(iph->saddr);
+    }
+    else if (eth->h_proto == htons(ETH_P_IPV6))
+    {
+        struct ipv6hdr *iph6 = data + sizeof(struct ethhdr);
+
+        if (unlikely(iph6 + 1 > (struct ipv6hdr *)data_end))
+        {
+            return XDP_PASS;
+        }
+
+        // The forwarding program doesn't add extension headers.
+        protocol = iph6->nexthdr;
+        outer_len = sizeof(struct ipv6hdr);
+
+        memcpy(&src_ip, &iph6->saddr, sizeof(src_ip));
+    }
+    else
+    {
+        return XDP_PASS;
+    }
+
+    if (protocol != IPPROTO_IPIP && protocol != IPPROTO_IPV6 && protocol != IPPROTO_GRE && protocol != IPPROTO_UDP)
+    {
+        return XDP_PASS;
+    }
+
+    // Only the proxies' tunnel packets are decapsulated.
+    if (!bpf_map_lookup_elem(&map_decap_sources, &src_ip))
+    {
+        return XDP_PASS;
+    }
+
+    void *tun_hdr = data + sizeof(struct ethhdr) + outer_len;
+
+    be16 inner_proto = 0;
+
+    switch (protocol)
+    {
+        case IPPROTO_IPIP:
+            inner_proto = htons(ETH_P_IP);
+
+            break;
+
+        case IPPROTO_IPV6:
+            inner_proto = htons(ETH_P_IPV6);
+
+            break;
+
+        case IPPROTO_GRE:
+        {
+            struct gre_hdr *greh = tun_hdr;
+
+            if (greh + 1 > (struct gre_hdr *)data_end)
+            {
+                return XDP_PASS;
+            }
+
+            // Only GRE headers without checksum, key, or sequence number are sent by the forwarding program.
+            if (greh->flags != 0)
+            {
+                return XDP_PASS;
+            }
+
+            inner_proto = greh->protocol;
+            outer_len += GRE_ENCAP_LEN;
+
+            break;
+        }
+
+        case IPPROTO_UDP:
+        {
+            struct udphdr *udph = tun_hdr;
+            struct gue_hdr *gueh = (void *)(udph + 1);
+
+            if (gueh + 1 > (struct gue_hdr *)data_end)
+            {
+                return XDP_PASS;
+            }
+
+            // Version 0 data messages without optional fields.
+            if (udph->dest != htons(DSR_GUE_PORT) || gueh->hlen_ver != 0)
+            {
+                return XDP_PASS;
+            }
+
+            if (gueh->protocol == IPPROTO_IPIP)
+            {
+                inner_proto = htons(ETH_P_IP);
+            }
+            else if (gueh->protocol == IPPROTO_IPV6)
+            {
+                inner_proto = htons(ETH_P_IPV6);
+            }
+
+            outer_len += GUE_ENCAP_LEN;
+
+            break;
+        }
+    }
+
+    if (inner_proto != htons(ETH_P_IP) && inner_proto != htons(ETH_P_IPV6))
+    {
+        return XDP_PASS;
+    }
+
+    struct ethhdr old_eth = *eth;
+
+    // Remove the outer headers.
+    if (bpf_xdp_adjust_head(ctx, (int)outer_len))
+    {
+        return XDP_PASS;
+    }
+
+    data = (void *)(long)ctx->data;
+    data_end = (void *)(long)ctx->data_end;
+
+    eth = data;
+
+    if (unlikely(eth + 1 > (struct ethhdr *)data_end))
+    {
+        return XDP_DROP;
+    }
+
+    memcpy(eth->h_dest, old_eth.h_dest, ETH_ALEN);
+    memcpy(eth->h_source, old_eth.h_source, ETH_ALEN);
+    eth->h_proto = inner_proto;
+
+    return XDP_PASS;
+}
+
+char _license[] SEC("license") = "GPL";
+
+__uint(xsk_prog_version, XDP_DISPATCHER_VERSION) SEC(XDP_METADATA_SECTION);
\ No newline at end of file